@@ -8,12 +8,14 @@ UDPHandler udpHandler;
 
 NonBlockingTimer timer_wifiStatus;
 float checkWifiStatusPeriod = 2; // [s]
+bool reportedWifiStatus = false;
 
 void callback_SerialRecvMsg(String message);
 void callback_UDPRecvMsg(String message);
 
 void setup(){
-  delay(1000);
+  // The first status report goes out on the first loop(), it is what gets
+  // the Teensy to send the WiFi details
   serialHandler.callback_SerialRecvMsg = callback_SerialRecvMsg;
   udpHandler.callback_UDPRecvMsg = callback_UDPRecvMsg;
 
@@ -49,9 +51,11 @@ void loop(){
   serialHandler.Update();
   udpHandler.Update();
   
-  // Check wifi status
-  if(timer_wifiStatus.isReady()){
-    String message = udpHandler.checkWifiConnection() ? "1" : "0";
+  // Check wifi status, periodically and as soon as it changes
+  bool wifiStatus = udpHandler.checkWifiConnection();
+  if(timer_wifiStatus.isReady() || wifiStatus != reportedWifiStatus){
+    reportedWifiStatus = wifiStatus;
+    String message = wifiStatus ? "1" : "0";
     serialHandler.SendSerial(flag_UDPConnectionData, message);
   }
 }
\ No newline at end of file
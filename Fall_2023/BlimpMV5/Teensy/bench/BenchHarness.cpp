@@ -0,0 +1,122 @@
+/*
+ BenchHarness.cpp
+*/
+
+#include "BenchHarness.h"
+#include <string.h>
+#include <math.h>
+
+volatile float benchSink = 0;
+
+static void sortSamples(double* values, int n) {
+  for (int i = 1; i < n; i++) {
+    double v = values[i];
+    int j = i - 1;
+    while (j >= 0 && values[j] > v) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = v;
+  }
+}
+
+void BenchHarness::Init(const char* newFilter) {
+  filter = (newFilter != nullptr && newFilter[0] != '\0') ? newFilter : nullptr;
+  numResults = 0;
+}
+
+bool BenchHarness::selected(const char* name) {
+  lastSelected = numResults < BENCH_MAX_RESULTS && (filter == nullptr || strstr(name, filter) != nullptr);
+  return lastSelected;
+}
+
+void BenchHarness::startTimer() {
+#ifdef ARDUINO
+  startCycles = ARM_DWT_CYCCNT;
+#else
+  startTime = std::chrono::steady_clock::now();
+#endif
+}
+
+double BenchHarness::elapsedNanos() {
+#ifdef ARDUINO
+  uint32_t cycles = ARM_DWT_CYCCNT - startCycles;
+  return cycles * (1e9 / F_CPU_ACTUAL);
+#else
+  auto now = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(now - startTime).count();
+#endif
+}
+
+void BenchHarness::stopTimer(uint32_t iterations, double& nanosPerIter, double& cyclesPerIter) {
+#ifdef ARDUINO
+  uint32_t cycles = ARM_DWT_CYCCNT - startCycles;
+  cyclesPerIter = (double)cycles / iterations;
+  nanosPerIter = cyclesPerIter * (1e9 / F_CPU_ACTUAL);
+#else
+  nanosPerIter = elapsedNanos() / iterations;
+  cyclesPerIter = 0;
+#endif
+}
+
+void BenchHarness::record(const char* name, uint32_t iterations, double* samples, double* cycleSamples) {
+  sortSamples(samples, BENCH_REPETITIONS);
+  sortSamples(cycleSamples, BENCH_REPETITIONS);
+
+  BenchResult& result = results[numResults++];
+  result.name = name;
+  result.iterations = iterations;
+  result.medianNanos = samples[BENCH_REPETITIONS / 2];
+  result.minNanos = samples[0];
+  result.cycles = cycleSamples[BENCH_REPETITIONS / 2];
+  result.extra = NAN;
+  result.extraName = nullptr;
+}
+
+void BenchHarness::annotate(const char* name, double value) {
+  if (numResults == 0 || !lastSelected) return;
+  results[numResults - 1].extraName = name;
+  results[numResults - 1].extra = value;
+}
+
+void BenchHarness::printJSON() {
+  Serial.println("{");
+  Serial.println("  \"context\": {");
+  Serial.print("    \"target\": \"");
+  Serial.print(BENCH_TARGET);
+  Serial.println("\",");
+#ifdef ARDUINO
+  Serial.print("    \"cpu_mhz\": ");
+  Serial.print((unsigned long)(F_CPU_ACTUAL / 1000000));
+  Serial.println(",");
+#endif
+  Serial.print("    \"repetitions\": ");
+  Serial.println(BENCH_REPETITIONS);
+  Serial.println("  },");
+  Serial.println("  \"benchmarks\": [");
+  for (int i = 0; i < numResults; i++) {
+    const BenchResult& result = results[i];
+    Serial.print("    {\"name\": \"");
+    Serial.print(result.name);
+    Serial.print("\", \"iterations\": ");
+    Serial.print((unsigned long)result.iterations);
+    Serial.print(", \"real_time\": ");
+    Serial.print(result.medianNanos, 1);
+    Serial.print(", \"min_time\": ");
+    Serial.print(result.minNanos, 1);
+    if (result.cycles > 0) {
+      Serial.print(", \"cycles\": ");
+      Serial.print(result.cycles, 1);
+    }
+    if (result.extraName != nullptr) {
+      Serial.print(", \"");
+      Serial.print(result.extraName);
+      Serial.print("\": ");
+      Serial.print(result.extra, 6);
+    }
+    Serial.print(", \"time_unit\": \"ns\"}");
+    Serial.println(i + 1 < numResults ? "," : "");
+  }
+  Serial.println("  ]");
+  Serial.println("}");
+}
@@ -0,0 +1,123 @@
+/*
+ BenchHarness.h - minimal microbenchmark runner for the estimator and control kernels.
+
+ On the host (native env) each benchmark is timed with std::chrono and the
+ iteration count is scaled until a repetition takes at least minRepNanos.
+ On the Teensy the DWT cycle counter is used with a fixed iteration count.
+ Results are printed as Google-Benchmark-style JSON so compare_bench.py can
+ diff two runs.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+  #define BENCH_TARGET "teensy40"
+  #define BENCH_ADVANCE_CLOCK(us)
+#else
+  #include <chrono>
+  #define BENCH_TARGET "native"
+  #define BENCH_ADVANCE_CLOCK(us) nativeClock::advanceMicros(us)
+#endif
+
+#define BENCH_MAX_RESULTS 48
+#define BENCH_REPETITIONS 5
+
+struct BenchResult {
+  const char* name;
+  uint32_t iterations;
+  double medianNanos;   // per iteration, median over repetitions
+  double minNanos;      // per iteration, best repetition
+  double cycles;        // per iteration, median over repetitions (0 when not measured)
+  double extra;         // benchmark specific value (e.g. max error), NAN when unused
+  const char* extraName;
+};
+
+// Keeps results observable so the compiler cannot drop the benchmarked work
+extern volatile float benchSink;
+
+class BenchHarness {
+  public:
+    void Init(const char* filter);
+
+    // Times body() once per iteration
+    template<typename F>
+    void run(const char* name, F body) {
+      if (!selected(name)) return;
+      uint32_t iterations = calibrate([&](uint32_t n){ for (uint32_t i = 0; i < n; i++) body(i); });
+      measure(name, iterations, [&](uint32_t n){ for (uint32_t i = 0; i < n; i++) body(i); });
+    }
+
+    // Times prepare(n) outside and batch(n) inside the measurement; batch must do n units of work
+    template<typename P, typename F>
+    void runBatch(const char* name, uint32_t iterations, P prepare, F batch) {
+      if (!selected(name)) return;
+      double samples[BENCH_REPETITIONS];
+      double cycleSamples[BENCH_REPETITIONS];
+      for (int rep = 0; rep < BENCH_REPETITIONS; rep++) {
+        prepare(iterations);
+        startTimer();
+        batch(iterations);
+        stopTimer(iterations, samples[rep], cycleSamples[rep]);
+      }
+      record(name, iterations, samples, cycleSamples);
+    }
+
+    // Attaches a named value to the most recent result, dropped if that benchmark was filtered out
+    void annotate(const char* name, double value);
+
+    void printJSON();
+
+  private:
+    template<typename F>
+    uint32_t calibrate(F loop) {
+#ifdef ARDUINO
+      (void)loop;
+      return fixedIterations;
+#else
+      uint32_t n = 16;
+      while (n < (1u << 26)) {
+        startTimer();
+        loop(n);
+        double nanos = elapsedNanos();
+        if (nanos >= minRepNanos) break;
+        n *= (nanos > minRepNanos / 16) ? 2 : 8;
+      }
+      return n;
+#endif
+    }
+
+    template<typename F>
+    void measure(const char* name, uint32_t iterations, F loop) {
+      double samples[BENCH_REPETITIONS];
+      double cycleSamples[BENCH_REPETITIONS];
+      for (int rep = 0; rep < BENCH_REPETITIONS; rep++) {
+        startTimer();
+        loop(iterations);
+        stopTimer(iterations, samples[rep], cycleSamples[rep]);
+      }
+      record(name, iterations, samples, cycleSamples);
+    }
+
+    bool selected(const char* name);
+    void startTimer();
+    double elapsedNanos();
+    void stopTimer(uint32_t iterations, double& nanosPerIter, double& cyclesPerIter);
+    void record(const char* name, uint32_t iterations, double* samples, double* cycleSamples);
+
+    const char* filter = nullptr;
+    BenchResult results[BENCH_MAX_RESULTS];
+    int numResults = 0;
+    bool lastSelected = false;
+
+    const uint32_t fixedIterations = 500;
+    const double minRepNanos = 20e6;
+
+#ifdef ARDUINO
+    uint32_t startCycles = 0;
+#else
+    std::chrono::steady_clock::time_point startTime;
+#endif
+};
@@ -0,0 +1,147 @@
+/*
+ BenchReference.h - the code some kernels replaced, kept to time and check them against
+
+ Shared by bench_main.cpp, which times both versions and annotates the
+ largest difference, and the Unity tests in test/, which hold the
+ differences to their tolerances (pio test -e native).
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include <BasicLinearAlgebra.h>
+#include "MotorMapping.h"
+#include "ImuMounting.h"
+#include "BaroAltitude.h"
+#include "TeensyParams.h"
+
+// MotorMapping::update before the single precision solver
+static inline MotorMix referenceMix(double pitch, double forward, double up, double yaw) {
+  up = max(-500.0, min(500.0, up));
+  yaw = max(-500.0, min(500.0, yaw));
+  forward = max(-500.0, min(500.0, forward));
+  if (forward + yaw > 500) forward = - yaw+500;
+  if (forward - yaw > 500) forward = yaw+500;
+  if (forward - yaw < -500) forward = yaw - 500;
+  if (forward + yaw < -500) forward = -yaw - 500;
+
+  double brx = forward + yaw, brz = up;
+  double blx = forward - yaw, blz = up;
+  double thetaR = atan2(brz, brx);
+  double thetaL = atan2(blz, blx);
+  double magR = sqrt(pow(brx,2)+pow(brz,2))*sqrt(2.0)/2.0;
+  double magL = sqrt(pow(blx,2)+pow(blz,2))*sqrt(2.0)/2.0;
+  thetaR = 45 + thetaR*180/3.1415 - pitch;
+  thetaL = 135 - (thetaL*180/3.1415 - pitch);
+  if (thetaR > 180) { thetaR -= 180; magR = -magR; }
+  if (thetaR < 0) { thetaR += 180; magR = -magR; }
+  if (thetaL > 180) { thetaL -= 180; magL = -magL; }
+  if (thetaL < 0) { thetaL += 180; magL = -magL; }
+  return {(float)thetaR, (float)thetaL, (float)(magR * 2), (float)(magL * 2)};
+}
+
+static inline void unwrapMix(float& angle, float& mag, float reference) {
+  if (fabsf(angle - reference) > 90) {
+    angle += angle < reference ? 180 : -180;
+    mag = -mag;
+  }
+}
+
+// Largest MotorMapping::mix difference to referenceMix over a grid of commands
+static inline void mixReferenceError(double& maxAngleError, double& maxMagError) {
+  maxAngleError = 0;
+  maxMagError = 0;
+  for (int f = -550; f <= 550; f += 25) {
+    for (int u = -550; u <= 550; u += 25) {
+      for (int y = -550; y <= 550; y += 50) {
+        for (int p = -10; p <= 10; p += 10) {
+          MotorMix a = MotorMapping::mix(p, f, u, y);
+          MotorMix b = referenceMix(p, f, u, y);
+          // either side of the 0/180 wrap is the same thrust with the motor reversed
+          unwrapMix(a.servoR, a.magR, b.servoR);
+          unwrapMix(a.servoL, a.magL, b.servoL);
+          maxAngleError = max(maxAngleError, (double)max(fabsf(a.servoR - b.servoR), fabsf(a.servoL - b.servoL)));
+          maxMagError = max(maxMagError, (double)max(fabsf(a.magR - b.magR), fabsf(a.magL - b.magL)));
+        }
+      }
+    }
+  }
+}
+
+// IMU_read's axis swap and IMU_ROTATION(-90) before ImuMounting
+static inline void referenceImuAxes(const int accRaw[3], const int gyrRaw[3], float acc[3], float gyr[3]) {
+  float accY = (accRaw[0] * 0.244) / 1000.0;
+  float accX = -(accRaw[1] * 0.244) / 1000.0;
+  float accZ = (accRaw[2] * 0.244) / 1000.0;
+  float gyrY = (gyrRaw[0] * 70) / 1000.0;
+  float gyrX = -(gyrRaw[1] * 70) / 1000.0;
+  float gyrZ = (gyrRaw[2] * 70) / 1000.0;
+  float rotation_angle = -90;
+  BLA::Matrix<3, 3> Rz = {cosf(rotation_angle/180*PI),-sinf(rotation_angle/180*PI),0,
+                          sinf(rotation_angle/180*PI),cosf(rotation_angle/180*PI),0,
+                          0,0,1};
+  BLA::Matrix<3, 1> gyr_rate = {gyrX, gyrY, gyrZ};
+  BLA::Matrix<3, 1> Acc_raw = {accX, accY, accZ};
+  BLA::Matrix<3, 1> corrected_gyr_rate = Rz*gyr_rate;
+  BLA::Matrix<3, 1> corrected_Acc_raw = Rz*Acc_raw;
+  for (int i = 0; i < 3; i++) {
+    acc[i] = corrected_Acc_raw(i);
+    gyr[i] = corrected_gyr_rate(i);
+  }
+}
+
+// What BerryIMU_v3::IMU_read does with the raw counts now
+static inline void mountedImuAxes(const ImuAlignment& alignment, const int accRaw[3], const int gyrRaw[3], float acc[3], float gyr[3]) {
+  int a[3], g[3];
+  mapAxes(IMU_MOUNTING, accRaw, a);
+  mapAxes(IMU_MOUNTING, gyrRaw, g);
+  for (int i = 0; i < 3; i++) {
+    acc[i] = (a[i] * 0.244) / 1000.0;
+    gyr[i] = (g[i] * 70) / 1000.0;
+  }
+  alignment.apply(acc[0], acc[1], acc[2]);
+  alignment.apply(gyr[0], gyr[1], gyr[2]);
+}
+
+// Largest difference of the two over a grid of raw counts up to full scale, no fine
+// alignment, relative to the length of the sample (floats near 2000 dps are 2.4e-4 apart)
+static inline double mountingReferenceError() {
+  ImuAlignment alignment;
+  double maxError = 0;
+  for (int x = -32768; x < 32768; x += 2521) {
+    for (int y = -32768; y < 32768; y += 2521) {
+      for (int z = -32768; z < 32768; z += 2521) {
+        int raw[3] = {x, y, z};
+        float acc[3], gyr[3], accRef[3], gyrRef[3];
+        mountedImuAxes(alignment, raw, raw, acc, gyr);
+        referenceImuAxes(raw, raw, accRef, gyrRef);
+        double accNorm = max(1.0, (double)sqrtf(accRef[0]*accRef[0] + accRef[1]*accRef[1] + accRef[2]*accRef[2]));
+        double gyrNorm = max(1.0, (double)sqrtf(gyrRef[0]*gyrRef[0] + gyrRef[1]*gyrRef[1] + gyrRef[2]*gyrRef[2]));
+        for (int k = 0; k < 3; k++) {
+          maxError = max(maxError, fabs((double)acc[k] - accRef[k]) / accNorm);
+          maxError = max(maxError, fabs((double)gyr[k] - gyrRef[k]) / gyrNorm);
+        }
+      }
+    }
+  }
+  return maxError;
+}
+
+// The barometric formula in double precision, pow as IMU_read used it
+static inline double referenceBaroAltitude(double pressure, double reference) {
+  return 44330 * (1 - pow(pressure / reference, 1 / 5.255));
+}
+
+// Largest baroAltitude difference [m] to the formula, from 300 m below to 300 m above the
+// reference, around a range of ground pressures
+static inline double baroAltitudeReferenceError() {
+  double maxError = 0;
+  for (float reference = 90000; reference <= 105000; reference += 2500) {
+    for (float pressure = reference * 0.965f; pressure <= reference * 1.035f; pressure += 0.37f) {
+      double error = fabs(baroAltitude(pressure, reference) - referenceBaroAltitude(pressure, reference));
+      maxError = max(maxError, error);
+    }
+  }
+  return maxError;
+}
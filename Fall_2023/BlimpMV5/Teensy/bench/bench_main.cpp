@@ -0,0 +1,438 @@
+/*
+ bench_main.cpp - microbenchmarks for the estimator and control kernels run by the 100 Hz loop.
+
+ Host:   pio run -e bench_native && .pio/build/bench_native/program [--filter name] [--imu-csv file]
+ Teensy: pio run -e bench_teensy40 -t upload && pio device monitor > bench.log
+ Then:   python3 bench/compare_bench.py baseline.json bench.log
+*/
+
+#include <Arduino.h>
+#include <vector>
+
+#include "BenchHarness.h"
+#include "Madgwick_Filter.h"
+#include "gyro_ekf.h"
+#include "baro_acc_kf.h"
+#include "optical_ekf.h"
+#include "Kalman_Filter_Tran_Vel_Est.h"
+#include "accelGCorrection.h"
+#include "BenchReference.h"
+#include "MotorMapping.h"
+#include "ROSHandler.h"
+#include "CameraLink.h"
+#include "DebugLog.h"
+#include "TeensyParams.h"
+
+#ifndef ARDUINO
+  #include <stdio.h>
+  #include <string.h>
+#endif
+
+#define NUM_SAMPLES 256
+
+// One IMU/baro sample as seen by the fast sensor loop, in body axes
+struct ImuSample {
+  float gx, gy, gz;   // [deg/s]
+  float ax, ay, az;   // [g]
+  float alt;          // [m]
+};
+
+static ImuSample samples[NUM_SAMPLES];
+static int numSamples = NUM_SAMPLES;
+
+static BenchHarness bench;
+
+// Deterministic pseudo random noise in [-1,1]
+static uint32_t noiseState = 12345;
+static float noise() {
+  noiseState = noiseState * 1664525u + 1013904223u;
+  return ((noiseState >> 8) & 0xFFFF) / 32767.5f - 1.0f;
+}
+
+// Slow pitch/roll rocking with a yaw turn, gravity rotated accordingly
+static void generateSyntheticSamples() {
+  const float dt = 1.0 / FAST_SENSOR_LOOP_FREQ;
+  for (int i = 0; i < NUM_SAMPLES; i++) {
+    float t = i * dt;
+    float pitch = 10 * sinf(2 * PI * 0.3f * t) * DEG_TO_RAD;
+    float roll = 5 * sinf(2 * PI * 0.2f * t) * DEG_TO_RAD;
+    samples[i].gx = 5 * 2 * PI * 0.2f * cosf(2 * PI * 0.2f * t) + 0.5f * noise();
+    samples[i].gy = 10 * 2 * PI * 0.3f * cosf(2 * PI * 0.3f * t) + 0.5f * noise();
+    samples[i].gz = 20 + 0.5f * noise();
+    samples[i].ax = -sinf(pitch) + 0.01f * noise();
+    samples[i].ay = cosf(pitch) * sinf(roll) + 0.01f * noise();
+    samples[i].az = cosf(pitch) * cosf(roll) + 0.01f * noise();
+    samples[i].alt = 1.5f + 0.2f * sinf(2 * PI * 0.1f * t) + 0.05f * noise();
+  }
+  numSamples = NUM_SAMPLES;
+}
+
+#ifndef ARDUINO
+// Loads "gx,gy,gz,ax,ay,az,alt" rows (one header line allowed) recorded from the fast loop
+static bool loadSamplesCSV(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) return false;
+  char line[256];
+  int n = 0;
+  while (n < NUM_SAMPLES && fgets(line, sizeof(line), file) != nullptr) {
+    ImuSample s;
+    if (sscanf(line, "%f,%f,%f,%f,%f,%f,%f", &s.gx, &s.gy, &s.gz, &s.ax, &s.ay, &s.az, &s.alt) == 7) {
+      samples[n++] = s;
+    }
+  }
+  fclose(file);
+  if (n == 0) return false;
+  numSamples = n;
+  return true;
+}
+#endif
+
+static const ImuSample& sampleAt(uint32_t i) {
+  return samples[i % numSamples];
+}
+
+static void benchEstimators() {
+  const float dt = 1.0 / FAST_SENSOR_LOOP_FREQ;
+
+  Madgwick_Filter madgwick;
+  madgwick.Init();
+  bench.run("madgwick_update", [&](uint32_t i) {
+    const ImuSample& s = sampleAt(i);
+    BENCH_ADVANCE_CLOCK(10000);
+    madgwick.Madgwick_Update(s.gx, s.gy, s.gz, s.ax, s.ay, s.az);
+    benchSink = madgwick.pitch_final;
+  });
+
+  GyroEKF gyroEKF;
+  gyroEKF.Init();
+  bench.run("gyro_ekf_predict", [&](uint32_t i) {
+    (void)i;
+    gyroEKF.predict(dt);
+    benchSink = gyroEKF.yaw;
+  });
+  bench.run("gyro_ekf_update_gyro", [&](uint32_t i) {
+    const ImuSample& s = sampleAt(i);
+    gyroEKF.updateGyro(s.gx * DEG_TO_RAD, s.gy * DEG_TO_RAD, s.gz * DEG_TO_RAD);
+    benchSink = gyroEKF.yawRate;
+  });
+  bench.run("gyro_ekf_update_accel", [&](uint32_t i) {
+    const ImuSample& s = sampleAt(i);
+    gyroEKF.updateAccel(s.ax, s.ay, s.az);
+    benchSink = gyroEKF.roll;
+  });
+
+  BaroAccKF kf;
+  kf.Init();
+  bench.run("baro_acc_kf_predict", [&](uint32_t i) {
+    (void)i;
+    kf.predict(dt);
+    benchSink = kf.x;
+  });
+  bench.run("baro_acc_kf_update_baro", [&](uint32_t i) {
+    kf.updateBaro(sampleAt(i).alt);
+    benchSink = kf.x;
+  });
+  bench.run("baro_acc_kf_update_accel", [&](uint32_t i) {
+    kf.updateAccel(0.05f * noise());
+    benchSink = kf.a;
+    (void)i;
+  });
+
+  OpticalEKF opticalEKF(DIST_CONSTANT, GYRO_X_CONSTANT, GYRO_YAW_CONSTANT);
+  bench.run("optical_ekf_predict", [&](uint32_t i) {
+    (void)i;
+    opticalEKF.predict(dt);
+    benchSink = opticalEKF.v;
+  });
+  bench.run("optical_ekf_update_all", [&](uint32_t i) {
+    const ImuSample& s = sampleAt(i);
+    opticalEKF.updateBaro(CEIL_HEIGHT_FROM_START - s.alt);
+    opticalEKF.updateGyroX(s.gx * DEG_TO_RAD);
+    opticalEKF.updateGyroZ(s.gz * DEG_TO_RAD);
+    opticalEKF.updateAccelx(s.ax * 9.81f);
+    benchSink = opticalEKF.v;
+  });
+
+  // Static so the members start zeroed, the constructor does not initialise xhat/Phat
+  static Kalman_Filter_Tran_Vel_Est kalVel;
+  bench.run("kalman_vel_predict", [&](uint32_t i) {
+    (void)i;
+    BENCH_ADVANCE_CLOCK(10000);
+    kalVel.predict_vel();
+    benchSink = kalVel.x_vel_est;
+  });
+  bench.run("kalman_vel_update_acc", [&](uint32_t i) {
+    const ImuSample& s = sampleAt(i);
+    kalVel.update_vel_acc(s.ax, s.ay);
+    benchSink = kalVel.x_vel_est;
+  });
+  bench.run("kalman_vel_update_optical", [&](uint32_t i) {
+    kalVel.update_vel_optical(0.1f * noise(), 0.1f * noise());
+    benchSink = kalVel.y_vel_est;
+    (void)i;
+  });
+
+  AccelGCorrection accelGCorrection;
+  bench.run("accel_g_correction", [&](uint32_t i) {
+    const ImuSample& s = sampleAt(i);
+    accelGCorrection.updateData(s.ax, s.ay, s.az, 5.0f, -3.0f);
+    benchSink = accelGCorrection.agz;
+  });
+}
+
+// Sample i as the LSM6DSL counts, +/- 8 g and 2000 dps
+static void rawSampleAt(uint32_t i, int accRaw[3], int gyrRaw[3]) {
+  const ImuSample& s = sampleAt(i);
+  accRaw[0] = s.ax * 1000 / 0.244f;
+  accRaw[1] = s.ay * 1000 / 0.244f;
+  accRaw[2] = s.az * 1000 / 0.244f;
+  gyrRaw[0] = s.gx * 1000 / 70.0f;
+  gyrRaw[1] = s.gy * 1000 / 70.0f;
+  gyrRaw[2] = s.gz * 1000 / 70.0f;
+}
+
+static void benchMounting() {
+  ImuAlignment alignment;
+  double maxError = 0;
+  for (int i = 0; i < numSamples; i++) {
+    int accRaw[3], gyrRaw[3];
+    float acc[3], gyr[3], accRef[3], gyrRef[3];
+    rawSampleAt(i, accRaw, gyrRaw);
+    mountedImuAxes(alignment, accRaw, gyrRaw, acc, gyr);
+    referenceImuAxes(accRaw, gyrRaw, accRef, gyrRef);
+    for (int k = 0; k < 3; k++) {
+      maxError = max(maxError, (double)max(fabsf(acc[k] - accRef[k]), fabsf(gyr[k] - gyrRef[k])));
+    }
+  }
+
+  bench.run("imu_mounting", [&](uint32_t i) {
+    int accRaw[3], gyrRaw[3];
+    float acc[3], gyr[3];
+    rawSampleAt(i, accRaw, gyrRaw);
+    mountedImuAxes(alignment, accRaw, gyrRaw, acc, gyr);
+    benchSink = acc[0] + gyr[2];
+  });
+  bench.annotate("max_error", maxError);
+
+  // with a fine alignment from a calibration
+  ImuAlignment trimmed;
+  float angles[3] = {1.5f, -0.8f, 0.3f};
+  trimmed.set(angles);
+  bench.run("imu_mounting_aligned", [&](uint32_t i) {
+    int accRaw[3], gyrRaw[3];
+    float acc[3], gyr[3];
+    rawSampleAt(i, accRaw, gyrRaw);
+    mountedImuAxes(trimmed, accRaw, gyrRaw, acc, gyr);
+    benchSink = acc[0] + gyr[2];
+  });
+
+  bench.run("imu_rotation_reference", [&](uint32_t i) {
+    int accRaw[3], gyrRaw[3];
+    float acc[3], gyr[3];
+    rawSampleAt(i, accRaw, gyrRaw);
+    referenceImuAxes(accRaw, gyrRaw, acc, gyr);
+    benchSink = acc[0] + gyr[2];
+  });
+}
+
+static void benchBaro() {
+  const float reference = 101325;
+  double maxError = baroAltitudeReferenceError();
+  bench.run("baro_altitude", [&](uint32_t i) {
+    benchSink = baroAltitude(reference - 12 * sampleAt(i).alt, reference);
+  });
+  bench.annotate("max_error_m", maxError);
+
+  // the old conversion, float pressures through the double pow
+  bench.run("baro_altitude_reference", [&](uint32_t i) {
+    float pressure = reference - 12 * sampleAt(i).alt;
+    benchSink = 44330 * (1 - pow((pressure / reference), (1 / 5.255)));
+  });
+}
+
+static void benchControl() {
+  // Unused pins: the bench must never drive the real ESCs or servos
+  MotorMapping motors;
+  motors.Init(20, 21, 22, 23, 5, 50, 1000, 2000, 0.3, nullptr);
+  bench.run("motor_mapping_update", [&](uint32_t i) {
+    float forward = 500 * sinf(i * 0.01f);
+    float up = 500 * cosf(i * 0.013f);
+    float yaw = 200 * sinf(i * 0.007f);
+    motors.update(0, forward, up, yaw);
+    benchSink = motors.servoRFilter.last;
+  });
+
+  MotorMapping slewMotors;
+  slewMotors.Init(20, 21, 22, 23, 5, 50, 1000, 2000, 0.3, nullptr);
+  slewMotors.setServoSlewRate(SERVO_SLEW_RATE, SERVO_FLIP_MARGIN);
+  bench.run("motor_mapping_update_slew", [&](uint32_t i) {
+    BENCH_ADVANCE_CLOCK(1000);
+    slewMotors.update(0, 500 * sinf(i * 0.01f), 500 * cosf(i * 0.013f), 200 * sinf(i * 0.007f));
+    benchSink = slewMotors.servoREstimate;
+  });
+
+  double maxAngleError, maxMagError;
+  mixReferenceError(maxAngleError, maxMagError);
+  bench.run("motor_mapping_mix", [&](uint32_t i) {
+    MotorMix m = MotorMapping::mix(0, 500 * sinf(i * 0.01f), 500 * cosf(i * 0.013f), 200 * sinf(i * 0.007f));
+    benchSink = m.servoR + m.magL;
+  });
+  bench.annotate("max_angle_error_deg", maxAngleError);
+  bench.run("motor_mapping_mix_reference", [&](uint32_t i) {
+    MotorMix m = referenceMix(0, 500 * sinf(i * 0.01f), 500 * cosf(i * 0.013f), 200 * sinf(i * 0.007f));
+    benchSink = m.servoR + m.magL;
+  });
+  bench.annotate("max_magnitude_error_us", maxMagError);
+}
+
+static void benchROS() {
+  // Publish path: String formatting plus queueing into the ESP serial buffer
+  ROSHandler* publisher = nullptr;
+  bench.runBatch("ros_publish_string", 200,
+    [&](uint32_t n) { (void)n; delete publisher; publisher = new ROSHandler(); },
+    [&](uint32_t n) {
+      for (uint32_t i = 0; i < n; i++) {
+        publisher->PublishTopic_String("debug", "ceilHeight (" + String(123.4) + ") - yaw(" + String(-20.0) + ")");
+      }
+    });
+  bench.runBatch("ros_publish_float64", 200,
+    [&](uint32_t n) { (void)n; delete publisher; publisher = new ROSHandler(); },
+    [&](uint32_t n) {
+      for (uint32_t i = 0; i < n; i++) publisher->PublishTopic_Float64("ceilHeight", 123.456 + i);
+    });
+  delete publisher;
+
+#ifndef ARDUINO
+  // Parse path: ESP serial bytes -> SerialHandler -> UDPHandler -> ROSHandler -> callback
+  ROSHandler subscriber;
+  subscriber.Init();
+  double received = 0;
+  subscriber.SubscribeTopic_Float64MultiArray(MULTIARRAY_TOPIC, [&](vector<double> values) {
+    if (values.size() == 4) received += values[1];
+  });
+  const char* message = "MP13motorCommands04,0.250000,-0.500000,0.000000,0.750000,#";
+  bench.runBatch("ros_parse_float64multiarray", 200,
+    [&](uint32_t n) { for (uint32_t i = 0; i < n; i++) Serial1.inject(message); },
+    [&](uint32_t n) { (void)n; subscriber.Update(); });
+  benchSink = received;
+#endif
+}
+
+// Previous text camera message parse from main.cpp, for comparison
+static int referenceCameraParse(const String& msg, double parsed[7]) {
+  int index = 0;
+  String tempBuffer = "";
+  for (unsigned int i = 0; i < msg.length(); i++) {
+    char currentChar = msg.charAt(i);
+    if (currentChar == ',') {
+      if (tempBuffer.length() > 0 && index < 7) parsed[index++] = strtod(tempBuffer.c_str(), nullptr);
+      tempBuffer = "";
+    } else {
+      tempBuffer += currentChar;
+    }
+  }
+  return index;
+}
+
+static void benchCamera() {
+  CameraFrame frame = {};
+  frame.sync[0] = CAMERA_SYNC1;
+  frame.sync[1] = CAMERA_SYNC2;
+  frame.time = 123456;
+  frame.blobs[1] = {161, 97, 850, 34, 31};
+  frame.range = 1275;
+  uint8_t* bytes = (uint8_t*)&frame;
+
+  CameraFrameParser parser;
+  double parsed[7];
+  frame.crc = crc16(bytes + 2, sizeof(CameraFrame) - 4);
+  bench.run("camera_frame_parse", [&](uint32_t n) {
+    (void)n;
+    for (uint32_t i = 0; i < sizeof(CameraFrame); i++) parser.push(bytes[i]);
+    parser.toParsed(parsed);
+    benchSink = parsed[2];
+  });
+  bench.annotate("frame_bytes", sizeof(CameraFrame));
+
+  const String text = "1000.000000,1000.000000,161.000000,97.000000,1000.000000,1000.000000,127.5,";
+  bench.run("camera_text_parse_reference", [&](uint32_t n) {
+    (void)n;
+    referenceCameraParse(text, parsed);
+    benchSink = parsed[2];
+  });
+  bench.annotate("frame_bytes", text.length() + 1);
+}
+
+static void benchDebugLog() {
+  // Logging call in the loop: id and raw arguments into the ring, formatted later
+  static DebugRecord ring[DEBUG_LOG_RECORDS];
+  DebugLog* log = nullptr;
+  bench.runBatch("debug_log_write", DEBUG_LOG_RECORDS,
+    [&](uint32_t n) { (void)n; delete log; log = new DebugLog(ring); log->usb = false; },
+    [&](uint32_t n) {
+      for (uint32_t i = 0; i < n; i++) log->write(DEBUG_LEVEL_INFO, MSG_CEILING, 123.4 + i);
+    });
+  delete log;
+
+  // The String the old Serial.println calls built before writing
+  bench.run("debug_string_format_reference", [&](uint32_t n) {
+    String line = "Ceiling height " + String(123.4 + n, 1) + " cm";
+    benchSink = line.length();
+  });
+}
+
+static void runAll(const char* filter) {
+  bench.Init(filter);
+  benchEstimators();
+  benchMounting();
+  benchBaro();
+  benchControl();
+  benchROS();
+  benchCamera();
+  benchDebugLog();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 4000) {
+  }
+  generateSyntheticSamples();
+  runAll(nullptr);
+  Serial.println("BENCH_JSON_BEGIN");
+  bench.printJSON();
+  Serial.println("BENCH_JSON_END");
+}
+
+void loop() {
+}
+
+#else
+
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  const char* csvPath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+    else if (strcmp(argv[i], "--imu-csv") == 0 && i + 1 < argc) csvPath = argv[++i];
+    else {
+      fprintf(stderr, "usage: %s [--filter substring] [--imu-csv file]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  generateSyntheticSamples();
+  if (csvPath != nullptr && !loadSamplesCSV(csvPath)) {
+    fprintf(stderr, "could not read samples from %s\n", csvPath);
+    return 1;
+  }
+  runAll(filter);
+
+  // Only the JSON report goes to stdout, firmware chatter during the run is dropped
+  Serial.setEcho(stdout);
+  bench.printJSON();
+  return 0;
+}
+
+#endif
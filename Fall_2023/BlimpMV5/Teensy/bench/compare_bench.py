@@ -0,0 +1,68 @@
+"""
+compare_bench.py - compares two benchmark reports produced by bench_main.cpp
+
+Usage: python3 compare_bench.py baseline.json current.json [--threshold 10]
+
+Either file may be a raw serial capture from the Teensy; the JSON between the
+BENCH_JSON_BEGIN/BENCH_JSON_END markers is extracted. Exits with status 1 when a
+benchmark got slower than the threshold (in percent).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load_report(path):
+    with open(path, "r") as f:
+        text = f.read()
+    if "BENCH_JSON_BEGIN" in text:
+        text = text.split("BENCH_JSON_BEGIN", 1)[1].split("BENCH_JSON_END", 1)[0]
+    report = json.loads(text)
+    return report["context"], {b["name"]: b for b in report["benchmarks"]}
+
+
+def metric(bench):
+    # Cycle counts are exact on the Teensy, prefer them when present
+    return bench.get("cycles", bench["real_time"])
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent")
+    args = parser.parse_args()
+
+    base_context, baseline = load_report(args.baseline)
+    curr_context, current = load_report(args.current)
+    if base_context.get("target") != curr_context.get("target"):
+        print("warning: comparing %s against %s" % (base_context.get("target"), curr_context.get("target")))
+
+    unit = "cycles" if any("cycles" in b for b in current.values()) else "ns"
+    print("%-32s %12s %12s %9s" % ("benchmark", "baseline", "current", "change"))
+    regressions = []
+    for name, bench in current.items():
+        if name not in baseline:
+            print("%-32s %12s %12.1f %9s" % (name, "-", metric(bench), "new"))
+            continue
+        old = metric(baseline[name])
+        new = metric(bench)
+        change = 100.0 * (new - old) / old if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print("%-32s %12.1f %12.1f %+8.1f%%%s" % (name, old, new, change, flag))
+    for name in baseline:
+        if name not in current:
+            print("%-32s %12.1f %12s %9s" % (name, metric(baseline[name]), "-", "removed"))
+
+    print("(%s per iteration)" % unit)
+    if regressions:
+        print("%d benchmark(s) slower than %.0f%%: %s" % (len(regressions), args.threshold, ", ".join(regressions)))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
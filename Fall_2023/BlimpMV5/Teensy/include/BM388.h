@@ -1,6 +1,15 @@
 //Device adress
 #define BM388_ADDRESS       0x77
 
+//Chip identification
+#define CHIP_ID             0x00
+#define CHIP_ID_VALUE       0x50
+
+//Sensor status, the data ready bits clear when the data registers are read
+#define BM388_STATUS        0x03
+#define BM388_DRDY_PRESS    0x20
+#define BM388_DRDY_TEMP     0x40
+
 //Power modes
 #define PWR_CTRL            0x1B
 
@@ -0,0 +1,27 @@
+/*
+ BaroAltitude.h - height from pressure without pow()
+
+ The barometric formula alt = 44330*(1 - (p/p0)^(1/5.255)) as its binomial
+ series in x = p/p0 - 1, four terms. Within BARO_SERIES_RANGE (about 430 m
+ either side of the reference) the truncation error is below 0.4 mm and
+ float rounding below 1 mm, further out it falls back to powf. test_reference
+ checks it against the double precision formula.
+*/
+
+#pragma once
+
+#include <math.h>
+
+#define BARO_SERIES_RANGE   0.05f     // |p/p0 - 1| covered by the series
+
+// [m] above the reference pressure, both in Pa
+inline float baroAltitude(float pressure, float reference) {
+  constexpr float k = 1/5.255f;
+  constexpr float c1 = k;
+  constexpr float c2 = c1*(k - 1)/2;
+  constexpr float c3 = c2*(k - 2)/3;
+  constexpr float c4 = c3*(k - 3)/4;
+  float x = (pressure - reference)/reference;
+  if (fabsf(x) > BARO_SERIES_RANGE) return 44330*(1 - powf(pressure/reference, k));
+  return -44330*x*(c1 + x*(c2 + x*(c3 + x*c4)));
+}
@@ -4,16 +4,30 @@
 
 #pragma once
 #include "Arduino.h"
-#include <BasicLinearAlgebra.h>
-#include <ElementStorage.h>
+#include "ImuMounting.h"
+
+#define BERRYIMU_LSM6DSL        1
+#define BERRYIMU_LIS3MDL        2
+#define BERRYIMU_BMP388         4
+#define BERRYIMU_PROBE_TIMEOUT  100   //[ms] after power-up for the sensors to answer on I2C
 
 class BerryIMU_v3
 {
   public:
-    void Init();
+    // Waits up to BERRYIMU_PROBE_TIMEOUT for the sensors to answer, false if one never did
+    bool Init();
+    // The LSM6DSL has a new accelerometer and gyroscope sample
+    bool dataReady();
+    // Ground pressure [Pa] from a stored calibration, taken as ref_ground_press if the
+    // first sample is within BARO_REFERENCE_TOLERANCE of it. Call before the first baroRead.
+    void setStoredReference(float pressure);
+    // Accelerometer, gyroscope and magnetometer. In body axes, IMU_MOUNTING then
+    // alignment, see ImuMounting.h
     void IMU_read();
-    void IMU_Flip_Axis();
-    void IMU_ROTATION(float rotation_angle);
+    // Reads a new BMP388 sample into comp_press and alt, false if there is none since the
+    // last call (BARO_ODR_FREQ). comp_temp is refreshed every BARO_TEMP_DECIMATION samples.
+    bool baroRead();
+    ImuAlignment alignment;
     //Maybe low pass filter applied depending on settings selected
     float AccXraw; 
     float AccYraw; 
@@ -27,18 +41,28 @@ class BerryIMU_v3
     float comp_press;
     float ref_ground_press;
     float alt;
+    uint8_t sensorsMissing;   //BERRYIMU_* bits of the sensors that did not answer in Init
+    uint32_t configuredMillis; //when Init finished writing the sensor configuration
 
   private:
     float temp_compensation(float raw_temperature);
-    float press_compensation(float raw_pressure, float comp_temp);
+    void temperature_coefficients(float comp_temp);
+    float press_compensation(float raw_pressure);
     void writeTo(int device, byte address, byte val);
     void readFrom(int device, byte address, int num, byte buff[]);
+    bool probe(int device, byte address, byte expected);
     byte buff[6];
     byte buff_calib[21];
     int accRaw[3];
     int magRaw[3];
     int gyrRaw[3];
     bool ref_pressure_found;
+    int tempCountdown;          //baro samples until the next temperature compensation
+    //temperature dependent terms of the pressure compensation
+    float pressOffset;
+    float pressLinear;
+    float pressQuadratic;
+    float storedReference = 0;
     float PAR_T1;
     float PAR_T2;
     float PAR_T3;
@@ -0,0 +1,50 @@
+/*
+ BootSequence.h - power-on to control authority, driven by readiness
+
+ setup() no longer sleeps: it probes the BerryIMU sensors (WHO_AM_I and
+ chip id, BerryIMU_v3::Init), configures everything and returns. The loop
+ holds the filters and the motors until the IMU reports fresh samples
+ (BerryIMU_v3::dataReady), while the camera, the ESP, WiFi and ROS come up
+ on their own in the background. The Teensy offers the WiFi details as soon
+ as UDPHandler starts and the ESP reports its WiFi status on its first loop
+ and on every change, so neither side waits for the other's 2 s timer.
+
+ mark() records when each phase was first reached, in ms since reset, and
+ logs it (MSG_BOOT_PHASE, flight log and USB). Once ROS is reached main.cpp
+ publishes the whole list on the "boot" topic. ESC arming and the servos
+ travelling to their start angles are not tracked.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum BootPhase : uint8_t {
+  BOOT_SETUP,       // setup() returned
+  BOOT_IMU,         // IMU samples fresh, the filters run
+  BOOT_CONTROL,     // first loop with the controller and motors on a valid IMU
+  BOOT_CAMERA,      // first OpenMV frame
+  BOOT_ESP,         // first message from the ESP
+  BOOT_WIFI,        // ESP reports a WiFi connection
+  BOOT_ROS,         // first message from the ROS bridge
+  BOOT_PHASES
+};
+
+class BootSequence {
+  public:
+    // True the first time a phase is reached
+    bool mark(BootPhase phase);
+    bool reached(BootPhase phase) const { return (reachedMask >> phase) & 1; }
+    uint32_t millisAt(BootPhase phase) const { return phaseMillis[phase]; }
+
+    // "setup 24, imu 61, ..." for the phases reached so far
+    int format(char* text, size_t size) const;
+    static const char* name(BootPhase phase);
+
+  private:
+    uint32_t phaseMillis[BOOT_PHASES] = {0};
+    uint8_t reachedMask = 0;
+};
+
+extern BootSequence bootSequence;
@@ -0,0 +1,78 @@
+/*
+ Calibration.h - sensor calibration and filter state kept across reboots
+
+ One CalibrationData record at CALIBRATION_ADDRESS of the Teensy EEPROM
+ (flash emulated, E2END + 1 = 1080 bytes on the Teensy 4.0). The record
+ starts with a magic number, a layout version and its size and ends with a
+ CRC32, a blank, older or damaged record is not loaded and the firmware runs
+ on the defaults below. Change CALIBRATION_VERSION whenever the layout
+ changes.
+
+ At boot main.cpp loads the record and FlightController::applyCalibration
+ puts it in place: the gyro bias is taken off the raw rates, the accel
+ offsets and scales go to AccelGCorrection, and GyroEKF and BaroAccKF start
+ from the stored bias states and variances instead of their Init() priors.
+ The attitude and height states still start from their priors, the blimp
+ may have been moved since. The baro reference is only used if the first
+ pressure sample is within BARO_REFERENCE_TOLERANCE of it.
+
+ The mount alignment goes to BerryIMU_v3::alignment (ImuMounting.h).
+
+ The "calibrate" ROS topic (Bool) runs FlightController::startCalibration:
+ true averages the IMU at rest for CALIBRATION_SECONDS, levels the IMU on
+ the gravity it saw, takes the baro reference and saves everything. The
+ blimp should hang as it flies. False saves the current filter state
+ with the calibration unchanged, e.g. after a flight with converged biases.
+ Writing the emulated EEPROM can stall the loop for milliseconds, so main.cpp
+ takes both only in manual mode with the sticks centred, cancels a run when
+ that ends and holds a save back until it holds again.
+
+ The magnetometer is not fused yet and has no calibration here.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CALIBRATION_MAGIC       0x424C4D43    // "CMLB"
+#define CALIBRATION_VERSION     2
+#define CALIBRATION_ADDRESS     0             // EEPROM offset of the record
+
+// Why load() failed
+#define CALIBRATION_BLANK       1
+#define CALIBRATION_OLD_VERSION 2
+#define CALIBRATION_CORRUPT     3
+
+struct CalibrationData {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;                // sizeof(CalibrationData) when written
+
+  float gyroBias[3];            // [deg/s] raw gyro at rest
+  float accelOffset[3];         // [m/s^2] AccelGCorrection::offset
+  float accelScale[3];          // AccelGCorrection::scale
+  float baroReference;          // [Pa] ground pressure, 0 = none
+  float mountAlignment[3];      // [deg] ImuAlignment roll, pitch, yaw after IMU_MOUNTING
+
+  float gyroEKFBias[3];         // [rad/s] GyroEKF bias states
+  float gyroEKFVariance[9];     // GyroEKF covariance diagonal
+  float kfBias;                 // [m/s^2] BaroAccKF accel bias state
+  float kfVariance[4];          // BaroAccKF covariance diagonal
+
+  uint32_t crc;                 // CRC32 of everything before it
+};
+
+class CalibrationStore {
+  public:
+    // Reads the record, false (and failure set) if it can't be used
+    bool load();
+    // Writes data with a fresh header and CRC and reads it back
+    bool save();
+
+    CalibrationData data;
+    bool loaded = false;
+    uint8_t failure = 0;        // CALIBRATION_* from the last load()
+
+  private:
+    static uint32_t crc32(const uint8_t* bytes, uint32_t length);
+};
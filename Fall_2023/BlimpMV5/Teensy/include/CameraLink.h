@@ -0,0 +1,113 @@
+/*
+ CameraLink.h - binary frames between the OpenMV and the Teensy on Serial2
+
+ The OpenMV sends one CameraFrame per image, written in a single uart.write
+ by camera_frame() in OpenMV/3color_image_tracking.py:
+
+   sync     0xB5 0x62
+   frame    uint16  counter, wraps
+   time     uint32  [ms] capture time on the OpenMV clock
+   fps      uint8   achieved frame rate
+   mode     uint8   CAMERA_MODE_FULL, _WINDOW or _COARSE, see below
+   blobs    3 x (cx, cy, pixels, w, h) int16, blue, red, green, [px] in the
+            QVGA image, pixels == 0 when the colour was not found
+   range    int16   [mm] rangefinder, 0 when there is no reading
+   crc      uint16  CRC16-CCITT of everything between the sync and the crc
+
+ All fields little endian, 44 bytes in total against about 90 for the old
+ text message. CameraFrameParser takes the bytes one at a time into a fixed
+ buffer and only hands out frames that passed the crc.
+
+ The other way the Teensy sends a CameraCommand (FlightController::
+ cameraRequest) at the outer loop rate:
+
+   sync     0xB5 0x63
+   color    uint8   0 blue, 1 red, 2 green, CAMERA_ALL_COLORS for all three
+   frameSize uint8  CAMERA_QVGA or CAMERA_QQVGA
+   roi      4 x int16  x, y, w, h [px] in QVGA coordinates, w == 0 for the
+            whole frame
+   crc      uint16  as above
+
+ The OpenMV then runs find_blobs on that colour's threshold only, inside the
+ window, and falls back to all colours on the whole frame when no command
+ came for a second. Blob coordinates in CameraFrame stay in QVGA pixels
+ whatever the frame size.
+
+ With a single colour the OpenMV tracks on its own: it searches a window
+ around its last detection, then the commanded window, and when both are
+ lost the whole frame in QQVGA (CAMERA_MODE_COARSE) until it finds the
+ colour again.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CAMERA_SYNC1          0xB5
+#define CAMERA_SYNC2          0x62
+#define CAMERA_COMMAND_SYNC2  0x63
+#define CAMERA_COLORS         3
+#define CAMERA_ALL_COLORS     0xFF
+
+#define CAMERA_QVGA           0     // 320x240
+#define CAMERA_QQVGA          1     // 160x120
+
+#define CAMERA_MODE_FULL      0     // all colours, whole frame
+#define CAMERA_MODE_WINDOW    1
+#define CAMERA_MODE_COARSE    2     // whole frame at QQVGA, reacquiring
+
+struct __attribute__((packed)) CameraBlob {
+  int16_t cx, cy;         // [px] centre
+  int16_t pixels;         // 0 = not found
+  int16_t w, h;           // [px] bounding box
+};
+
+struct __attribute__((packed)) CameraFrame {
+  uint8_t sync[2];
+  uint16_t frame;
+  uint32_t time;          // [ms] OpenMV clock
+  uint8_t fps;
+  uint8_t mode;           // CAMERA_MODE_*
+  CameraBlob blobs[CAMERA_COLORS];  // blue, red, green
+  int16_t range;          // [mm]
+  uint16_t crc;
+};
+
+static_assert(sizeof(CameraFrame) == 44, "CameraFrame layout must match the OpenMV emitter");
+
+struct __attribute__((packed)) CameraCommand {
+  uint8_t sync[2];
+  uint8_t color;
+  uint8_t frameSize;
+  int16_t roiX, roiY, roiW, roiH;  // [px] QVGA, roiW == 0 for the whole frame
+  uint16_t crc;
+};
+
+static_assert(sizeof(CameraCommand) == 14, "CameraCommand layout must match the OpenMV reader");
+
+// CRC16-CCITT (polynomial 0x1021, initial 0xFFFF)
+uint16_t crc16(const uint8_t* data, uint32_t length);
+
+// Fills in the sync bytes and the crc before sending
+void sealCameraCommand(CameraCommand& command);
+
+class CameraFrameParser {
+  public:
+    // Returns true when byte completed a valid frame, then in frame
+    bool push(uint8_t byte);
+
+    // The old processSerial input: blob centres (1000 = none) and the range [cm]
+    void toParsed(double parsed[7]) const;
+    // Blob widths [px] for RangeEstimator, the larger side of the box, 0 when not found
+    void toWidths(double widths[3]) const;
+
+    CameraFrame frame;
+    uint32_t frames = 0;          // valid frames
+    uint32_t crcErrors = 0;
+    uint32_t missedFrames = 0;    // gaps in the frame counter
+
+  private:
+    uint8_t buffer[sizeof(CameraFrame)];
+    uint8_t fill = 0;
+    bool started = false;
+};
@@ -0,0 +1,115 @@
+/*
+ DebugLog.h - leveled debug messages that never block the loop
+
+ DEBUG_ERROR(MSG_..., args) and friends copy the message id (DebugMessages.h),
+ a timestamp and the raw arguments into a fixed ring of records, nothing is
+ formatted and no String is built. Levels above DEBUG_LOG_LEVEL
+ (TeensyParams.h) compile to nothing, arguments included.
+
+ Update() is called once per loop() after the control work. It formats at
+ most DEBUG_LOG_DRAIN records and writes them to USB only while the USB
+ buffer has room for the whole line, so a slow or missing host leaves
+ records waiting in the ring instead of stalling the loop. When the ring is
+ full new records are dropped and counted. Messages at or above rosLevel
+ also go to the publish callback (the ROS log topic in main.cpp) and every
+ record is handed to the store callback as it is logged (the flight log,
+ decoded back to text by tools/flightlog_decode.py).
+
+ Not for interrupt context, log and drain from the loop only.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "DebugMessages.h"
+#include "TeensyParams.h"
+
+#define DEBUG_LEVEL_ERROR     0
+#define DEBUG_LEVEL_WARN      1
+#define DEBUG_LEVEL_INFO      2
+#define DEBUG_LEVEL_VERBOSE   3
+
+#define DEBUG_LOG_RECORDS     64    // ring size, 20 bytes each
+#define DEBUG_LOG_MAX_ARGS    3
+#define DEBUG_LOG_DRAIN       2     // records formatted per Update()
+#define DEBUG_LOG_LINE        96    // [chars] longest formatted line
+
+struct DebugRecord {
+  uint32_t timeMicros;
+  uint16_t id;            // DebugMessageId
+  uint8_t level;          // DEBUG_LEVEL_*
+  uint8_t argc;
+  uint32_t args[DEBUG_LOG_MAX_ARGS];  // int32, uint32 or float bits as the format says
+};
+
+class DebugLog {
+  public:
+    // ring holds DEBUG_LOG_RECORDS records, the firmware's is in OCRAM
+    constexpr explicit DebugLog(DebugRecord* ring) : ring(ring) {}
+
+    template<typename... Args>
+    void write(uint8_t level, DebugMessageId id, Args... args) {
+      static_assert(sizeof...(Args) <= DEBUG_LOG_MAX_ARGS, "too many debug log arguments");
+      DebugRecord r = {0, id, level, 0, {0}};
+      int unused[] = {0, (r.args[r.argc++] = word(args), 0)...};
+      (void)unused;
+      push(r);
+    }
+
+    // Drain to USB and the publish callback
+    void Update();
+
+    // Message text of record into text, returns its length
+    static int format(const DebugRecord& record, char* text, size_t size);
+    static const char* levelName(uint8_t level);
+
+    void (*publish)(const char* text) = nullptr;
+    void (*store)(const DebugRecord& record) = nullptr;
+    uint8_t rosLevel = DEBUG_LEVEL_WARN;
+    bool usb = true;
+
+    uint32_t droppedRecords = 0;
+
+  private:
+    void push(DebugRecord& record);
+
+    static uint32_t word(int v) { return (uint32_t)v; }
+    static uint32_t word(unsigned int v) { return v; }
+    static uint32_t word(long v) { return (uint32_t)v; }
+    static uint32_t word(unsigned long v) { return (uint32_t)v; }
+    static uint32_t word(bool v) { return v; }
+    static uint32_t word(double v) { return word((float)v); }
+    static uint32_t word(float v);
+
+    DebugRecord* ring;
+    uint16_t head = 0;            // next record to drain
+    uint16_t count = 0;
+    uint32_t reportedDrops = 0;
+};
+
+extern DebugLog debugLog;
+
+#if DEBUG_LOG_LEVEL >= DEBUG_LEVEL_ERROR
+#define DEBUG_ERROR(...) debugLog.write(DEBUG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define DEBUG_ERROR(...) do {} while (0)
+#endif
+
+#if DEBUG_LOG_LEVEL >= DEBUG_LEVEL_WARN
+#define DEBUG_WARN(...) debugLog.write(DEBUG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define DEBUG_WARN(...) do {} while (0)
+#endif
+
+#if DEBUG_LOG_LEVEL >= DEBUG_LEVEL_INFO
+#define DEBUG_INFO(...) debugLog.write(DEBUG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define DEBUG_INFO(...) do {} while (0)
+#endif
+
+#if DEBUG_LOG_LEVEL >= DEBUG_LEVEL_VERBOSE
+#define DEBUG_VERBOSE(...) debugLog.write(DEBUG_LEVEL_VERBOSE, __VA_ARGS__)
+#else
+#define DEBUG_VERBOSE(...) do {} while (0)
+#endif
@@ -0,0 +1,52 @@
+/*
+ DebugMessages.h - format strings of the DebugLog messages
+
+ Log calls name a message by its id, the text is only looked up when the
+ record is drained (DebugLog::Update) or decoded from a flight log
+ (tools/flightlog_decode.py reads this file). Arguments are stored as 32 bit
+ words: %d %i %c as int32, %u %x %X as uint32 and %f %g %e as float, at most
+ DEBUG_LOG_MAX_ARGS of them, no %s.
+
+ Append new messages at the end, logged records refer to them by position.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define DEBUG_MESSAGES(X) \
+  X(MSG_BOOT,              "Color tracking program started") \
+  X(MSG_STATE,             "State: %d (0 searching, 1 approach)") \
+  X(MSG_CEILING,           "Ceiling height %.1f cm") \
+  X(MSG_INVALID_STATE,     "Invalid State %d") \
+  X(MSG_AUTO_ON,           "Activating Auto Mode") \
+  X(MSG_AUTO_OFF,          "Going Manual for a Bit...") \
+  X(MSG_TARGET_COLOR,      "Target Color changed to %d (0 blue, 1 red, 2 green)") \
+  X(MSG_ROS_CONNECTED,     "Teensy connected to the ROS bridge.") \
+  X(MSG_UDP_CORRUPTED,     "UDP Message corrupted, throwing out data") \
+  X(MSG_DEBUG_DROPPED,     "Debug log dropped %u messages") \
+  X(MSG_BOOT_PHASE,        "Boot phase %u (0 setup, 1 imu, 2 control, 3 camera, 4 esp, 5 wifi, 6 ros) at %u ms") \
+  X(MSG_SENSOR_MISSING,    "BerryIMU not answering, mask 0x%x (1 LSM6DSL, 2 LIS3MDL, 4 BMP388)") \
+  X(MSG_CALIBRATION_LOADED, "Calibration loaded, gyro bias %.3f %.3f %.3f deg/s") \
+  X(MSG_CALIBRATION_REJECTED, "No stored calibration (%u: 1 blank, 2 old version, 3 corrupt)") \
+  X(MSG_CALIBRATION_STARTED, "Calibrating for %.1f s, keep the blimp still") \
+  X(MSG_CALIBRATION_MOVED, "Calibration aborted, rate %.1f deg/s") \
+  X(MSG_CALIBRATION_SAVED, "Calibration saved, gyro bias %.3f %.3f %.3f deg/s") \
+  X(MSG_CALIBRATION_SAVE_FAILED, "Calibration save failed") \
+  X(MSG_BARO_REFERENCE,    "Baro reference %.0f Pa (%u: 0 first sample, 1 stored)") \
+  X(MSG_TARGET_COLOR_INVALID, "Target Color %d ignored (0 blue, 1 red, 2 green)") \
+  X(MSG_FLIGHTLOG_NO_STORAGE, "Flight recorder: no storage found") \
+  X(MSG_FLIGHTLOG_NO_NAME, "Flight recorder: no free file name") \
+  X(MSG_FLIGHTLOG_OPEN_FAILED, "Flight recorder: could not open log file") \
+  X(MSG_FLIGHTLOG_STARTED, "Flight recorder: logging to FLT%03u.BIN") \
+  X(MSG_FLIGHTLOG_WRITE_FAILED, "Flight recorder: write failed (storage full?), stopping") \
+  X(MSG_ESP_WIFI,          "ESP connected to WiFi: %u") \
+  X(MSG_CALIBRATION_REFUSED, "Calibrate request ignored, needs manual mode with the sticks centred (state %d)") \
+  X(MSG_CALIBRATION_CANCELLED, "Calibration cancelled, left manual mode or sticks moved")
+
+enum DebugMessageId : uint16_t {
+#define DEBUG_MESSAGE_ID(id, format) id,
+  DEBUG_MESSAGES(DEBUG_MESSAGE_ID)
+#undef DEBUG_MESSAGE_ID
+  DEBUG_MESSAGE_COUNT
+};
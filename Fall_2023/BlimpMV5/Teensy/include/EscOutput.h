@@ -0,0 +1,41 @@
+/*
+ EscOutput.h - drives both brushless ESCs from hardware PWM
+
+ Replaces the Servo library for the motors: pulses come from the FlexPWM
+ timer at ESC_PROTOCOL's rate (400 Hz PWM or OneShot125) instead of 50 Hz,
+ with sub-microsecond duty resolution. On the Teensy 4.0 motor pins 6 and 9
+ (FlexPWM2 submodule 2, channels A and B) both duties are loaded in one
+ LDOK, so the two motors always change on the same PWM period. Other pin
+ pairs fall back to two analogWrite calls.
+
+ Commands are the usual 1000-2000 us throttle pulse regardless of protocol.
+ Note analogWriteResolution is global, nothing else in the firmware uses
+ analogWrite.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "TeensyParams.h"
+
+class EscOutput {
+  public:
+    void Init(int leftPin, int rightPin, int protocol);
+
+    // Throttle pulses [us], 1000-2000, written together
+    void write(float leftMicros, float rightMicros);
+
+    // Pulse actually put on the pin for a throttle command [us]
+    float pulseFor(float micros) const;
+
+    float periodMicros = 20000;
+
+  private:
+    void writeDuty(int pin, float pulseMicros);
+
+    int leftPin = -1;
+    int rightPin = -1;
+    float pulseScale = 1;
+    bool sharedSubmodule = false;
+};
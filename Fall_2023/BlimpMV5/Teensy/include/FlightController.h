@@ -0,0 +1,201 @@
+/*
+ FlightController.h - estimators, autonomous state machine and yaw rate loop
+
+ Everything between the sensor reads and MotorMapping::update lives here, so the
+ firmware loop() and the host tools (tools/replay) run the same code. Timing
+ comes from micros()/millis() and the dt handed in with each IMU sample, which
+ the host tools drive from a virtual clock.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "EMAFilter.h"
+#include "PID.h"
+#include "GainScheduledPID.h"
+#include "BlimpClock.h"
+#include "accelGCorrection.h"
+#include "baro_acc_kf.h"
+#include "gyro_ekf.h"
+#include "Madgwick_Filter.h"
+#include "TargetTracker.h"
+#include "RangeEstimator.h"
+#include "InterceptGuidance.h"
+#include "SearchPlanner.h"
+#include "CameraLink.h"
+#include "Calibration.h"
+
+enum states {
+  searching,
+  approach,
+};
+
+enum autonomousStates {
+  manual,
+  autonomous,
+  lost,
+};
+
+enum targetColors {
+  blue,
+  red,
+  green,
+};
+
+class FlightController {
+  public:
+    void Init();
+
+    // Fast loop sample, gyro in deg/s and accel in g in body axes (ImuMounting.h).
+    // Also runs the yaw heading and yaw rate loops, dt [s] is the IMU period.
+    void updateImu(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+    void updateBaro(float alt);
+    // OpenMV message: blue_x, blue_y, red_x, red_y, green_x, green_y, ceilHeight, and
+    // the blob widths [px] in the same colour order (0 = none) if the camera sends them
+    void updateCamera(const double parsed[7], const double blobWidth[3] = nullptr);
+    // What the OpenMV should look for next: the target colour only, in a window around the
+    // predicted track while there is one. Sent back on Serial2 at the outer loop rate.
+    void cameraRequest(CameraCommand& command) const;
+    // Joystick command from the base station, each in [-1,1]
+    void setManualInput(double yaw, double forward, double up);
+
+    // Runs the state machine, call once per loop()
+    void update();
+
+    // Fraction of yawPIDInput/upInput the motors delivered (MotorMapping::yawAuthority and
+    // upAuthority), 0 while they are off. Call after MotorMapping::update for the anti-windup.
+    void setActuatorAuthority(double yaw, double up);
+
+    // Sets a tunable by name (e.g. "madgwick.beta", "yawRatePID.kp"), call before Init()
+    bool setParameter(const char* name, double value);
+
+    // Stored calibration and filter state, after Init(), see Calibration.h
+    void applyCalibration(const CalibrationData& data);
+    // The calibration in use and the current filter state, baroReference untouched
+    void storeCalibration(CalibrationData& data) const;
+    // Averages the IMU for seconds with the blimp at rest. The gyro bias and accel offsets
+    // move by the mean residual and the filter biases restart from zero with their current
+    // variances. Motion above CALIBRATION_MAX_RATE aborts it.
+    void startCalibration(double seconds);
+    bool calibrating() const { return calibrationSamples > 0; }
+    void cancelCalibration() { calibrationSamples = 0; }
+    // True once after a run completed
+    bool calibrationFinished();
+    // The IMU axes were turned by trim (ImuAlignment::level): moves the gyro bias, accel
+    // offsets and restAccel into the new axes and restarts the Madgwick attitude level
+    void rotateAxes(const float trim[3][3]);
+    // New baro reference: kf height and velocity, the ceiling estimate and the hold height
+    // start again from zero
+    void zeroHeight();
+
+    //taken off the raw gyro before the estimators [deg/s]
+    float gyroBias[3] = {0, 0, 0};
+    //mean accel [g] of the last completed calibration run, for ImuAlignment::level
+    float restAccel[3] = {0, 0, 1};
+
+    //estimators
+    Madgwick_Filter madgwick;
+    BaroAccKF kf;
+    AccelGCorrection accelGCorrection;
+    GyroEKF gyroEKF;
+
+    EMAFilter yawRateFilter;
+    //pre process for accel before vertical kalman filter
+    EMAFilter verticalAccelFilter;
+
+    // PIDs
+    // cascade: heading [deg] -> yaw rate setpoint [deg/s] -> yawPIDInput, both at the IMU rate
+    GainScheduledPID yawAnglePID = GainScheduledPID(3,0,2);
+    //yawAnglePID gains over the target range, stiffer close in where the line of sight
+    //turns fastest. The far end is used without a range and while searching
+    GainPoint yawAngleSchedule[2] = {{3, 5,0,3}, {8, 3,0,2}};
+    GainScheduledPID yawRatePID = GainScheduledPID(3,0,0);
+    // altitude loop, up command per m of kf.x error and per m/s of kf.v. Holds the ceiling
+    // distance while searching and follows the guidance climb rate in approach
+    GainScheduledPID altitudePID = GainScheduledPID(200,5,400);
+
+    //tracks of all three colours, target is the selected one as of the last update()
+    TargetTracker tracker;
+    TargetTrack target;
+    //range to the selected target from its blob width
+    RangeEstimator rangeEstimator;
+    //proportional navigation in approach
+    InterceptGuidance guidance;
+    //scan and search pattern while searching
+    SearchPlanner search;
+
+    states state = searching;
+    autonomousStates autonomousState = manual;
+    targetColors targetColor = red;
+
+    //attitude from madgwick [deg]
+    float pitch = 0;
+    float yaw = 0;
+    float roll = 0;
+
+    //bias corrected yaw rate from the gyro EKF [deg/s], the rate loop feedback
+    double yawRateEstimate = 0;
+    //yawRateEstimate integrated [deg], unwrapped and only meaningful relative to itself
+    double heading = 0;
+    //held by yawAnglePID [deg]: the tracked target plus the guidance lead in approach,
+    //the search leg while searching
+    double targetHeading = 0;
+    bool headingHold = false;
+
+    // Actual
+    double ceilHeight = 500;   // [cm] rangefinder, > 400 when it has nothing
+
+    // Altitude hold: the ceiling height in the kf.x frame is learnt from kf.x plus the
+    // rangefinder distance, the setpoint is ceilingDistanceSetpoint below it. Without a
+    // ceiling fix the height at the start of the hold is kept.
+    double ceilingDistanceSetpoint = 1.3;  // [m]
+    double ceilingEstimate = NAN;          // [m] in the kf.x frame
+    EMAFilter ceilingFilter;
+    //smooths the 10 Hz altitude command, baro noise would otherwise swing the servos
+    EMAFilter upCommandFilter;
+    double upCommandAlpha = 0.1;
+    double altitudeTauD = 1;               // [s] kf.v filter in altitudePID
+    double ceilingClearance = 0.5;         // [m] closest the approach may climb to the ceiling
+    bool altitudeHold = false;
+    double altitudeSetpoint = 0;           // [m] kf.x frame, rate limited
+    double altitudeError = 0;              // [m] altitudeSetpoint - kf.x, telemetry
+
+    std::vector<double> targetDetection;
+    double targetRange = NAN;     // [m] rangeEstimator.range in approach while valid
+
+    //camera window around the predicted target [deg] each side, grows with the track age
+    double cameraRoiMargin = 12;
+    bool cameraAllColors = false;   //send all colours to the tracker instead of the target only
+
+    //outputs for MotorMapping::update
+    double forwardInput = 0;
+    double yawInput = 0;
+    double upInput = 0;
+    double yawPIDInput = 0;
+
+    //last joystick command, see setManualInput
+    double manualForward = 0;
+    double manualYaw = 0;
+    double manualUp = 0;
+
+  private:
+    BlimpClock motorClock;
+    double lastOuterLoopTime = 0;
+    double holdHeight = 0;   // [m] kf.x when the altitude hold started
+    double interceptHeight = 0;   // [m] kf.x frame, moved by guidance.climbRate
+
+    //calibration run, see startCalibration
+    int calibrationSamples = 0;     // still to collect
+    int calibrationCount = 0;
+    double calibrationGyroSum[3];   // [deg/s] bias corrected gyro
+    double calibrationAccelSum[3];  // [m/s^2] accelGCorrection residual
+    double calibrationRawSum[3];    // [g] accel as measured
+    bool calibrationDone = false;
+
+    void updateCalibration(float gx, float gy, float gz, float ax, float ay, float az);
+    void updateYawLoops(float dt);
+    void updateAltitudeHold(double dt, double heightOffset);
+    void driveAltitude(double height, double dt);
+};
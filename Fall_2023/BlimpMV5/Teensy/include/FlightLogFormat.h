@@ -0,0 +1,168 @@
+/*
+ FlightLogFormat.h - on-disk layout of the flight data recorder (see FlightRecorder.h)
+
+ A log file is a FlightLogFileHeader followed by records. Each record is a
+ FlightLogRecordHeader and a fixed-size payload selected by its type. All
+ fields are little endian, floats are IEEE-754 single precision. The sync byte
+ lets a reader skip over a damaged region. tools/flightlog_decode.py mirrors
+ these structs, keep both in step and bump FLIGHTLOG_VERSION on any change.
+*/
+
+#pragma once
+#include <stdint.h>
+
+#define FLIGHTLOG_VERSION     9
+#define FLIGHTLOG_RECORD_SYNC 0xA5
+
+struct __attribute__((packed)) FlightLogFileHeader {
+  char magic[4];          // "BLOG"
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t startMicros;   // micros() when the file was opened
+  char blimpId[16];
+};
+
+struct __attribute__((packed)) FlightLogRecordHeader {
+  uint8_t sync;           // FLIGHTLOG_RECORD_SYNC
+  uint8_t type;           // FlightLogRecordType
+  uint8_t length;         // payload bytes
+  uint32_t timeMicros;
+};
+
+enum FlightLogRecordType : uint8_t {
+  LOG_IMU = 1,
+  LOG_BARO = 2,
+  LOG_CAMERA = 3,
+  LOG_ATTITUDE = 4,
+  LOG_ALTITUDE = 5,
+  LOG_CONTROL = 6,
+  LOG_MOTOR = 7,
+  LOG_COMMAND = 8,
+  LOG_ALTITUDE_HOLD = 9,
+  LOG_GUIDANCE = 10,
+  LOG_DEBUG = 11,
+  LOG_MEMORY = 12,
+  LOG_CALIBRATION = 13,
+};
+
+// Fast loop sensor sample, as handed to the filters
+struct __attribute__((packed)) LogImu {
+  float gx, gy, gz;       // [deg/s]
+  float ax, ay, az;       // [g]
+  float dt;               // [s] time since previous fast loop
+};
+
+struct __attribute__((packed)) LogBaro {
+  float alt;              // [m] relative to the reference pressure
+  float pressure;         // [Pa]
+  float temperature;      // [deg C]
+};
+
+// OpenMV message: blue, red, green blob centres (1000 = none) and the rangefinder
+struct __attribute__((packed)) LogCamera {
+  float blobs[6];         // [px] blue_x, blue_y, red_x, red_y, green_x, green_y
+  float ceilHeight;
+  uint8_t targetColor;
+  float widths[3];        // [px] blob width per colour, 0 when not found
+};
+
+struct __attribute__((packed)) LogAttitude {
+  float roll, pitch, yaw;                 // [deg] Madgwick
+  float ekfRoll, ekfPitch, ekfYaw;        // [rad] GyroEKF
+  float ekfYawRate, ekfYawRateBias;       // [rad/s]
+};
+
+struct __attribute__((packed)) LogAltitude {
+  float x, v, a, b;       // BaroAccKF state
+  float verticalAccel;    // filtered input to updateAccel
+};
+
+struct __attribute__((packed)) LogControl {
+  uint8_t state;
+  uint8_t autonomousState;
+  float forwardInput;
+  float upInput;
+  float yawInput;         // yaw rate setpoint
+  float yawRate;          // yaw rate fed to the PID
+  float yawPIDInput;      // PID output handed to MotorMapping
+  float targetBearing, targetElevation; // selected target track [deg], 0 without one
+};
+
+struct __attribute__((packed)) LogMotor {
+  float servoR, servoL;   // [deg] filtered servo commands
+  float motorR, motorL;   // [us] ESC pulse widths
+};
+
+// Base station commands, written whenever one arrives so a replay sees the same inputs
+struct __attribute__((packed)) LogCommand {
+  uint8_t autonomousState;
+  uint8_t targetColor;
+  float yaw, forward, up; // joystick [-1,1]
+};
+
+// Altitude loop (ceiling hold while searching, guidance climb in approach), written with LOG_CONTROL
+struct __attribute__((packed)) LogAltitudeHold {
+  uint8_t active;
+  float ceilingEstimate;  // [m] ceiling in the kf.x frame, NAN before the first rangefinder fix
+  float setpoint;         // [m] kf.x frame, rate limited
+  float error;            // [m] setpoint - kf.x
+  float upCommand;        // altitudePID output before the pitch compensation
+};
+
+// Proportional navigation in approach, written with LOG_CONTROL
+struct __attribute__((packed)) LogGuidance {
+  uint8_t active;         // state == approach
+  uint8_t terminal;
+  float bearingRate;      // [deg/s] selected target line of sight rates
+  float elevationRate;
+  float leadAngle;        // [deg] heading setpoint ahead of the target azimuth
+  float pathAngle;        // [deg] commanded vertical flight path angle
+  float climbRate;        // [m/s]
+  float forward;          // forward command
+  float closingSpeed;     // [m/s] estimate
+  float range;            // [m] RangeEstimator, NAN when not valid
+  float rangeSigma;       // [m]
+  float rangeRate;        // [m/s]
+};
+
+// DebugLog message (DebugLog.h), the text is rebuilt from DebugMessages.h
+struct __attribute__((packed)) LogDebug {
+  uint16_t id;            // DebugMessageId
+  uint8_t level;          // DEBUG_LEVEL_*
+  uint8_t argc;
+  uint32_t args[3];       // raw argument words
+};
+
+// MemoryDiagnostics snapshot, with the memory ROS topic
+struct __attribute__((packed)) LogMemory {
+  uint32_t heapUsed;      // [bytes]
+  uint32_t heapPeak;
+  uint32_t heapFree;      // free inside the heap, fragmented
+  uint32_t largestFree;   // above the heap top
+  uint32_t allocations;   // total
+  float allocationRate;   // [1/s]
+  uint32_t stackUsed;     // [bytes] high-water mark
+  uint32_t stackSize;
+};
+
+// LogCalibration::event
+#define LOG_CALIBRATION_DEFAULTS  0   // boot without a stored calibration, the filters' Init() priors
+#define LOG_CALIBRATION_LOADED    1   // boot, the stored calibration was applied
+#define LOG_CALIBRATION_RUN       2   // a calibrate run finished, then rotateAxes(trim) and zeroHeight()
+#define LOG_CALIBRATION_SAVED     3   // written to EEPROM, the filters are unchanged
+
+// Calibration handed to the filters (FlightController::applyCalibration), LOG_IMU is
+// before the gyro bias so a replay needs it. Written at boot and on every change.
+struct __attribute__((packed)) LogCalibration {
+  uint8_t event;            // LOG_CALIBRATION_*
+  float gyroBias[3];        // [deg/s]
+  float accelOffset[3];     // [m/s^2]
+  float accelScale[3];
+  float gyroEKFBias[3];     // [rad/s]
+  float gyroEKFVariance[9];
+  float kfBias;             // [m/s^2]
+  float kfVariance[4];
+  float trim[3][3];         // levelling rotation applied after it, identity unless event is RUN
+  float mountAlignment[3];  // [deg] ImuAlignment after the event
+  float baroReference;      // [Pa] after the event
+};
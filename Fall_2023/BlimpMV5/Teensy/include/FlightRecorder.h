@@ -0,0 +1,57 @@
+/*
+ FlightRecorder.h - high rate binary flight data recorder
+
+ Records are copied into one of two RAM buffers. When a buffer fills up (or
+ has been open for FLIGHTLOG_SWAP_PERIOD) it is handed to Update(), which
+ writes it out in small chunks so a single call never holds the loop for
+ long. If the writer falls behind, new records are dropped and counted
+ rather than blocking. The storage is an SD card on SPI or a LittleFS
+ partition in program flash, selected with FLIGHTLOG_BACKEND in TeensyParams.h.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "FlightLogFormat.h"
+
+#define FLIGHTLOG_BUFFER_SIZE   8192
+#define FLIGHTLOG_CHUNK_SIZE    512     // bytes written per Update()
+#define FLIGHTLOG_SWAP_PERIOD   1000    // [ms] max time a record waits in RAM
+#define FLIGHTLOG_SYNC_PERIOD   5000    // [ms] file metadata flush
+
+class FlightRecorder {
+  public:
+    bool Init(const char* blimpId);
+    void Update();
+    void stop();
+
+    void write(FlightLogRecordType type, const void* payload, uint8_t length);
+
+    template<typename T>
+    void write(FlightLogRecordType type, const T& payload) {
+      static_assert(sizeof(T) <= 255, "flight log payload too large");
+      write(type, &payload, sizeof(T));
+    }
+
+    bool active = false;
+    uint32_t droppedRecords = 0;
+    uint32_t bytesWritten = 0;
+    char fileName[16];
+
+  private:
+    bool openStorage();
+    void swapBuffers();
+
+    FS* fs = nullptr;
+    File file;
+
+    static uint8_t buffers[2][FLIGHTLOG_BUFFER_SIZE];   // OCRAM, one recorder per firmware
+    uint32_t fill[2] = {0, 0};
+    uint8_t activeBuffer = 0;
+    bool pending = false;         // the other buffer is waiting to be written
+    uint32_t pendingOffset = 0;
+
+    uint32_t lastSwapMillis = 0;
+    uint32_t lastSyncMillis = 0;
+};
@@ -0,0 +1,85 @@
+#ifndef _GAIN_SCHEDULED_PID_H_
+#define _GAIN_SCHEDULED_PID_H_
+
+#define PID_SCHEDULE_POINTS 6
+
+// Gains at one value of the schedule key (e.g. forward command or distance to target)
+struct GainPoint {
+    double key;
+    double kp;
+    double ki;
+    double kd;
+};
+
+// PID with feed-forward, derivative on measurement through a first order
+// filter, back-calculation anti-windup against the output that was actually
+// applied, a setpoint rate limit and gains interpolated from a schedule.
+// Fixed size storage only, nothing is allocated after construction.
+class GainScheduledPID
+{
+    public:
+        GainScheduledPID(double kp, double ki, double kd);
+
+        void setKp(double kp);
+        void setKi(double ki);
+        void setKd(double kd);
+        // output += kff * setpoint
+        void setKff(double kff);
+        // derivative low pass time constant [s], 0 = unfiltered
+        void setDerivativeFilter(double tau);
+        // back-calculation gain [1/s], 0 = plain integration. Only bleeds the integral towards 0
+        void setTrackingGain(double kt);
+        // how fast the setpoint used by the loop may move [units/s], 0 = unlimited
+        void setSetpointRateLimit(double rate);
+        void setOutputLimits(double min, double max);
+
+        // Gains interpolated linearly over key, clamped at the ends. Points must be
+        // sorted by key. An empty schedule uses the kp/ki/kd set above.
+        bool setSchedule(const GainPoint* points, int count);
+        void setScheduleKey(double key);
+
+        // dt is the measured time since the last call [s]; 0 skips the I and D updates
+        double calculate(double setpoint, double pv, double dt, double feedForward = 0);
+        // Same, with the D term on a measured pv rate (e.g. a Kalman velocity) instead of
+        // differencing pv
+        double calculateWithRate(double setpoint, double pv, double pvRate, double dt, double feedForward = 0);
+
+        // What the actuators really delivered of the last output, e.g. after MotorMapping
+        // saturation. Feeds the back-calculation on the next calculate().
+        void setAppliedOutput(double applied);
+
+        void reset();
+
+        // last step, for telemetry
+        double setpoint = 0;
+        double error = 0;
+        double pTerm = 0;
+        double iTerm = 0;
+        double dTerm = 0;
+        double ffTerm = 0;
+        double output = 0;
+
+    private:
+        double _kp, _ki, _kd;
+        double _kff = 0;
+        double _tauD = 0;
+        double _kt = 0;
+        double _rateLimit = 0;
+        double _out_min = 0, _out_max = 0;
+        bool _limit_output = false;
+
+        GainPoint _schedule[PID_SCHEDULE_POINTS];
+        int _schedulePoints = 0;
+        double _scheduleKey = 0;
+
+        double _integral = 0;
+        double _prevPv = 0;
+        double _unsaturated = 0;
+        double _applied = 0;
+        bool _started = false;
+
+        void gains(double& kp, double& ki, double& kd);
+        double step(double target, double pv, double pvRate, bool measuredRate, double dt, double feedForward);
+};
+
+#endif
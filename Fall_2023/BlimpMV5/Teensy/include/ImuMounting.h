@@ -0,0 +1,78 @@
+/*
+ ImuMounting.h - BerryIMU sensor axes to blimp body axes, in one place
+
+ The body frame is the one the estimators expect (see FlightController.h):
+ accel z = +1 g at rest, positive yaw rate turns left. BerryIMU_v3::IMU_read
+ turns the LSM6DSL (and LIS3MDL) samples into it in two steps:
+
+ - IMU_MOUNTING (TeensyParams.h), one of the AxisMap constants below: which
+   sensor axis feeds each body axis and with which sign, applied to the raw
+   integer samples before scaling. A constexpr table entry, so the compiler
+   turns it into a few moves and negations.
+ - ImuAlignment: the small roll/pitch/yaw of the board against the body
+   left after that, stored in the calibration and turned into a matrix once.
+   Skipped while all three are zero.
+
+ The old code swapped x/y with a sign in IMU_read and then turned the result
+ by -90 deg about z in IMU_ROTATION every sample, the two together are
+ MOUNT_IDENTITY.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+struct AxisMap {
+  uint8_t axis[3];    // sensor axis read for body x, y, z
+  int8_t sign[3];
+};
+
+// Board orientation against the body, yaw counter clockwise seen from above
+constexpr AxisMap MOUNT_IDENTITY  = {{0, 1, 2}, { 1,  1,  1}};
+constexpr AxisMap MOUNT_YAW_90    = {{1, 0, 2}, {-1,  1,  1}};
+constexpr AxisMap MOUNT_YAW_180   = {{0, 1, 2}, {-1, -1,  1}};
+constexpr AxisMap MOUNT_YAW_270   = {{1, 0, 2}, { 1, -1,  1}};
+constexpr AxisMap MOUNT_ROLL_180  = {{0, 1, 2}, { 1, -1, -1}};   // upside down
+
+// A permutation with signs whose determinant is +1, a mirror image would flip the yaw rate
+constexpr bool isRotation(const AxisMap& m) {
+  return m.axis[0] < 3 && m.axis[1] < 3 && m.axis[2] < 3 &&
+         m.axis[0] != m.axis[1] && m.axis[1] != m.axis[2] && m.axis[0] != m.axis[2] &&
+         (m.sign[0] == 1 || m.sign[0] == -1) && (m.sign[1] == 1 || m.sign[1] == -1) &&
+         (m.sign[2] == 1 || m.sign[2] == -1) &&
+         // even permutations are the cyclic shifts of 0, 1, 2
+         m.sign[0]*m.sign[1]*m.sign[2]*((m.axis[1] == (m.axis[0] + 1) % 3) ? 1 : -1) == 1;
+}
+
+inline void mapAxes(const AxisMap& m, const int raw[3], int out[3]) {
+  out[0] = m.sign[0]*raw[m.axis[0]];
+  out[1] = m.sign[1]*raw[m.axis[1]];
+  out[2] = m.sign[2]*raw[m.axis[2]];
+}
+
+class ImuAlignment {
+  public:
+    // [deg] board roll, pitch and yaw to undo, rotation Rz(yaw)*Ry(pitch)*Rx(roll)
+    void set(const float angles[3]);
+    void get(float angles[3]) const { for (int i = 0; i < 3; i++) angles[i] = this->angles[i]; }
+    // Adds the roll and pitch that bring the mean accel at rest [g], measured with the
+    // current alignment, onto the body z axis. The yaw is not observable from gravity.
+    // trim is the rotation added, for what was measured in the old axes.
+    void level(const float accel[3], float trim[3][3]);
+
+    inline void apply(float& x, float& y, float& z) const {
+      if (!active) return;
+      float bx = m[0][0]*x + m[0][1]*y + m[0][2]*z;
+      float by = m[1][0]*x + m[1][1]*y + m[1][2]*z;
+      float bz = m[2][0]*x + m[2][1]*y + m[2][2]*z;
+      x = bx;
+      y = by;
+      z = bz;
+    }
+
+    bool active = false;
+
+  private:
+    float angles[3] = {0, 0, 0};
+    float m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+};
@@ -0,0 +1,73 @@
+/*
+ InterceptGuidance.h - proportional navigation for the approach state
+
+ Midcourse: the commanded heading turns at navigationGain times the line of
+ sight rate from the target track (gyro compensated, see TargetTracker). It
+ is kept as a lead angle ahead of the line of sight, lead' = (N-1) rate,
+ which decays at pursuitGain towards pure pursuit and is limited so the
+ target stays inside the camera field of view. The heading cascade in
+ FlightController turns it into the yaw rate setpoint. The vertical channel
+ does the same with the elevation and converts the flight path angle into a
+ climb rate for the altitude loop.
+
+ The forward command holds a closing speed that drops while the line of
+ sight is turning fast, so the turn can catch up instead of overshooting.
+ With a range it is scheduled from farSpeed beyond farRange down to
+ cruiseSpeed inside nearRange.
+ Closing speed comes from the range rate when a range is known and from a
+ first order model of the blimp's own speed along the line of sight
+ otherwise.
+
+ Terminal: when time to go (or, without range, the line of sight rate) says
+ the target is close, the blimp commits at forwardTerminal, the lead angles
+ are frozen and it keeps going for coastTime after the track drops, which
+ happens when the balloon fills or leaves the frame.
+*/
+
+#pragma once
+
+#include "TargetTracker.h"
+#include "TeensyParams.h"
+
+class InterceptGuidance {
+  public:
+    void Init();
+    // Call when approach starts
+    void reset(const TargetTrack& target);
+
+    // One outer loop step. range/rangeRate [m, m/s] NAN when unknown.
+    // Returns false once the target is lost for good.
+    bool update(const TargetTrack& target, double range, double rangeRate, double dt);
+
+    // outputs
+    double leadAngle = 0;      // [deg] heading setpoint minus the target azimuth
+    double pathAngle = 0;      // [deg] commanded vertical flight path angle
+    double climbRate = 0;      // [m/s] altitude loop setpoint rate
+    double forward = 0;        // forwardInput
+    double closingSpeed = 0;   // [m/s] estimate
+    bool terminal = false;
+
+    // tunables
+    double navigationGain = 3;      // N
+    double pursuitGain = 0.2;       // [1/s] lead decay towards pure pursuit
+    double maxLead = 10;            // [deg] keeps the target inside the field of view
+    double maxClimbRate = 0.2;      // [m/s]
+    double cruiseSpeed = 0.4;       // [m/s] closing speed wanted, near the target when the range is known
+    double farSpeed = 0.5;          // [m/s] beyond farRange
+    double nearRange = 3;           // [m]
+    double farRange = 8;            // [m]
+    double losRateScale = 10;       // [deg/s] line of sight rate that halves the wanted closing speed
+    double speedGain = 200;         // forwardInput per m/s of closing speed error
+    double maxForward = 250;
+    double forwardTerminal = 250;
+    double terminalTime = 3;        // [s] time to go that starts the terminal phase
+    double terminalLosRate = 12;    // [deg/s] terminal trigger without a range
+    double coastTime = 1.5;         // [s]
+
+  private:
+    double speed = 0;               // [m/s] own speed model
+    double lastBearing = 0;         // [deg] of the last valid track
+    double lastElevation = 0;
+    double verticalLead = 0;        // [deg] pathAngle minus the elevation
+    double coast = 0;               // [s] terminal time left without a track
+};
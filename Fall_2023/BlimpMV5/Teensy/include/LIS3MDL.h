@@ -1,6 +1,7 @@
 #define LIS3MDL_ADDRESS       0x1C
 
 #define LIS3MDL_WHO_AM_I      0x0F
+#define LIS3MDL_WHO_AM_I_VALUE 0x3D
 
 #define LIS3MDL_CTRL_REG1     0x20
 
@@ -2,6 +2,8 @@
 //#define LSM6DSL_ADDRESS             0x6B                                                     
 
 #define LSM6DSL_WHO_AM_I            0x0F
+#define LSM6DSL_WHO_AM_I_VALUE      0x6A
+#define LSM6DSL_STATUS_REG          0x1E   //bit 0 XLDA, bit 1 GDA: new accelerometer/gyroscope sample
 #define LSM6DSL_RAM_ACCESS          0x01
 #define LSM6DSL_CTRL1_XL            0x10
 #define LSM6DSL_CTRL6_C             0x15
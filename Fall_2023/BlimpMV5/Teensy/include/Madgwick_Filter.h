@@ -4,22 +4,27 @@
 
 #pragma once
 #include "Arduino.h"
-#include "vector"
 
 class Madgwick_Filter
 {
   public:
     void Init();
+    // Restarts level at yaw [deg], after the IMU axes were changed under it
+    void setLevel(float yaw);
     void Madgwick_Update(float gyr_rateXraw, float gyr_rateYraw, float gyr_rateZraw, float AccXraw, float AccYraw, float AccZraw);
     float roll_final;
     float pitch_final;
     float yaw_final;
 
+    //Tunable parameter, gradient descent step size
+    float beta = 0.1;
+
   private:
-    std::vector<float> update_quat(float Gyr_RateX, float Gyr_RateY, float Gyr_RateZ, float AccelX, float AccelY, float AccelZ, float q1_est, float q2_est, float q3_est, float q4_est);
-    std::vector<float> get_euler_angles_from_quat(float q1, float q2, float q3, float q4);
-    std::vector<float> q_est_orig = {1, 0, 0, 0}; //Assumed initial orientation of IMU
-    std::vector<float> q_est_g_lock = {1, 0, 0, 0}; //Another orientation just to account for gymbol lock
+    //fixed arrays, the update runs at the IMU rate and must not allocate
+    void update_quat(float Gyr_RateX, float Gyr_RateY, float Gyr_RateZ, float AccelX, float AccelY, float AccelZ, float q_est[4]);
+    void get_euler_angles_from_quat(const float q[4], float angles_euler[3]);
+    float q_est_orig[4] = {1, 0, 0, 0}; //Assumed initial orientation of IMU
+    float q_est_g_lock[4] = {1, 0, 0, 0}; //Another orientation just to account for gymbol lock
     float init_time;
     float t_interval;
 };
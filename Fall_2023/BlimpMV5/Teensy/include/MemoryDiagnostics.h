@@ -0,0 +1,61 @@
+/*
+ MemoryDiagnostics.h - heap, allocation and stack use over a flight
+
+ Heap: bytes in use and the peak from the allocator (mallinfo), the free
+ bytes left inside the heap by freed blocks (fragmentation), and the
+ untouched space between the top of the heap (sbrk) and the end of RAM2,
+ which is the largest block an allocation is sure to get.
+
+ Allocations: counted in malloc/realloc/calloc/free. On the Teensy they are
+ wrapped at link time (-Wl,--wrap=malloc... with MEMDIAG_WRAP_MALLOC in
+ platformio.ini), which covers String, std::vector and std::function through
+ operator new. On the host operator new/delete are replaced instead. With
+ forbidAllocations set, an allocation in the current thread aborts the
+ native program (SIL --forbid-allocations), on the Teensy it is counted in
+ forbiddenAllocations.
+
+ Stack: Init() paints the unused DTCM between the end of .bss and the stack
+ pointer. Update() scans a bounded number of words per call from the bottom
+ for the first one that was overwritten, the high-water mark only shows up
+ after a full pass. The host has no painted stack and reports 0.
+
+ Update() is cheap enough to call every loop(), snapshot() fills a
+ MemoryStats for the ROS topic and the flight log.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define MEMDIAG_STACK_PAINT       0xA5A5A5A5
+#define MEMDIAG_STACK_MARGIN      256     // [bytes] left unpainted below the stack pointer in Init()
+#define MEMDIAG_SCAN_WORDS        1024    // stack words checked per Update()
+
+struct MemoryStats {
+  uint32_t heapUsed;          // [bytes] allocated
+  uint32_t heapPeak;          // [bytes] largest heapUsed seen by snapshot()
+  uint32_t heapFree;          // [bytes] free inside the heap, fragmented
+  uint32_t largestFree;       // [bytes] above the heap top
+  uint32_t allocations;       // total malloc/realloc/calloc/new
+  float allocationRate;       // [1/s] since the previous snapshot()
+  uint32_t stackUsed;         // [bytes] high-water mark
+  uint32_t stackSize;         // [bytes] painted region plus what was in use at Init()
+};
+
+namespace MemoryDiagnostics {
+  void Init();
+  void Update();
+  MemoryStats snapshot();
+
+  extern std::atomic<uint32_t> allocations;
+  extern std::atomic<uint32_t> frees;
+  extern std::atomic<uint32_t> forbiddenAllocations;
+  // allocations in this thread are errors while set
+#ifdef ARDUINO
+  extern bool forbidAllocations;
+#else
+  extern thread_local bool forbidAllocations;
+#endif
+}
@@ -0,0 +1,38 @@
+/*
+ MemoryPlacement.h - where code and data live on the Teensy 4.0
+
+ RAM1 (512 KB) is shared between ITCM (code, zero wait states) and DTCM
+ (data and the stack, zero wait states) in 32 KB banks. By default the
+ Teensy 4 core copies all code to ITCM at boot and keeps all variables in
+ DTCM, so every line of cold code takes a bank away from the stack and the
+ filter state. The policy:
+
+ - HOT_CODE (FASTRUN): filter predict/update, the attitude and yaw loops,
+   PIDs, MotorMapping::update and the ESC output, everything run at the IMU
+   rate. Stays in ITCM whatever the defaults become.
+ - COLD_CODE (FLASHMEM): setup, Init and parameter parsing, run once from
+   flash through the cache.
+ - Filter state, covariances and the controller objects: plain globals and
+   members, DTCM by default. Nothing to annotate.
+ - BULK_DATA (DMAMEM): buffers only touched at low rate, the flight recorder
+   buffers, the debug log ring and the serial receive rings, in OCRAM
+   (RAM2, cached). DMAMEM is a NOLOAD section, nothing in it is zeroed or
+   initialised at boot, not even a constant initialiser. Only put raw
+   buffers there, the objects that own them stay in DTCM.
+
+ Building with PLACEMENT_HOT_IN_FLASH (env bench_teensy40_flash) moves the
+ HOT_CODE functions to flash to measure what ITCM buys, see bench/README.md.
+ tools/placement_report.py lists the regions of the linked firmware.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef PLACEMENT_HOT_IN_FLASH
+  #define HOT_CODE    FLASHMEM
+#else
+  #define HOT_CODE    FASTRUN
+#endif
+#define COLD_CODE     FLASHMEM
+#define BULK_DATA     DMAMEM
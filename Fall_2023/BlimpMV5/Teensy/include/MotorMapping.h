@@ -3,7 +3,17 @@
 #include "Servo.h"
 #include "Arduino.h"
 #include "EMAFilter.h"
+#include "EscOutput.h"
 #include "ROSHandler.h"
+#include "TeensyParams.h"
+
+//servo angles and signed motor magnitudes for one update, before filtering
+struct MotorMix {
+    float servoR;
+    float servoL;
+    float magR;
+    float magL;
+};
 
 class MotorMapping {
     public:
@@ -12,19 +22,53 @@ class MotorMapping {
     void writeLServo(double angle);
     void writeRServo(double angle);
 
+    //Slew aware allocation: motor magnitude is scaled by how well the estimated
+    //actual servo angle points the thrust, and near the 0/180 wrap the side
+    //needing less servo travel is used. 0 deg/s keeps the plain mapping.
+    void setServoSlewRate(double degPerSec, double flipMargin);
+
+    //estimated actual servo angles [deg], only tracked with a slew rate set
+    double servoREstimate = 45;
+    double servoLEstimate = 135;
+
+    //thrust vector solver behind update(), forward/up/yaw in [-500,500] and pitch in deg
+    static MotorMix mix(float pitch, float forward, float up, float yaw);
+
     EMAFilter servoRFilter;
     EMAFilter servoLFilter;
 
+    //last values written to the servos [deg] and ESCs [us]
+    double outRServo = 45;
+    double outLServo = 135;
+    double outRMotor = 1500;
+    double outLMotor = 1500;
+
+    //fraction of the last yaw/up command the motors could deliver, after the
+    //[-500,500] clamps and ESC saturation (anti-windup feedback). Servo lag is
+    //transient and left out, it would bias the integrators
+    double yawAuthority = 1;
+    double upAuthority = 1;
+
     private:
     ROSHandler* rosHandlerPtr = nullptr;
     Servo LServo;
     Servo RServo;
-    Servo LMotor;
-    Servo RMotor;
+    EscOutput motorOutput;
     double deadband;
     double turnOnCom;
     double minCom;
     double maxCom;
     
     double motorCom(double command);
+
+    double servoSlewRate = 0;
+    double servoFlipMargin = 0;
+    uint32_t lastUpdateMicros = 0;
+
+    void chooseSide(float& angle, float& mag, double estimate);
+    static double slewTowards(double estimate, double command, double maxStep);
+
+    static void solveSide(float x, float z, float pitch, float& theta, float& mag);
+    static void flipIntoRange(float& angle, float& mag);
+    static float atan2Deg(float y, float x);
 };
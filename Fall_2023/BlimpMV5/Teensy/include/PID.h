@@ -15,6 +15,9 @@ class PID
         void setOutputLimits(double min, double max);
         void setILimit(double iLimit);
         void setDLimit(double dLimit);
+        void setKp(double kp);
+        void setKi(double ki);
+        void setKd(double kd);
 
         // Returns the manipulated variable given a setpoint and current process value
         double calculate(double setpoint, double pv, double dt);
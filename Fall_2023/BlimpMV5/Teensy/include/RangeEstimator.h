@@ -0,0 +1,56 @@
+/*
+ RangeEstimator.h - monocular range to the target from its blob size
+
+ The balloon is TARGET_DIAMETER across, so its width in the image is
+ w = f D / range with f the focal length in pixels from CAMERA_HFOV. The
+ filter runs on the inverse range, which the width measures linearly, as a
+ two state (inverse range, rate) Kalman filter, the same form as a
+ TargetTracker axis. The prediction keeps a constant range rate and the
+ process noise is a white range acceleration, both mapped to the inverse
+ range. Range, its variance and the range rate are mapped back to first
+ order.
+
+ The width noise grows with the blob (segmentation at the balloon's edge).
+ Widths of blobs cut by the frame edge must not be passed in. A run of
+ measurements outside the gate, e.g. after a switch to another target,
+ restarts the filter from the measurement.
+*/
+
+#pragma once
+
+#include <math.h>
+#include "TeensyParams.h"
+
+class RangeEstimator {
+  public:
+    void Init();
+    void reset();
+
+    // One camera frame, width [px] in the QVGA image of the selected colour
+    void update(double time, double width);
+
+    // valid: updated within timeout and the relative range sigma below maxRelativeSigma
+    bool valid(double time) const;
+
+    // outputs as of the last update
+    double range = NAN;           // [m]
+    double rangeVariance = NAN;   // [m^2]
+    double rangeRate = NAN;       // [m/s], negative closing
+
+    // tunables
+    double qAccel = 0.05;         // [(m/s^2)^2 s] white range acceleration noise
+    double pixelNoise = 1.5;      // [px] width noise
+    double relativeNoise = 0.08;  // width noise per px of width
+    double gate = 16;             // chi-square, 1 dof
+    double timeout = 1;           // [s]
+    double maxRelativeSigma = 0.3;
+
+  private:
+    bool started = false;
+    double lastTime = 0;
+    double inverse = 0, inverseRate = 0;  // [1/m], [1/m/s]
+    double p00 = 0, p01 = 0, p11 = 0;
+    int outliers = 0;
+
+    void start(double z, double r);
+};
@@ -0,0 +1,71 @@
+/*
+ SearchPlanner.h - search patterns for the searching state
+
+ Every search starts with a scan, one turn in place at scanRate, towards the
+ azimuth where the target was last detected if there is one. The pattern
+ then runs from there, the first leg along that azimuth:
+
+ - SEARCH_EXPANDING_SQUARE: legs of 1, 1, 2, 2, 3, ... laneSpacing with 90 deg
+   turns, restarted with a scan once a leg would be longer than the arena.
+ - SEARCH_LAWNMOWER: lanes of arenaLength laneSpacing apart across
+   arenaWidth, then back across.
+ - SEARCH_VERTICAL_SWEEP: keeps scanning while the height offset moves down
+   through sweepDepth and back, for targets above or below the camera view.
+
+ There is no position estimate, legs are dead reckoned from the heading
+ (FlightController::heading, gyro EKF) and the modelled forward speed. The
+ altitude hold (BaroAccKF height) adds heightOffset to its setpoint.
+*/
+
+#pragma once
+
+#include "TeensyParams.h"
+
+enum searchPatterns {
+  SEARCH_EXPANDING_SQUARE,
+  SEARCH_LAWNMOWER,
+  SEARCH_VERTICAL_SWEEP,
+};
+
+class SearchPlanner {
+  public:
+    void Init();
+    // Call when searching starts. heading [deg], lastAzimuth [deg] in the
+    // same frame (TargetTracker::lastAzimuth), NAN when nothing was seen.
+    void reset(double heading, double lastAzimuth);
+
+    // One outer loop step
+    void update(double heading, double dt);
+
+    // outputs
+    bool scanning = true;      // turn at yawRate, else hold headingSetpoint
+    double yawRate = 0;        // [deg/s]
+    double headingSetpoint = 0;  // [deg]
+    double forward = 0;        // forwardInput
+    double heightOffset = 0;   // [m] added to the altitude hold setpoint, positive up
+    int leg = 0;
+
+    // tunables
+    int pattern = SEARCH_EXPANDING_SQUARE;
+    double arenaLength = 30;   // [m]
+    double arenaWidth = 20;    // [m]
+    double laneSpacing = 8;    // [m] swath the camera covers on a leg
+    double scanRate = 30;      // [deg/s]
+    double searchForward = 150;
+    double turnTolerance = 20; // [deg] heading error before moving along a leg
+    double sweepDepth = 1.5;   // [m] below the hold height
+    double sweepRate = 0.1;    // [m/s]
+
+  private:
+    double lastHeading = 0;
+    double turned = 0;         // [deg] in the current scan
+    double spinDirection = -1;
+    double baseHeading = 0;    // [deg] first leg
+    double legLength = 0;      // [m]
+    double legDistance = 0;    // [m] dead reckoned
+    double turnDirection = 1;  // +1 left
+    double speed = 0;          // [m/s] own speed model
+    double sweepDirection = -1;
+
+    void startLeg(int n);
+};
@@ -0,0 +1,90 @@
+/*
+ TargetTracker.h - constant velocity tracks of the OpenMV colour blobs
+
+ Every camera frame carries at most one blob per colour. Each blob is turned
+ into a line of sight (azimuth in the heading frame, so the blimp's own turn
+ is taken out, and elevation in the camera frame) and associated with the
+ nearest track of its colour inside a chi-square gate. Blobs outside every
+ gate start a tentative track, in the slot of the stalest tentative track
+ of the same colour (else of any colour) when all slots are in use. A track
+ is confirmed after TRACK_CONFIRM_HITS updates and deleted when it misses a
+ frame while tentative or goes without an update for timeout seconds once
+ confirmed.
+
+ Each axis is a two state (angle, rate) Kalman filter with white
+ acceleration noise, so the azimuth rate of a confirmed track is the gyro
+ compensated line of sight rate. Fixed capacity, no allocation.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "TeensyParams.h"
+
+#define TRACKER_MAX_TRACKS  6
+#define TRACKER_COLORS      3     // blue, red, green, same order as targetColors
+#define TRACK_CONFIRM_HITS  3
+
+// Line of sight to a tracked target, predicted to the query time
+struct TargetTrack {
+  bool valid = false;
+  float bearing = 0;        // [deg] relative to the current heading, positive left
+  float bearingRate = 0;    // [deg/s] line of sight rate in the heading frame
+  float elevation = 0;      // [deg] camera frame, positive up
+  float elevationRate = 0;  // [deg/s]
+  float age = 0;            // [s] since the last update
+};
+
+class TargetTracker {
+  public:
+    void Init();
+
+    // One camera frame. x/y per colour in the normalised image frame
+    // ([-1,1] across the width, y up, same scale), NAN if not seen.
+    // heading [deg] is FlightController::heading at the frame time.
+    void update(double time, double heading, const float x[TRACKER_COLORS], const float y[TRACKER_COLORS]);
+
+    // Best confirmed track of a colour, predicted to time
+    TargetTrack track(int color, double time, double heading) const;
+
+    int confirmedTracks() const;
+
+    // Azimuth [deg] (heading frame) of the last detection of a colour, NAN if never seen or
+    // not a colour. Kept after its track is deleted, the search starts towards it.
+    double lastAzimuth(int color) const {
+      return color >= 0 && color < TRACKER_COLORS ? lastDetection[color] : NAN;
+    }
+
+    float qAccel = 20;        // [(deg/s^2)^2 s] white acceleration noise
+    float rAngle = 0.5;       // [deg^2] line of sight measurement noise
+    float gate = 9.21;        // chi-square, 2 dof 99 %
+    float timeout = 2;        // [s] confirmed track kept without updates
+
+  private:
+    struct Axis {
+      float angle, rate;
+      float p00, p01, p11;
+
+      void start(float z, float r);
+      void predict(float dt, float q);
+      void correct(float z, float r);
+      float innovationVariance(float r) const { return p00 + r; }
+    };
+
+    struct Track {
+      bool used = false;
+      bool confirmed = false;
+      uint8_t color = 0;
+      uint8_t hits = 0;
+      double lastTime = 0;
+      Axis azimuth;
+      Axis elevation;
+    };
+
+    Track tracks[TRACKER_MAX_TRACKS];
+    double lastDetection[TRACKER_COLORS];
+
+    // Slot for a new track of color, -1 if all hold confirmed tracks
+    int newTrack(int color);
+};
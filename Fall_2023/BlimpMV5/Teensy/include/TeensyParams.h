@@ -9,8 +9,31 @@
 
 #define OUTERLOOP 10  //Hz
 
+#define GROUND_TEST false //no up command while searching, for testing on the ground
+
 #define HWSERIAL Serial2
 
+//extra serial buffer space in OCRAM, added to the core's small rings
+#define CAMERA_RX_BUFFER    512   //[bytes] OpenMV frames
+#define ESP_RX_BUFFER       1024  //[bytes] ROS messages from the ESP
+#define ESP_TX_BUFFER       1024  //[bytes] publishes to the ESP
+
+//motor pins
+#define LMPIN   9   //Left motor ESC
+#define RMPIN   6   //Right motor ESC
+#define LSPIN   2   //Left servo
+#define RSPIN   4   //Right servo
+
+#define MOTORMAPPING_ATAN_LUT   true  //servo angles from a 256 entry atan table instead of atan2f
+#define SERVO_SLEW_RATE         400   //[deg/s] estimated servo speed for the thrust allocation, 0 = off
+#define SERVO_FLIP_MARGIN       20    //[deg] thrust direction error accepted to save a half turn of a servo
+
+//ESC output, see EscOutput.h. OneShot125 only if the ESCs support it (BLHeli does)
+#define ESC_PROTOCOL_PWM50      0     //standard servo rate
+#define ESC_PROTOCOL_PWM400     1     //standard pulses at 400 Hz
+#define ESC_PROTOCOL_ONESHOT125 2     //125-250 us pulses at 2 kHz
+#define ESC_PROTOCOL            ESC_PROTOCOL_PWM400
+
 #define IDNAME(name) #name
 
 #define DIST_CONSTANT             0.002
@@ -23,13 +46,47 @@
 //Define ceiling height from where we plug in battery in meters
 #define CEIL_HEIGHT_FROM_START    4 
 
+//OpenMV H7 with the stock lens, blob coordinates in QVGA pixels
+#define CAMERA_HFOV               70.8  //[deg]
+#define RESOLUTION_WIDTH          320.0 //[px]
+#define RESOLUTION_HEIGHT         240.0 //[px]
+#define TARGET_DIAMETER           0.6   //[m] balloon, for the range from its blob width
+
+//no airspeed sensor, the forward speed is modelled from the forward command
+#define SPEED_PER_FORWARD         0.004 //[m/s] steady speed per unit of forwardInput
+#define SPEED_TAU                 3.0   //[s] speed response to the forward command
+
 //sensor and controller rates
 #define FAST_SENSOR_LOOP_FREQ           100.0
-#define BARO_LOOP_FREQ                  50.0
+#define BARO_LOOP_FREQ                  50.0  //BMP388 data ready polled this often
+#define BARO_ODR_FREQ                   25.0  //BMP388 output data rate, ODR in BerryIMU_v3::Init
+#define BARO_TEMP_DECIMATION            25    //baro samples per temperature compensation (1 s)
+#define CALIBRATION_SECONDS             5.0   //[s] IMU averaged at rest by the calibrate command
+#define CALIBRATION_MAX_RATE            3.0   //[deg/s] gyro rate that aborts a calibration as moved
+#define BARO_REFERENCE_TOLERANCE        120.0 //[Pa] stored ground pressure used only this close to the first sample (~10 m)
+#define IMU_BOOT_SETTLE                 70    //[ms] after the IMU is configured before its samples reach the filters (gyro turn-on)
+
+//BerryIMU orientation on the gondola, an AxisMap from ImuMounting.h. The fine
+//alignment left after it comes from the calibration.
+#define IMU_MOUNTING                    MOUNT_IDENTITY
 
 //constants
 #define MICROS_TO_SEC             1000000.0
 
+//flight data recorder (see FlightRecorder.h), decode with tools/flightlog_decode.py
+#define FLIGHTLOG_ENABLED               true
+#define FLIGHTLOG_BACKEND_SD            1     //SD card on SPI, needed for full flights
+#define FLIGHTLOG_BACKEND_LITTLEFS      2     //program flash, only ~1 minute at full rate
+#define FLIGHTLOG_BACKEND               FLIGHTLOG_BACKEND_SD
+#define FLIGHTLOG_SD_CS_PIN             10
+#define FLIGHTLOG_LITTLEFS_SIZE         (1024*1024)
+#define FLIGHTLOG_STATE_DECIMATION      1     //log filter/control/motor state every Nth fast loop
+
+//debug messages (see DebugLog.h), higher levels are compiled out
+#ifndef DEBUG_LOG_LEVEL
+#define DEBUG_LOG_LEVEL                 2     //0 error, 1 warn, 2 info, 3 verbose
+#endif
+
 /* New Attack Blimp Params */
 
 // Define subscription topic names
@@ -38,6 +95,8 @@
 #define MULTIARRAY_TOPIC    "motorCommands"     // For motor commands subscription - type: Float64MultiArray
 #define AUTO_TOPIC          "auto"              // For autonomous state subscription - type: Bool
 #define COLOR_TOPIC         "target_color"      // For autonomous state subscription - type: Bool
+#define MEMORY_TOPIC        "memory_request"    // Publish the memory report now - type: Bool
+#define CALIBRATE_TOPIC     "calibrate"         // true: calibrate at rest and save, false: save the filter state - type: Bool
 
 // Define Published topic names
 
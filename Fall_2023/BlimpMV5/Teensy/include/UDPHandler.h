@@ -16,6 +16,7 @@ class UDPHandler{
 
     private:
         void callback_SerialRecvMsg(String message);
+        void SendConnectionData();
         
         String StringLength(String variable, unsigned int numDigits);
 
@@ -41,6 +42,7 @@ class UDPHandler{
 
         // ========== Variables ==========
         SerialHandler serialHandler;
+        bool espConnected = false;      // last status the ESP reported, logged on change
 };
 
 
@@ -16,6 +16,10 @@ class AccelGCorrection {
     float agy = 0;
     float agz = 0;
 
+    //a = raw*9.81*scale + offset [m/s^2] with z flipped, see Calibration.h
+    float offset[3] = {0.0081, 0.0014, 0.1672};
+    float scale[3] = {1, 1, 1};
+
     private:
     Matrix<3,1> g = {0,0,-9.81};
 };
\ No newline at end of file
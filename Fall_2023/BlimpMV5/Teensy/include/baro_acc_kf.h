@@ -9,11 +9,25 @@ class BaroAccKF {
   void predict(float dt);
   void updateBaro(float baro);
   void updateAccel(float acc);
+  //after Init(): accel and bias states from a stored bias, their variances from the
+  //stored diagonal, height and velocity keep their prior (see Calibration.h)
+  void warmStart(float bias, const float variance[4]);
+  void getState(float& bias, float variance[4]) const;
+  //height and velocity to zero, e.g. with a new baro reference
+  void resetHeight();
   float x;
   float v;
   float a;
   float b;
 
+  //noise parameters, applied by Init()
+  float qPos = 0.001;
+  float qVel = 0.01;
+  float qAcc = 0.1;
+  float qBias = 0;
+  float rBaro = 0.36;
+  float rAccel = 0.001;
+
   private:
   Matrix<4,1> Xkp;
   Matrix<4,4> Pkp;
@@ -9,6 +9,10 @@ class GyroEKF {
     void predict(float dt);
     void updateGyro(float gyrox, float gyroy, float gyroz);
     void updateAccel(float accx, float accy, float accz);
+    //after Init(): rate and bias states from a stored bias, their variances from the stored
+    //diagonal, the attitude keeps its prior (see Calibration.h)
+    void warmStart(const float bias[3], const float variance[9]);
+    void getState(float bias[3], float variance[9]) const;
 
     float roll = 0;
     float pitch = 0;
@@ -20,6 +24,16 @@ class GyroEKF {
     float pitchRateB = 0;
     float yawRateB = 0;
 
+    //noise parameters, applied by Init()
+    float qAngle = 0.000001;
+    float qRate = 0.0001;
+    float qBias = 0;
+    float rGyro = 0.01;
+    float rAccel = 0.01;
+    //initial gyro bias variance [(rad/s)^2], about (1 deg/s)^2. The yaw bias is
+    //barely observable through the accel angles, a loose prior lets it wander
+    float pBias = 0.0003;
+
     private:
     Matrix<9,1> Xkp;
     Matrix<9,9> Qkp;
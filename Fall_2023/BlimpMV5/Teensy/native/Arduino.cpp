@@ -0,0 +1,180 @@
+/*
+ Arduino.cpp - host stand-in for the Teensyduino core (see Arduino.h)
+*/
+
+#include "Arduino.h"
+#include <stdarg.h>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+static thread_local uint64_t virtualMicros = 0;
+
+void nativeClock::setMicros(uint64_t now) {
+    virtualMicros = now;
+}
+
+void nativeClock::advanceMicros(uint64_t delta) {
+    virtualMicros += delta;
+}
+
+uint64_t nativeClock::nowMicros() {
+    return virtualMicros;
+}
+
+uint32_t micros() {
+    return (uint32_t)virtualMicros;
+}
+
+uint32_t millis() {
+    return (uint32_t)(virtualMicros / 1000);
+}
+
+void delay(uint32_t ms) {
+    virtualMicros += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(uint32_t us) {
+    virtualMicros += us;
+}
+
+void yield() {
+}
+
+// ========== PWM ==========
+
+struct PwmPin {
+    float frequency = 488.28;   // Teensy 4 default
+    float duty = 0;             // [0,1]
+    bool written = false;
+};
+
+static thread_local PwmPin pwmPins[NATIVE_MAX_PINS];
+static thread_local uint32_t pwmResolution = 8;
+
+void analogWriteFrequency(uint8_t pin, float frequency) {
+    if (pin < NATIVE_MAX_PINS) pwmPins[pin].frequency = frequency;
+}
+
+uint32_t analogWriteResolution(uint32_t bits) {
+    uint32_t previous = pwmResolution;
+    pwmResolution = constrain(bits, 1u, 16u);
+    return previous;
+}
+
+void analogWrite(uint8_t pin, int value) {
+    if (pin >= NATIVE_MAX_PINS) return;
+    float full = (float)(1u << pwmResolution);
+    pwmPins[pin].duty = constrain(value, 0, (int)full) / full;
+    pwmPins[pin].written = true;
+}
+
+float nativePins::frequency(uint8_t pin) {
+    return pin < NATIVE_MAX_PINS ? pwmPins[pin].frequency : 0;
+}
+
+float nativePins::pulseMicroseconds(uint8_t pin) {
+    if (pin >= NATIVE_MAX_PINS || !pwmPins[pin].written) return 0;
+    return pwmPins[pin].duty * 1000000.0f / pwmPins[pin].frequency;
+}
+
+// ========== HardwareSerial ==========
+
+int HardwareSerial::read() {
+    if (rxBuffer.empty()) return -1;
+    uint8_t c = rxBuffer.front();
+    rxBuffer.pop_front();
+    return c;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+    if (echo != nullptr) fwrite(buf, 1, len, echo);
+    if (capture) txBuffer.append((const char*)buf, len);
+    return len;
+}
+
+int HardwareSerial::printf(const char* format, ...) {
+    char buff[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buff, sizeof(buff), format, args);
+    va_end(args);
+    if (n > 0) write((const uint8_t*)buff, n < (int)sizeof(buff) ? n : sizeof(buff) - 1);
+    return n;
+}
+
+void HardwareSerial::inject(const uint8_t* buf, size_t len) {
+    rxBuffer.insert(rxBuffer.end(), buf, buf + len);
+}
+
+// ========== String ==========
+
+static std::string integerToString(unsigned long long value, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char buff[72];
+    int i = sizeof(buff) - 1;
+    buff[i] = '\0';
+    do {
+        int digit = value % base;
+        buff[--i] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value != 0);
+    if (negative) buff[--i] = '-';
+    return std::string(&buff[i]);
+}
+
+String::String(long value, unsigned char base) : String((long long)value, base) {}
+
+String::String(unsigned long value, unsigned char base) : String((unsigned long long)value, base) {}
+
+String::String(long long value, unsigned char base) {
+    bool negative = (value < 0 && base == 10);
+    unsigned long long magnitude = negative ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    str = integerToString(magnitude, negative, base);
+}
+
+String::String(unsigned long long value, unsigned char base) {
+    str = integerToString(value, false, base);
+}
+
+String::String(double value, unsigned char decimals) {
+    char buff[64];
+    snprintf(buff, sizeof(buff), "%.*f", decimals, value);
+    str = buff;
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, str.length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+    if (beginIndex >= str.length()) return String();
+    if (endIndex > str.length()) endIndex = str.length();
+    return String(str.substr(beginIndex, endIndex - beginIndex));
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+    size_t index = str.find(c, fromIndex);
+    return index == std::string::npos ? -1 : (int)index;
+}
+
+int String::indexOf(const String& s, unsigned int fromIndex) const {
+    size_t index = str.find(s.str, fromIndex);
+    return index == std::string::npos ? -1 : (int)index;
+}
+
+void String::trim() {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        str.clear();
+        return;
+    }
+    size_t last = str.find_last_not_of(" \t\r\n");
+    str = str.substr(first, last - first + 1);
+}
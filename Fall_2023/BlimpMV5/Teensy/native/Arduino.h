@@ -0,0 +1,125 @@
+/*
+ Arduino.h - host stand-in for the parts of the Teensyduino core used by the
+ firmware, so the estimators and controllers can be built by the native
+ PlatformIO environments (benchmarks and host tools).
+
+ Time is virtual: micros()/millis() only move when a host tool advances them
+ with nativeClock::advanceMicros(). The clock is per thread so independent
+ runs can share a process.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <cmath>
+#include <string>
+#include <deque>
+#include <algorithm>
+
+#include "WString.h"
+
+typedef uint8_t byte;
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define F_CPU 600000000
+
+// Section attributes of the Teensy 4 core, the host has one flat memory
+#define FASTRUN
+#define FLASHMEM
+#define DMAMEM
+#define PROGMEM
+
+namespace nativeClock {
+    void setMicros(uint64_t now);
+    void advanceMicros(uint64_t delta);
+    uint64_t nowMicros();
+}
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+inline double pow10(double x) { return pow(10.0, x); }
+
+// PWM outputs. Frequency and duty are kept per pin (and per thread, like the
+// clock) so host tools can read back the pulse a pin is driving.
+#define NATIVE_MAX_PINS 64
+void analogWriteFrequency(uint8_t pin, float frequency);
+uint32_t analogWriteResolution(uint32_t bits);
+void analogWrite(uint8_t pin, int value);
+
+namespace nativePins {
+    // High time of the PWM on pin [us], 0 if never written
+    float pulseMicroseconds(uint8_t pin);
+    float frequency(uint8_t pin);
+}
+
+// Byte-stream port backed by in-memory buffers. Host tools inject received
+// bytes with inject() and inspect what the firmware wrote through tx().
+class HardwareSerial {
+    public:
+        void begin(unsigned long baud) { (void)baud; }
+        void end() {}
+        void addMemoryForRead(void* buffer, size_t size) { (void)buffer; (void)size; }
+        void addMemoryForWrite(void* buffer, size_t size) { (void)buffer; (void)size; }
+        int available() { return (int)rxBuffer.size(); }
+        int availableForWrite() { return 1024; }
+        int peek() { return rxBuffer.empty() ? -1 : rxBuffer.front(); }
+        int read();
+        void flush() {}
+        explicit operator bool() const { return true; }
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t* buf, size_t len);
+        size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+        size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+        size_t print(const char* s) { return write(s); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(int n) { return print(String(n)); }
+        size_t print(unsigned int n) { return print(String(n)); }
+        size_t print(long n) { return print(String(n)); }
+        size_t print(unsigned long n) { return print(String(n)); }
+        size_t print(long long n) { return print(String(n)); }
+        size_t print(unsigned long long n) { return print(String(n)); }
+        size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+
+        template<typename T>
+        size_t println(const T& v) { size_t n = print(v); return n + write("\r\n"); }
+        size_t println(double v, int digits) { size_t n = print(v, digits); return n + write("\r\n"); }
+        size_t println() { return write("\r\n"); }
+
+        int printf(const char* format, ...);
+
+        // Host side
+        void inject(const uint8_t* buf, size_t len);
+        void inject(const char* str) { inject((const uint8_t*)str, strlen(str)); }
+        void setEcho(FILE* stream) { echo = stream; }
+        void setCapture(bool enabled) { capture = enabled; }
+        std::string& tx() { return txBuffer; }
+
+    private:
+        std::deque<uint8_t> rxBuffer;
+        std::string txBuffer;
+        FILE* echo = nullptr;
+        bool capture = false;
+};
+
+typedef HardwareSerial usb_serial_class;
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
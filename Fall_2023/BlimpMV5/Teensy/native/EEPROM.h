@@ -0,0 +1,46 @@
+/*
+ EEPROM.h - host stand-in for the Teensy EEPROM library, an erased (0xFF)
+ block of E2END + 1 bytes in memory, kept per thread like the virtual clock
+ so parallel host runs don't share it.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define E2END 0x437
+
+class EEPROMClass {
+    public:
+        uint8_t read(int index) { return bytes()[index]; }
+        void write(int index, uint8_t value) { bytes()[index] = value; }
+        void update(int index, uint8_t value) { bytes()[index] = value; }
+        uint16_t length() { return E2END + 1; }
+
+        template<typename T> T& get(int index, T& t) {
+            memcpy(&t, bytes() + index, sizeof(T));
+            return t;
+        }
+
+        template<typename T> const T& put(int index, const T& t) {
+            memcpy(bytes() + index, &t, sizeof(T));
+            return t;
+        }
+
+        // Back to the erased state
+        void erase() { memset(bytes(), 0xFF, E2END + 1); }
+
+    private:
+        static uint8_t* bytes() {
+            static thread_local uint8_t storage[E2END + 1];
+            static thread_local bool erased = false;
+            if (!erased) {
+                memset(storage, 0xFF, sizeof(storage));
+                erased = true;
+            }
+            return storage;
+        }
+};
+
+static EEPROMClass EEPROM;
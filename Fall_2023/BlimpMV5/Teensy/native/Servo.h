@@ -0,0 +1,48 @@
+/*
+ Servo.h - host stand-in for the Teensy Servo library. Writes are recorded so
+ host tools can read back the commanded angle or pulse width, per object or
+ per pin (servoPinMicroseconds, kept per thread like the virtual clock).
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define SERVO_MAX_PINS 64
+
+// Last pulse width written to each pin by this thread [us], 0 if never written
+inline int* servoPinMicroseconds() {
+    static thread_local int pins[SERVO_MAX_PINS] = {0};
+    return pins;
+}
+
+class Servo {
+    public:
+        uint8_t attach(int newPin) { pin = newPin; return 1; }
+        uint8_t attach(int newPin, int newMin, int newMax) { minUs = newMin; maxUs = newMax; return attach(newPin); }
+        void detach() { pin = -1; }
+        bool attached() { return pin >= 0; }
+
+        // Values below 200 are angles in degrees, anything else is a pulse width in microseconds
+        void write(int value) {
+            if (value < 200) {
+                if (value < 0) value = 0;
+                if (value > 180) value = 180;
+                us = minUs + (maxUs - minUs) * value / 180;
+            } else {
+                us = value;
+            }
+            publish();
+        }
+        void writeMicroseconds(int value) { us = value; publish(); }
+        int read() { return (us - minUs) * 180 / (maxUs - minUs); }
+        int readMicroseconds() { return us; }
+
+    private:
+        void publish() { if (pin >= 0 && pin < SERVO_MAX_PINS) servoPinMicroseconds()[pin] = us; }
+
+        int pin = -1;
+        int minUs = 544;
+        int maxUs = 2400;
+        int us = 1500;
+};
@@ -0,0 +1,84 @@
+/*
+ WString.h - host stand-in for the Arduino String class, backed by std::string.
+ Only the members the firmware uses are provided.
+*/
+
+#pragma once
+
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
+
+class String {
+    public:
+        String() {}
+        String(const char* cstr) : str(cstr ? cstr : "") {}
+        String(const std::string& s) : str(s) {}
+        explicit String(char c) : str(1, c) {}
+        explicit String(unsigned char value, unsigned char base = 10) : String((unsigned long)value, base) {}
+        explicit String(int value, unsigned char base = 10) : String((long)value, base) {}
+        explicit String(unsigned int value, unsigned char base = 10) : String((unsigned long)value, base) {}
+        explicit String(long value, unsigned char base = 10);
+        explicit String(unsigned long value, unsigned char base = 10);
+        explicit String(long long value, unsigned char base = 10);
+        explicit String(unsigned long long value, unsigned char base = 10);
+        explicit String(float value, unsigned char decimals = 2) : String((double)value, decimals) {}
+        explicit String(double value, unsigned char decimals = 2);
+
+        unsigned int length() const { return str.length(); }
+        const char* c_str() const { return str.c_str(); }
+        char charAt(unsigned int index) const { return index < str.length() ? str[index] : 0; }
+        void setCharAt(unsigned int index, char c) { if (index < str.length()) str[index] = c; }
+        char operator[](unsigned int index) const { return charAt(index); }
+        char& operator[](unsigned int index) { return str[index]; }
+        char* begin() { return &str[0]; }
+        char* end() { return &str[0] + str.length(); }
+        const char* begin() const { return str.data(); }
+        const char* end() const { return str.data() + str.length(); }
+
+        String substring(unsigned int beginIndex) const;
+        String substring(unsigned int beginIndex, unsigned int endIndex) const;
+        int indexOf(char c, unsigned int fromIndex = 0) const;
+        int indexOf(const String& s, unsigned int fromIndex = 0) const;
+        bool startsWith(const String& prefix) const { return str.compare(0, prefix.str.length(), prefix.str) == 0; }
+        bool equals(const String& s) const { return str == s.str; }
+        void trim();
+        void reserve(unsigned int size) { str.reserve(size); }
+        void remove(unsigned int index) { if (index < str.length()) str.erase(index); }
+        void remove(unsigned int index, unsigned int count) { if (index < str.length()) str.erase(index, count); }
+
+        long toInt() const { return atol(str.c_str()); }
+        float toFloat() const { return (float)atof(str.c_str()); }
+        double toDouble() const { return atof(str.c_str()); }
+
+        bool concat(const String& s) { str += s.str; return true; }
+        String& operator+=(const String& s) { str += s.str; return *this; }
+        String& operator+=(const char* s) { str += s; return *this; }
+        String& operator+=(char c) { str += c; return *this; }
+        String& operator+=(int v) { return *this += String(v); }
+        String& operator+=(unsigned int v) { return *this += String(v); }
+        String& operator+=(long v) { return *this += String(v); }
+        String& operator+=(unsigned long v) { return *this += String(v); }
+        String& operator+=(double v) { return *this += String(v); }
+
+        bool operator==(const String& s) const { return str == s.str; }
+        bool operator==(const char* s) const { return str == s; }
+        bool operator!=(const String& s) const { return str != s.str; }
+        bool operator!=(const char* s) const { return str != s; }
+        bool operator<(const String& s) const { return str < s.str; }
+
+    private:
+        std::string str;
+};
+
+inline String operator+(const String& lhs, const String& rhs) { String s(lhs); s += rhs; return s; }
+inline String operator+(const String& lhs, const char* rhs) { String s(lhs); s += rhs; return s; }
+inline String operator+(const char* lhs, const String& rhs) { String s(lhs); s += rhs; return s; }
+inline String operator+(char lhs, const String& rhs) { String s(lhs); s += rhs; return s; }
+inline String operator+(const String& lhs, char rhs) { String s(lhs); s += rhs; return s; }
+inline String operator+(const String& lhs, int rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, unsigned int rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, long rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, unsigned long rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, float rhs) { return lhs + String(rhs); }
+inline String operator+(const String& lhs, double rhs) { return lhs + String(rhs); }
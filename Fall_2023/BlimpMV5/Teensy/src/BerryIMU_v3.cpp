@@ -7,14 +7,29 @@
 #include "LSM6DSL.h"
 #include "LIS3MDL.h"
 #include "BM388.h"
-#include <BasicLinearAlgebra.h>
-#include <ElementStorage.h>
+#include "TeensyParams.h"
+#include "DebugLog.h"
+#include "BaroAltitude.h"
 
-void BerryIMU_v3::Init(){
+static_assert(isRotation(IMU_MOUNTING), "IMU_MOUNTING must be a rotation, not a mirror image");
+
+bool BerryIMU_v3::Init(){
   Wire.begin();        // Initialise i2c
   Wire.setClock(400000);  //Change i2c bus speed to 400kHz
   //Serial.begin(115200); Start serial for output set to 115200 Baud Rate
   ref_pressure_found = true;
+  tempCountdown = 0;
+
+  //The sensors answer a few ms after power-up, poll their ids instead of waiting a fixed time
+  sensorsMissing = BERRYIMU_LSM6DSL | BERRYIMU_LIS3MDL | BERRYIMU_BMP388;
+  uint32_t probeStart = millis();
+  while (sensorsMissing != 0) {
+    if ((sensorsMissing & BERRYIMU_LSM6DSL) && probe(LSM6DSL_ADDRESS, LSM6DSL_WHO_AM_I, LSM6DSL_WHO_AM_I_VALUE)) sensorsMissing &= ~BERRYIMU_LSM6DSL;
+    if ((sensorsMissing & BERRYIMU_LIS3MDL) && probe(LIS3MDL_ADDRESS, LIS3MDL_WHO_AM_I, LIS3MDL_WHO_AM_I_VALUE)) sensorsMissing &= ~BERRYIMU_LIS3MDL;
+    if ((sensorsMissing & BERRYIMU_BMP388) && probe(BM388_ADDRESS, CHIP_ID, CHIP_ID_VALUE)) sensorsMissing &= ~BERRYIMU_BMP388;
+    if (sensorsMissing == 0 || millis() - probeStart >= BERRYIMU_PROBE_TIMEOUT) break;
+    delayMicroseconds(500);
+  }
 
   //Initialize the accelerometer
   //LSM6DSL_CTRL1_XL is the linear acceleration sensor control register 1
@@ -132,6 +147,18 @@ void BerryIMU_v3::Init(){
   PAR_P11 = NVM_PAR_P11_val / pow(2, 65);
 
   //**********************************************************************************************************************************************************
+  configuredMillis = millis();
+  return sensorsMissing == 0;
+}
+
+void BerryIMU_v3::setStoredReference(float pressure){
+  storedReference = pressure;
+}
+
+bool BerryIMU_v3::dataReady(){
+  byte status = 0;
+  readFrom(LSM6DSL_ADDRESS, LSM6DSL_STATUS_REG, 1, &status);
+  return (status & 0b11) == 0b11;
 }
 
 void BerryIMU_v3::IMU_read(){
@@ -161,10 +188,15 @@ void BerryIMU_v3::IMU_read(){
   //  AccYraw = (accRaw[1]* 0.122)/1000;
   //  AccZraw = (accRaw[2]* 0.122)/1000;
 
+  //Sensor to body axes on the integers, IMU_MOUNTING is a constant
+  int acc[3];
+  mapAxes(IMU_MOUNTING, accRaw, acc);
+
   //Convert Accel raw to G's when FS is +/- 8g
-  AccYraw = (accRaw[0] * 0.244) / 1000.0;
-  AccXraw = -(accRaw[1] * 0.244) / 1000.0;
-  AccZraw = (accRaw[2] * 0.244) / 1000.0;
+  AccXraw = (acc[0] * 0.244) / 1000.0;
+  AccYraw = (acc[1] * 0.244) / 1000.0;
+  AccZraw = (acc[2] * 0.244) / 1000.0;
+  alignment.apply(AccXraw, AccYraw, AccZraw);
 
   // Serial.print("\nIMU Data: \n");
   // Serial.print(AccXraw);
@@ -188,6 +220,7 @@ void BerryIMU_v3::IMU_read(){
   if (magRaw[0] >= 32768) magRaw[0] = magRaw[0] - 65536;
   if (magRaw[1] >= 32768) magRaw[1] = magRaw[1] - 65536;
   if (magRaw[2] >= 32768) magRaw[2] = magRaw[2] - 65536;
+  //still in sensor axes, map with IMU_MOUNTING when the magnetometer is fused
 
   //---------------------------------------------------------------------------------------
   //Gyroscope Output
@@ -199,91 +232,54 @@ void BerryIMU_v3::IMU_read(){
   if (gyrRaw[1] >= 32768) gyrRaw[1] = gyrRaw[1] - 65536;
   if (gyrRaw[2] >= 32768) gyrRaw[2] = gyrRaw[2] - 65536;
 
+  int gyr[3];
+  mapAxes(IMU_MOUNTING, gyrRaw, gyr);
+
   //Convert Gyro raw to degrees per second updated (deg/s)
-  gyr_rateYraw = (gyrRaw[0] * 70) / 1000.0;
-  gyr_rateXraw = -(gyrRaw[1] * 70) / 1000.0;
-  gyr_rateZraw = (gyrRaw[2] * 70) / 1000.0;
+  gyr_rateXraw = (gyr[0] * 70) / 1000.0;
+  gyr_rateYraw = (gyr[1] * 70) / 1000.0;
+  gyr_rateZraw = (gyr[2] * 70) / 1000.0;
+  alignment.apply(gyr_rateXraw, gyr_rateYraw, gyr_rateZraw);
 
   //---------------------------------------------------------------------------------------
-  //Barometer and Temperature Sensor Output
-  //Starts with the PRESS_XLSB_7_0 output register then will read the remainig five
-  readFrom(BM388_ADDRESS, PRESS_XLSB_7_0, 6, buff);
+}
 
-  // Last 3 bytes are the temperature XLSB, LSB, MSB
-  float tempRaw = (int)(buff[3] | (buff[4] << 8) | (buff[5] << 16));
-  comp_temp = temp_compensation(tempRaw);
-  //Serial.println(comp_temp); //Temperature in deg C
+bool BerryIMU_v3::baroRead(){
+  //Only when the BMP388 has a new pressure, reading it again would hand the filter a duplicate
+  byte status = 0;
+  readFrom(BM388_ADDRESS, BM388_STATUS, 1, &status);
+  if ((status & BM388_DRDY_PRESS) == 0) return false;
+
+  //Starts with the PRESS_XLSB_7_0 output register, the temperature follows in the next three
+  //The temperature moves slowly, only read and compensate it every BARO_TEMP_DECIMATION samples
+  bool tempDue = --tempCountdown <= 0;
+  readFrom(BM388_ADDRESS, PRESS_XLSB_7_0, tempDue ? 6 : 3, buff);
+
+  if (tempDue) {
+    // Last 3 bytes are the temperature XLSB, LSB, MSB
+    float tempRaw = (int)(buff[3] | (buff[4] << 8) | (buff[5] << 16));
+    comp_temp = temp_compensation(tempRaw); //Temperature in deg C
+    temperature_coefficients(comp_temp);
+    tempCountdown = BARO_TEMP_DECIMATION;
+  }
 
   // First 3 bytes are the pressure XLSB, LSB, MSB
-  // Bit shift done by 256^3 = 16777216 and 16777216/3 = 5592405
   float pressRaw = (int)(buff[0] | (buff[1] << 8) | (buff[2] << 16));
-  comp_press = press_compensation(pressRaw, comp_temp);
-  //Serial.println(comp_press); //Pressure in Pa
+  comp_press = press_compensation(pressRaw); //Pressure in Pa
 
-  //Altitude (in meters)
-  //https://www.circuitbasics.com/set-bmp180-barometric-pressure-sensor-arduino/
   //Sets the reference pressure (therefore setting the reference height)
+  //A stored ground pressure keeps the height frame across a reboot, unless the weather or the site changed
   if(ref_pressure_found){
-    ref_ground_press = comp_press;
+    bool useStored = storedReference > 0 && fabs(comp_press - storedReference) < BARO_REFERENCE_TOLERANCE;
+    ref_ground_press = useStored ? storedReference : comp_press;
     ref_pressure_found = false;
+    DEBUG_INFO(MSG_BARO_REFERENCE, ref_ground_press, (unsigned int)useStored);
   }
-  alt = 44330 * (1 - pow((comp_press / ref_ground_press), (1 / 5.255))); //In meters
-
-  //---------------------------------------------------------------------------------------
-}
-
-void BerryIMU_v3::IMU_Flip_Axis()
-{
-  //Raw member variable format
-  //Y = 0
-  //X = 1
-  //Z = 2
-  float temp = 0;
-
-  temp = accRaw[0];
-  accRaw[0] = accRaw[1];
-  accRaw[1] = -temp;
-
-  temp = gyrRaw[0];
-  gyrRaw[0] = gyrRaw[1];
-  gyrRaw[1] = -temp;
-
-  temp = magRaw[0];
-  magRaw[0] = magRaw[1];
-  magRaw[1] = -temp;
-
-  temp = this->AccYraw;
-  this->AccYraw = this->AccXraw;
-  this->AccXraw = -temp;
-
-  temp = this->gyr_rateYraw;
-  this->gyr_rateYraw = this->gyr_rateXraw;
-  this->gyr_rateXraw = -temp;
+  //Altitude (in meters), the barometric formula without pow, see BaroAltitude.h
+  alt = baroAltitude(comp_press, ref_ground_press);
+  return true;
 }
 
-void BerryIMU_v3::IMU_ROTATION(float rotation_angle){  //current: -90 degrees
-      BLA::Matrix<3, 3> Rz = {cosf(rotation_angle/180*PI),-sinf(rotation_angle/180*PI),0,
-                              sinf(rotation_angle/180*PI),cosf(rotation_angle/180*PI),0,
-                              0,0,1}; // 3X3 Matrix
-      BLA::Matrix<3, 1> gyr_rate= {gyr_rateXraw,
-                                   gyr_rateYraw,
-                                   gyr_rateZraw};
-      BLA::Matrix<3, 1> Acc_raw = {AccXraw,
-                                   AccYraw,
-                                   AccZraw};
-      BLA::Matrix<3, 1> corrected_gyr_rate = Rz*gyr_rate;
-      BLA::Matrix<3, 1> corrected_Acc_raw = Rz*Acc_raw;
-
-      this->AccXraw = corrected_Acc_raw(0);
-      this->AccYraw = corrected_Acc_raw(1);
-      this->AccZraw = corrected_Acc_raw(2);
-
-      this->gyr_rateXraw = corrected_gyr_rate(0);
-      this->gyr_rateYraw = corrected_gyr_rate(1);
-      this->gyr_rateZraw = corrected_gyr_rate(2);
-}
-
-
 float BerryIMU_v3::temp_compensation(float raw_temperature) {
   float partial_data1 = raw_temperature - PAR_T1;
   float partial_data2 = partial_data1 * PAR_T2;
@@ -291,21 +287,18 @@ float BerryIMU_v3::temp_compensation(float raw_temperature) {
   return comp_temp;
 }
 
-float BerryIMU_v3::press_compensation(float raw_pressure, float comp_temp) {
-  float partial_data1 = PAR_P6 * comp_temp;
-  float partial_data2 = PAR_P7 * (comp_temp * comp_temp);
-  float partial_data3 = PAR_P8 * (comp_temp * comp_temp * comp_temp);
-  float partial_out1 = PAR_P5 + partial_data1 + partial_data2 + partial_data3;
-  partial_data1 = PAR_P2 * comp_temp;
-  partial_data2 = PAR_P3 * (comp_temp * comp_temp);
-  partial_data3 = PAR_P4 * (comp_temp * comp_temp * comp_temp);
-  float partial_out2 = raw_pressure * (PAR_P1 + partial_data1 + partial_data2 + partial_data3);
-  partial_data1 = raw_pressure * raw_pressure;
-  partial_data2 = PAR_P9 + PAR_P10 * comp_temp;
-  partial_data3 = partial_data1 * partial_data2;
-  float partial_data4 = partial_data3 + (raw_pressure * raw_pressure * raw_pressure) * PAR_P11;
-  float comp_press = partial_out1 + partial_out2 + partial_data4;
-  return comp_press;
+//The terms of the pressure compensation that only depend on the temperature
+void BerryIMU_v3::temperature_coefficients(float comp_temp) {
+  float temp2 = comp_temp * comp_temp;
+  float temp3 = temp2 * comp_temp;
+  pressOffset = PAR_P5 + PAR_P6 * comp_temp + PAR_P7 * temp2 + PAR_P8 * temp3;
+  pressLinear = PAR_P1 + PAR_P2 * comp_temp + PAR_P3 * temp2 + PAR_P4 * temp3;
+  pressQuadratic = PAR_P9 + PAR_P10 * comp_temp;
+}
+
+float BerryIMU_v3::press_compensation(float raw_pressure) {
+  float raw2 = raw_pressure * raw_pressure;
+  return pressOffset + raw_pressure * pressLinear + raw2 * (pressQuadratic + raw_pressure * PAR_P11);
 }
 
 void BerryIMU_v3::writeTo(int device, byte address, byte val) {
@@ -331,4 +324,10 @@ void BerryIMU_v3::readFrom(int device, byte address, int num, byte buff[]) {
     i++;
   }
   Wire.endTransmission(); //end transmission
-}
\ No newline at end of file
+}
+
+bool BerryIMU_v3::probe(int device, byte address, byte expected) {
+  byte id = 0;
+  readFrom(device, address, 1, &id);
+  return id == expected;
+}
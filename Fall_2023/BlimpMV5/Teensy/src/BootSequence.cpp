@@ -0,0 +1,43 @@
+#include "BootSequence.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "DebugLog.h"
+
+BootSequence bootSequence;
+
+bool BootSequence::mark(BootPhase phase) {
+  if (reached(phase)) return false;
+  phaseMillis[phase] = millis();
+  reachedMask |= 1 << phase;
+  DEBUG_INFO(MSG_BOOT_PHASE, (unsigned int)phase, (unsigned long)phaseMillis[phase]);
+  return true;
+}
+
+const char* BootSequence::name(BootPhase phase) {
+  switch (phase) {
+    case BOOT_SETUP: return "setup";
+    case BOOT_IMU: return "imu";
+    case BOOT_CONTROL: return "control";
+    case BOOT_CAMERA: return "camera";
+    case BOOT_ESP: return "esp";
+    case BOOT_WIFI: return "wifi";
+    case BOOT_ROS: return "ros";
+    default: return "?";
+  }
+}
+
+int BootSequence::format(char* text, size_t size) const {
+  size_t n = 0;
+  text[0] = '\0';
+  for (int i = 0; i < BOOT_PHASES && n < size; i++) {
+    BootPhase phase = (BootPhase)i;
+    if (!reached(phase)) continue;
+    int written = snprintf(text + n, size - n, "%s%s %lu", n > 0 ? ", " : "", name(phase),
+                           (unsigned long)phaseMillis[i]);
+    if (written < 0) break;
+    n += written;
+  }
+  if (n >= size) n = size - 1;
+  return (int)n;
+}
@@ -0,0 +1,51 @@
+#include "Calibration.h"
+
+#include <EEPROM.h>
+#include <stddef.h>
+#include "MemoryPlacement.h"
+
+COLD_CODE bool CalibrationStore::load() {
+  loaded = false;
+  CalibrationData stored;
+  EEPROM.get(CALIBRATION_ADDRESS, stored);
+
+  if (stored.magic != CALIBRATION_MAGIC) {
+    failure = CALIBRATION_BLANK;
+    return false;
+  }
+  if (stored.version != CALIBRATION_VERSION || stored.size != sizeof(CalibrationData)) {
+    failure = CALIBRATION_OLD_VERSION;
+    return false;
+  }
+  if (stored.crc != crc32((const uint8_t*)&stored, offsetof(CalibrationData, crc))) {
+    failure = CALIBRATION_CORRUPT;
+    return false;
+  }
+
+  data = stored;
+  failure = 0;
+  loaded = true;
+  return true;
+}
+
+COLD_CODE bool CalibrationStore::save() {
+  data.magic = CALIBRATION_MAGIC;
+  data.version = CALIBRATION_VERSION;
+  data.size = sizeof(CalibrationData);
+  data.crc = crc32((const uint8_t*)&data, offsetof(CalibrationData, crc));
+  EEPROM.put(CALIBRATION_ADDRESS, data);
+
+  CalibrationData check;
+  EEPROM.get(CALIBRATION_ADDRESS, check);
+  loaded = check.crc == data.crc && crc32((const uint8_t*)&check, offsetof(CalibrationData, crc)) == data.crc;
+  return loaded;
+}
+
+uint32_t CalibrationStore::crc32(const uint8_t* bytes, uint32_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (uint32_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
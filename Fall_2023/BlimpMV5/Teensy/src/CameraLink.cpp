@@ -0,0 +1,71 @@
+#include "CameraLink.h"
+
+#include <string.h>
+
+uint16_t crc16(const uint8_t* data, uint32_t length) {
+  uint16_t crc = 0xFFFF;
+  for (uint32_t i = 0; i < length; i++) {
+    // the eight shift/xor steps for one byte folded together, no table
+    uint8_t x = (crc >> 8) ^ data[i];
+    x ^= x >> 4;
+    crc = (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+  }
+  return crc;
+}
+
+void sealCameraCommand(CameraCommand& command) {
+  command.sync[0] = CAMERA_SYNC1;
+  command.sync[1] = CAMERA_COMMAND_SYNC2;
+  command.crc = crc16((const uint8_t*)&command + 2, sizeof(CameraCommand) - 4);
+}
+
+bool CameraFrameParser::push(uint8_t byte) {
+  // wait for the two sync bytes
+  if (fill == 0 && byte != CAMERA_SYNC1) return false;
+  if (fill == 1 && byte != CAMERA_SYNC2) {
+    fill = byte == CAMERA_SYNC1 ? 1 : 0;
+    return false;
+  }
+  buffer[fill++] = byte;
+  if (fill < sizeof(CameraFrame)) return false;
+
+  const uint32_t crcOffset = sizeof(CameraFrame) - 2;
+  uint16_t crc = buffer[crcOffset] | (uint16_t)buffer[crcOffset + 1] << 8;
+  if (crc16(buffer + 2, crcOffset - 2) != crc) {
+    crcErrors++;
+    // the sync may have been inside a corrupted frame, restart from the next sync in the buffer
+    uint32_t next = 1;
+    while (next < sizeof(CameraFrame) &&
+           !(buffer[next] == CAMERA_SYNC1 && (next + 1 == sizeof(CameraFrame) || buffer[next + 1] == CAMERA_SYNC2))) {
+      next++;
+    }
+    fill = sizeof(CameraFrame) - next;
+    memmove(buffer, buffer + next, fill);
+    return false;
+  }
+  fill = 0;
+
+  uint16_t last = frame.frame;
+  memcpy(&frame, buffer, sizeof(CameraFrame));
+  if (started) missedFrames += (uint16_t)(frame.frame - last - 1);
+  started = true;
+  frames++;
+  return true;
+}
+
+void CameraFrameParser::toParsed(double parsed[7]) const {
+  for (int color = 0; color < CAMERA_COLORS; color++) {
+    const CameraBlob& blob = frame.blobs[color];
+    parsed[2*color] = blob.pixels > 0 ? blob.cx : 1000;
+    parsed[2*color + 1] = blob.pixels > 0 ? blob.cy : 1000;
+  }
+  parsed[6] = frame.range / 10.0;
+}
+
+void CameraFrameParser::toWidths(double widths[3]) const {
+  for (int color = 0; color < CAMERA_COLORS; color++) {
+    const CameraBlob& blob = frame.blobs[color];
+    //a partly hidden balloon keeps its diameter on the other side
+    widths[color] = blob.pixels > 0 ? (blob.w > blob.h ? blob.w : blob.h) : 0;
+  }
+}
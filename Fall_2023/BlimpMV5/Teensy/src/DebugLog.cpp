@@ -0,0 +1,118 @@
+#include "DebugLog.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include "MemoryPlacement.h"
+
+//only the ring in OCRAM, DMAMEM is not initialised at boot
+static BULK_DATA DebugRecord debugRing[DEBUG_LOG_RECORDS];
+DebugLog debugLog(debugRing);
+
+static const char* const messageFormats[DEBUG_MESSAGE_COUNT] = {
+#define DEBUG_MESSAGE_FORMAT(id, format) format,
+  DEBUG_MESSAGES(DEBUG_MESSAGE_FORMAT)
+#undef DEBUG_MESSAGE_FORMAT
+};
+
+uint32_t DebugLog::word(float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+void DebugLog::push(DebugRecord& record) {
+  record.timeMicros = micros();
+  if (store != nullptr) store(record);
+
+  if (count == DEBUG_LOG_RECORDS) {
+    droppedRecords++;
+    return;
+  }
+  ring[(head + count) % DEBUG_LOG_RECORDS] = record;
+  count++;
+}
+
+const char* DebugLog::levelName(uint8_t level) {
+  switch (level) {
+    case DEBUG_LEVEL_ERROR: return "E";
+    case DEBUG_LEVEL_WARN: return "W";
+    case DEBUG_LEVEL_INFO: return "I";
+    default: return "V";
+  }
+}
+
+int DebugLog::format(const DebugRecord& record, char* text, size_t size) {
+  if (record.id >= DEBUG_MESSAGE_COUNT) return snprintf(text, size, "unknown message %u", record.id);
+
+  //printf one conversion at a time, the argument type comes from its letter
+  const char* f = messageFormats[record.id];
+  size_t n = 0;
+  int arg = 0;
+  while (*f != '\0' && n + 1 < size) {
+    if (*f != '%') {
+      text[n++] = *f++;
+      continue;
+    }
+    if (f[1] == '%') {
+      text[n++] = '%';
+      f += 2;
+      continue;
+    }
+
+    char spec[12];
+    size_t length = strcspn(f + 1, "diucxXfgeE") + 2;
+    if (length >= sizeof(spec) || f[length - 1] == '\0') break;
+    memcpy(spec, f, length);
+    spec[length] = '\0';
+    f += length;
+
+    uint32_t word = arg < record.argc ? record.args[arg] : 0;
+    arg++;
+    int written;
+    switch (spec[length - 1]) {
+      case 'd': case 'i': case 'c':
+        written = snprintf(text + n, size - n, spec, (int)(int32_t)word);
+        break;
+      case 'u': case 'x': case 'X':
+        written = snprintf(text + n, size - n, spec, (unsigned int)word);
+        break;
+      default: {
+        float v;
+        memcpy(&v, &word, sizeof(v));
+        written = snprintf(text + n, size - n, spec, (double)v);
+      }
+    }
+    if (written < 0) break;
+    n += (size_t)written < size - n ? (size_t)written : size - n - 1;
+  }
+  text[n] = '\0';
+  return (int)n;
+}
+
+void DebugLog::Update() {
+  if (droppedRecords != reportedDrops && count < DEBUG_LOG_RECORDS) {
+    uint32_t dropped = droppedRecords - reportedDrops;
+    reportedDrops = droppedRecords;
+    write(DEBUG_LEVEL_WARN, MSG_DEBUG_DROPPED, (unsigned long)dropped);
+  }
+
+  for (int i = 0; i < DEBUG_LOG_DRAIN && count > 0; i++) {
+    const DebugRecord& record = ring[head];
+    char line[DEBUG_LOG_LINE];
+    int n = snprintf(line, sizeof(line), "[%lu.%03lu %s] ", (unsigned long)(record.timeMicros/1000000),
+                     (unsigned long)(record.timeMicros/1000 % 1000), levelName(record.level));
+    n += format(record, line + n, sizeof(line) - n);
+
+    //wait for room rather than block in Serial.write
+    if (usb && Serial && Serial.availableForWrite() < n + 2) return;
+    if (usb && Serial) {
+      Serial.write((const uint8_t*)line, n);
+      Serial.write((const uint8_t*)"\r\n", 2);
+    }
+    if (publish != nullptr && record.level <= rosLevel) publish(line);
+
+    head = (head + 1) % DEBUG_LOG_RECORDS;
+    count--;
+  }
+}
@@ -1,5 +1,6 @@
 #include "EMAFilter.h"
 #include "Arduino.h"
+#include "MemoryPlacement.h"
 
 void EMAFilter::Init(double newAlpha) {
     this->alpha = newAlpha;
@@ -19,7 +20,7 @@ void EMAFilter::setInitial(double initial) {
   this->last = initial;
 }
 
-double EMAFilter::filter(double current) {
+HOT_CODE double EMAFilter::filter(double current) {
 
     if (isnan(current)) {
       return this->last;
@@ -0,0 +1,63 @@
+#include "EscOutput.h"
+#include "MemoryPlacement.h"
+
+#define ESC_PWM_RESOLUTION 15   //bits, analogWrite fallback only
+
+void EscOutput::Init(int leftPin, int rightPin, int protocol) {
+  this->leftPin = leftPin;
+  this->rightPin = rightPin;
+
+  float frequency = 50;
+  pulseScale = 1;
+  if (protocol == ESC_PROTOCOL_PWM400) {
+    frequency = 400;
+  } else if (protocol == ESC_PROTOCOL_ONESHOT125) {
+    frequency = 2000;
+    pulseScale = 0.125;
+  }
+  periodMicros = 1000000.0 / frequency;
+
+  analogWriteResolution(ESC_PWM_RESOLUTION);
+  analogWriteFrequency(leftPin, frequency);
+  analogWriteFrequency(rightPin, frequency);
+
+#if defined(__IMXRT1062__)
+  //pins 6 and 9 are FlexPWM2 submodule 2 A and B
+  sharedSubmodule = (leftPin == 9 && rightPin == 6) || (leftPin == 6 && rightPin == 9);
+#endif
+
+  //analogWrite sets up the pin mux and the submodule, later writes may go to the registers
+  writeDuty(leftPin, pulseFor(1500));
+  writeDuty(rightPin, pulseFor(1500));
+}
+
+HOT_CODE float EscOutput::pulseFor(float micros) const {
+  return constrain(micros, 1000.0f, 2000.0f) * pulseScale;
+}
+
+HOT_CODE void EscOutput::write(float leftMicros, float rightMicros) {
+  float left = pulseFor(leftMicros);
+  float right = pulseFor(rightMicros);
+
+#if defined(__IMXRT1062__)
+  if (sharedSubmodule) {
+    //same duty computation as the core's flexpwmWrite, loaded together on the next period
+    IMXRT_FLEXPWM_t* pwm = &IMXRT_FLEXPWM2;
+    float countsPerMicro = (pwm->SM[2].VAL1 + 1) / periodMicros;
+    uint16_t pin6 = (leftPin == 6 ? left : right) * countsPerMicro;
+    uint16_t pin9 = (leftPin == 9 ? left : right) * countsPerMicro;
+    pwm->MCTRL |= FLEXPWM_MCTRL_CLDOK(1 << 2);
+    pwm->SM[2].VAL3 = pin6;
+    pwm->SM[2].VAL5 = pin9;
+    pwm->MCTRL |= FLEXPWM_MCTRL_LDOK(1 << 2);
+    return;
+  }
+#endif
+
+  writeDuty(leftPin, left);
+  writeDuty(rightPin, right);
+}
+
+HOT_CODE void EscOutput::writeDuty(int pin, float pulseMicros) {
+  analogWrite(pin, (int)(pulseMicros / periodMicros * (1 << ESC_PWM_RESOLUTION) + 0.5f));
+}
@@ -0,0 +1,513 @@
+#include <tgmath.h>
+#include "FlightController.h"
+#include "TeensyParams.h"
+#include "DebugLog.h"
+#include "MemoryPlacement.h"
+
+using namespace std;
+
+COLD_CODE void FlightController::Init() {
+  madgwick.Init();
+  kf.Init();
+  accelGCorrection.Init();
+  gyroEKF.Init();
+
+  // EMA Filters
+  yawRateFilter.Init(0.2);
+  //pre process for accel before vertical kalman filter
+  verticalAccelFilter.Init(0.05);
+
+  tracker.Init();
+  rangeEstimator.Init();
+  //x, y of the selected colour, allocated here rather than in the first updateCamera
+  targetDetection.reserve(2);
+  target = TargetTrack();
+  guidance.Init();
+  search.Init();
+
+  motorClock.setFrequency(30);
+
+  //old approach limit on the commanded yaw rate
+  yawAnglePID.setOutputLimits(-50, 50);
+  yawAnglePID.setSchedule(yawAngleSchedule, 2);
+  yawAnglePID.reset();
+  yawRatePID.reset();
+  heading = 0;
+  headingHold = false;
+
+  //ceiling distance fix, slow enough to average out the rangefinder noise
+  ceilingFilter.Init(0.2);
+  ceilingEstimate = NAN;
+  //move the setpoint gently when the first ceiling fix arrives
+  altitudePID.setSetpointRateLimit(0.2);
+  altitudePID.setOutputLimits(-200, 200);
+  altitudePID.setTrackingGain(2);
+  altitudePID.setDerivativeFilter(altitudeTauD);
+  altitudePID.reset();
+  upCommandFilter.Init(upCommandAlpha);
+  altitudeHold = false;
+}
+
+COLD_CODE bool FlightController::setParameter(const char* name, double value) {
+  if (strcmp(name, "madgwick.beta") == 0) madgwick.beta = value;
+  else if (strcmp(name, "gyroEKF.qAngle") == 0) gyroEKF.qAngle = value;
+  else if (strcmp(name, "gyroEKF.qRate") == 0) gyroEKF.qRate = value;
+  else if (strcmp(name, "gyroEKF.qBias") == 0) gyroEKF.qBias = value;
+  else if (strcmp(name, "gyroEKF.rGyro") == 0) gyroEKF.rGyro = value;
+  else if (strcmp(name, "gyroEKF.rAccel") == 0) gyroEKF.rAccel = value;
+  else if (strcmp(name, "gyroEKF.pBias") == 0) gyroEKF.pBias = value;
+  else if (strcmp(name, "kf.qPos") == 0) kf.qPos = value;
+  else if (strcmp(name, "kf.qVel") == 0) kf.qVel = value;
+  else if (strcmp(name, "kf.qAcc") == 0) kf.qAcc = value;
+  else if (strcmp(name, "kf.qBias") == 0) kf.qBias = value;
+  else if (strcmp(name, "kf.rBaro") == 0) kf.rBaro = value;
+  else if (strcmp(name, "kf.rAccel") == 0) kf.rAccel = value;
+  else if (strcmp(name, "yawRatePID.kp") == 0) yawRatePID.setKp(value);
+  else if (strcmp(name, "yawRatePID.ki") == 0) yawRatePID.setKi(value);
+  else if (strcmp(name, "yawRatePID.kd") == 0) yawRatePID.setKd(value);
+  else if (strcmp(name, "yawRatePID.kff") == 0) yawRatePID.setKff(value);
+  else if (strcmp(name, "yawRatePID.kt") == 0) yawRatePID.setTrackingGain(value);
+  else if (strcmp(name, "yawRatePID.tauD") == 0) yawRatePID.setDerivativeFilter(value);
+  else if (strcmp(name, "yawRatePID.rateLimit") == 0) yawRatePID.setSetpointRateLimit(value);
+  //fixed gains drop the range schedule
+  else if (strcmp(name, "yawAnglePID.kp") == 0) { yawAnglePID.setKp(value); yawAnglePID.setSchedule(nullptr, 0); }
+  else if (strcmp(name, "yawAnglePID.ki") == 0) { yawAnglePID.setKi(value); yawAnglePID.setSchedule(nullptr, 0); }
+  else if (strcmp(name, "yawAnglePID.kd") == 0) { yawAnglePID.setKd(value); yawAnglePID.setSchedule(nullptr, 0); }
+  else if (strcmp(name, "yawAngleSchedule.nearRange") == 0) { yawAngleSchedule[0].key = value; yawAnglePID.setSchedule(yawAngleSchedule, 2); }
+  else if (strcmp(name, "yawAngleSchedule.nearKp") == 0) { yawAngleSchedule[0].kp = value; yawAnglePID.setSchedule(yawAngleSchedule, 2); }
+  else if (strcmp(name, "yawAngleSchedule.nearKd") == 0) { yawAngleSchedule[0].kd = value; yawAnglePID.setSchedule(yawAngleSchedule, 2); }
+  else if (strcmp(name, "yawAngleSchedule.farRange") == 0) { yawAngleSchedule[1].key = value; yawAnglePID.setSchedule(yawAngleSchedule, 2); }
+  else if (strcmp(name, "yawAngleSchedule.farKp") == 0) { yawAngleSchedule[1].kp = value; yawAnglePID.setSchedule(yawAngleSchedule, 2); }
+  else if (strcmp(name, "yawAngleSchedule.farKd") == 0) { yawAngleSchedule[1].kd = value; yawAnglePID.setSchedule(yawAngleSchedule, 2); }
+  else if (strcmp(name, "yawAnglePID.tauD") == 0) yawAnglePID.setDerivativeFilter(value);
+  else if (strcmp(name, "tracker.qAccel") == 0) tracker.qAccel = value;
+  else if (strcmp(name, "tracker.rAngle") == 0) tracker.rAngle = value;
+  else if (strcmp(name, "tracker.gate") == 0) tracker.gate = value;
+  else if (strcmp(name, "tracker.timeout") == 0) tracker.timeout = value;
+  else if (strcmp(name, "guidance.farSpeed") == 0) guidance.farSpeed = value;
+  else if (strcmp(name, "guidance.nearRange") == 0) guidance.nearRange = value;
+  else if (strcmp(name, "guidance.farRange") == 0) guidance.farRange = value;
+  else if (strcmp(name, "range.qAccel") == 0) rangeEstimator.qAccel = value;
+  else if (strcmp(name, "range.pixelNoise") == 0) rangeEstimator.pixelNoise = value;
+  else if (strcmp(name, "range.relativeNoise") == 0) rangeEstimator.relativeNoise = value;
+  else if (strcmp(name, "range.maxRelativeSigma") == 0) rangeEstimator.maxRelativeSigma = value;
+  else if (strcmp(name, "camera.roiMargin") == 0) cameraRoiMargin = value;
+  else if (strcmp(name, "camera.allColors") == 0) cameraAllColors = value != 0;
+  else if (strcmp(name, "guidance.navigationGain") == 0) guidance.navigationGain = value;
+  else if (strcmp(name, "guidance.pursuitGain") == 0) guidance.pursuitGain = value;
+  else if (strcmp(name, "guidance.maxLead") == 0) guidance.maxLead = value;
+  else if (strcmp(name, "guidance.cruiseSpeed") == 0) guidance.cruiseSpeed = value;
+  else if (strcmp(name, "guidance.losRateScale") == 0) guidance.losRateScale = value;
+  else if (strcmp(name, "guidance.forwardTerminal") == 0) guidance.forwardTerminal = value;
+  else if (strcmp(name, "guidance.terminalTime") == 0) guidance.terminalTime = value;
+  else if (strcmp(name, "guidance.terminalLosRate") == 0) guidance.terminalLosRate = value;
+  else if (strcmp(name, "guidance.coastTime") == 0) guidance.coastTime = value;
+  else if (strcmp(name, "search.pattern") == 0) search.pattern = (int)value;
+  else if (strcmp(name, "search.arenaLength") == 0) search.arenaLength = value;
+  else if (strcmp(name, "search.arenaWidth") == 0) search.arenaWidth = value;
+  else if (strcmp(name, "search.laneSpacing") == 0) search.laneSpacing = value;
+  else if (strcmp(name, "search.scanRate") == 0) search.scanRate = value;
+  else if (strcmp(name, "search.forward") == 0) search.searchForward = value;
+  else if (strcmp(name, "search.sweepDepth") == 0) search.sweepDepth = value;
+  else if (strcmp(name, "altitudePID.kp") == 0) altitudePID.setKp(value);
+  else if (strcmp(name, "altitudePID.ki") == 0) altitudePID.setKi(value);
+  else if (strcmp(name, "altitudePID.kd") == 0) altitudePID.setKd(value);
+  else if (strcmp(name, "altitudePID.tauD") == 0) altitudeTauD = value;
+  else if (strcmp(name, "altitude.ceilingDistance") == 0) ceilingDistanceSetpoint = value;
+  else if (strcmp(name, "altitude.commandAlpha") == 0) upCommandAlpha = value;
+  else return false;
+  return true;
+}
+
+COLD_CODE void FlightController::applyCalibration(const CalibrationData& data) {
+  for (int i = 0; i < 3; i++) {
+    gyroBias[i] = data.gyroBias[i];
+    accelGCorrection.offset[i] = data.accelOffset[i];
+    accelGCorrection.scale[i] = data.accelScale[i];
+  }
+  gyroEKF.warmStart(data.gyroEKFBias, data.gyroEKFVariance);
+  kf.warmStart(data.kfBias, data.kfVariance);
+}
+
+void FlightController::storeCalibration(CalibrationData& data) const {
+  for (int i = 0; i < 3; i++) {
+    data.gyroBias[i] = gyroBias[i];
+    data.accelOffset[i] = accelGCorrection.offset[i];
+    data.accelScale[i] = accelGCorrection.scale[i];
+  }
+  gyroEKF.getState(data.gyroEKFBias, data.gyroEKFVariance);
+  kf.getState(data.kfBias, data.kfVariance);
+}
+
+void FlightController::startCalibration(double seconds) {
+  calibrationSamples = max(1, (int)(seconds*FAST_SENSOR_LOOP_FREQ));
+  calibrationCount = 0;
+  for (int i = 0; i < 3; i++) {
+    calibrationGyroSum[i] = 0;
+    calibrationAccelSum[i] = 0;
+    calibrationRawSum[i] = 0;
+  }
+  calibrationDone = false;
+  DEBUG_INFO(MSG_CALIBRATION_STARTED, seconds);
+}
+
+bool FlightController::calibrationFinished() {
+  bool done = calibrationDone;
+  calibrationDone = false;
+  return done;
+}
+
+COLD_CODE void FlightController::rotateAxes(const float trim[3][3]) {
+  //AccelGCorrection works with z flipped
+  const float flip[3] = {1, 1, -1};
+  float bias[3], offset[3], rest[3];
+  for (int r = 0; r < 3; r++) {
+    bias[r] = offset[r] = rest[r] = 0;
+    for (int c = 0; c < 3; c++) {
+      bias[r] += trim[r][c]*gyroBias[c];
+      offset[r] += flip[r]*trim[r][c]*flip[c]*accelGCorrection.offset[c];
+      rest[r] += trim[r][c]*restAccel[c];
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    gyroBias[i] = bias[i];
+    accelGCorrection.offset[i] = offset[i];
+    restAccel[i] = rest[i];
+  }
+  madgwick.setLevel(madgwick.yaw_final);
+}
+
+COLD_CODE void FlightController::zeroHeight() {
+  kf.resetHeight();
+  ceilingEstimate = NAN;
+  holdHeight = 0;
+}
+
+void FlightController::updateCalibration(float gx, float gy, float gz, float ax, float ay, float az) {
+  float rate = max(fabsf(gx), max(fabsf(gy), fabsf(gz)));
+  if (rate > CALIBRATION_MAX_RATE) {
+    calibrationSamples = 0;
+    DEBUG_WARN(MSG_CALIBRATION_MOVED, rate);
+    return;
+  }
+
+  calibrationGyroSum[0] += gx;
+  calibrationGyroSum[1] += gy;
+  calibrationGyroSum[2] += gz;
+  //at rest the accel minus the attitude's gravity is the offset error
+  calibrationAccelSum[0] += accelGCorrection.ax;
+  calibrationAccelSum[1] += accelGCorrection.ay;
+  calibrationAccelSum[2] += accelGCorrection.az;
+  calibrationRawSum[0] += ax;
+  calibrationRawSum[1] += ay;
+  calibrationRawSum[2] += az;
+  calibrationCount++;
+  if (--calibrationSamples > 0) return;
+
+  for (int i = 0; i < 3; i++) {
+    gyroBias[i] += calibrationGyroSum[i]/calibrationCount;
+    accelGCorrection.offset[i] -= calibrationAccelSum[i]/calibrationCount;
+    restAccel[i] = calibrationRawSum[i]/calibrationCount;
+  }
+
+  //the biases the filters learnt are now in the calibration, keep how sure they were
+  CalibrationData state;
+  storeCalibration(state);
+  float zeroBias[3] = {0, 0, 0};
+  gyroEKF.warmStart(zeroBias, state.gyroEKFVariance);
+  kf.warmStart(0, state.kfVariance);
+  calibrationDone = true;
+}
+
+HOT_CODE void FlightController::updateImu(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+  //calibrated rates, gyroBias stays zero without a stored calibration
+  gx -= gyroBias[0];
+  gy -= gyroBias[1];
+  gz -= gyroBias[2];
+
+  madgwick.Madgwick_Update(gx, gy, gz, ax, ay, az);
+
+  //get orientation from madgwick
+  pitch = madgwick.pitch_final;
+  roll = madgwick.roll_final;
+  yaw = madgwick.yaw_final;
+
+  //compute the acceleration in the barometers vertical reference frame
+  accelGCorrection.updateData(ax, ay, az, pitch, roll);
+
+  //run the prediction step of the vertical velecity kalman filter
+  kf.predict(dt);
+  gyroEKF.predict(dt);
+
+  //pre filter accel before updating vertical velocity kalman filter
+  verticalAccelFilter.filter(-accelGCorrection.agz);
+
+  //update vertical velocity kalman filter acceleration
+  kf.updateAccel(verticalAccelFilter.last);
+
+  //update filtered yaw rate
+  yawRateFilter.filter(gz);
+
+  //perform gyro update
+  gyroEKF.updateGyro(gx*3.14/180, gy*3.14/180, gz*3.14/180);
+  gyroEKF.updateAccel(ax, ay, az);
+
+  //the EKF rate states track the raw gyro, the bias states hold the offset
+  yawRateEstimate = (gyroEKF.yawRate - gyroEKF.yawRateB)*180/3.14;
+  heading += yawRateEstimate*dt;
+
+  updateYawLoops(dt);
+  if (calibrationSamples > 0) updateCalibration(gx, gy, gz, ax, ay, az);
+}
+
+void FlightController::updateBaro(float alt) {
+  //update kalman with uncorreced barometer data
+  kf.updateBaro(alt);
+}
+
+void FlightController::updateCamera(const double parsed[7], const double blobWidth[3]) {
+  // All three blobs go to the tracker, targetDetection keeps the selected colour
+  targetDetection.clear();
+
+  float x[TRACKER_COLORS];
+  float y[TRACKER_COLORS];
+  for (int color = 0; color < TRACKER_COLORS; color++) {
+    double x_raw = parsed[2*color];
+    double y_raw = parsed[2*color + 1];
+
+    if(x_raw == 1000 && y_raw == 1000){
+      // OpenMV couldn't find a blob
+      x[color] = NAN;
+      y[color] = NAN;
+      continue;
+    }
+
+    // DEFAULT OPENMV BEHAVIOR
+    // - finds blobs in frame, top-left = (0,0), bottom-right = (320,240)
+
+    // Scale back to normal frame
+    x[color] = x_raw*2/RESOLUTION_WIDTH - 1;
+    y[color] = (-2*y_raw + RESOLUTION_HEIGHT)/RESOLUTION_WIDTH;
+
+    if(color == targetColor){
+      targetDetection.push_back(x[color]);
+      targetDetection.push_back(y[color]);
+
+      // a blob cut by the frame edge is narrower than the balloon
+      double half = blobWidth != nullptr ? blobWidth[color]/2 : 0;
+      if (half > 0 && x_raw - half > 1 && x_raw + half < RESOLUTION_WIDTH - 1 &&
+          y_raw - half > 1 && y_raw + half < RESOLUTION_HEIGHT - 1) {
+        rangeEstimator.update(micros()/1000000.0, blobWidth[color]);
+      }
+    }
+  }
+
+  tracker.update(micros()/1000000.0, heading, x, y);
+
+  // Populate ceilHeight
+  ceilHeight = parsed[6];
+
+  // Ceiling height in the kf.x frame, the rangefinder looks along the body z axis
+  if (ceilHeight > 0 && ceilHeight <= 400) {
+    double ceiling = kf.x + ceilHeight/100*cos(pitch*DEG_TO_RAD)*cos(roll*DEG_TO_RAD);
+    if (isnan(ceilingEstimate)) ceilingFilter.setInitial(ceiling);
+    ceilingEstimate = ceilingFilter.filter(ceiling);
+  }
+}
+
+void FlightController::cameraRequest(CameraCommand& command) const {
+  command.color = cameraAllColors ? CAMERA_ALL_COLORS : targetColor;
+  // close in the target fills the frame, a quarter of the pixels is enough
+  command.frameSize = state == approach && guidance.terminal ? CAMERA_QQVGA : CAMERA_QVGA;
+  command.roiX = command.roiY = command.roiW = command.roiH = 0;
+  if (!target.valid) return;
+
+  // inverse of the projection in TargetTracker::update, bearing positive left is towards x = 0
+  float tanHalf = tanf(CAMERA_HFOV / 2 * DEG_TO_RAD);
+  double margin = cameraRoiMargin + (fabs(target.bearingRate) + fabs(target.elevationRate))*target.age;
+  double left = (1 - tan(min(target.bearing + margin, 80.0)*DEG_TO_RAD)/tanHalf)*RESOLUTION_WIDTH/2;
+  double right = (1 - tan(max(target.bearing - margin, -80.0)*DEG_TO_RAD)/tanHalf)*RESOLUTION_WIDTH/2;
+  double top = (RESOLUTION_HEIGHT - tan(min(target.elevation + margin, 80.0)*DEG_TO_RAD)/tanHalf*RESOLUTION_WIDTH)/2;
+  double bottom = (RESOLUTION_HEIGHT - tan(max(target.elevation - margin, -80.0)*DEG_TO_RAD)/tanHalf*RESOLUTION_WIDTH)/2;
+  left = max(left, 0.0);
+  top = max(top, 0.0);
+  right = min(right, (double)RESOLUTION_WIDTH);
+  bottom = min(bottom, (double)RESOLUTION_HEIGHT);
+  if (right - left < 8 || bottom - top < 8) return;   // predicted outside the frame
+
+  command.roiX = left;
+  command.roiY = top;
+  command.roiW = right - left;
+  command.roiH = bottom - top;
+}
+
+void FlightController::setManualInput(double yaw, double forward, double up) {
+  this->manualYaw = yaw;
+  this->manualForward = forward;
+  this->manualUp = up;
+}
+
+void FlightController::update() {
+  //selected target, a colour switch picks up its already running track
+  target = tracker.track(targetColor, micros()/1000000.0, heading);
+  if (!target.valid) rangeEstimator.reset();
+  targetRange = NAN;
+
+  // ******************* STATE MACHINE ******************* //
+  // Manual
+  if (autonomousState == manual){
+    //autonomous always starts with a search
+    state = searching;
+    search.reset(heading, tracker.lastAzimuth(targetColor));
+    headingHold = false;
+    altitudeHold = false;
+
+    if (motorClock.isReady()) {
+      //safegaurd: if motor reads any command that is greater than 1, shut the motor off!!!
+      forwardInput = max(-1.00, min(1.00,manualForward));
+      upInput = max(-1.00, min(1.00,manualUp));
+      yawInput = max(-1.00, min(1.00,manualYaw));
+
+      //map controller input to yaw rate
+      upInput = 500*upInput;
+      forwardInput = 500*forwardInput;
+      yawInput = -yawInput*200;    //120 degrees per second
+    }
+
+  // Autonomous
+  } else if (autonomousState == autonomous) {
+
+    //AUTONOMOUS
+    double outerLoopTime = millis() - lastOuterLoopTime;
+
+    if (outerLoopTime > (1.0/OUTERLOOP)*1000) {
+      lastOuterLoopTime = millis();
+
+      //ultrasonic
+      DEBUG_VERBOSE(MSG_CEILING, ceilHeight);
+
+      //perform decisions
+      switch (state) {
+
+        //Search
+        case searching: {
+          double dt = min(outerLoopTime/1000.0, 0.5);
+          search.update(heading, dt);
+          if (search.scanning) {
+            headingHold = false;
+            yawInput = search.yawRate;
+          } else {
+            if (!headingHold) yawAnglePID.reset();
+            headingHold = true;
+            targetHeading = search.headingSetpoint;
+          }
+
+          //hold ceilingDistanceSetpoint below the ceiling
+          if (GROUND_TEST) {
+            altitudeHold = false;
+            upInput = 0;
+            forwardInput = 0;
+          } else {
+            updateAltitudeHold(dt, search.heightOffset);
+            forwardInput += search.forward;
+          }
+
+          //we see something o_O
+          if(target.valid){
+            state = approach;
+            guidance.reset(target);
+            interceptHeight = altitudeHold ? altitudePID.setpoint : kf.x;
+          }
+        } break;
+
+        // Approach
+        case approach: {
+          double dt = min(outerLoopTime/1000.0, 0.5);
+          bool haveRange = rangeEstimator.valid(micros()/1000000.0);
+          targetRange = haveRange ? rangeEstimator.range : NAN;
+          double rangeRate = haveRange ? rangeEstimator.rangeRate : NAN;
+          if(guidance.update(target, targetRange, rangeRate, dt)){
+            //the cascade in updateImu holds the predicted target heading plus the lead
+            if (!headingHold) yawAnglePID.reset();
+            headingHold = true;
+
+            if (GROUND_TEST) {
+              altitudeHold = false;
+              upInput = 0;
+              forwardInput = guidance.forward;
+            } else {
+              interceptHeight += guidance.climbRate*dt;
+              if (!isnan(ceilingEstimate)) interceptHeight = min(interceptHeight, ceilingEstimate - ceilingClearance);
+              driveAltitude(interceptHeight, dt);
+              forwardInput += guidance.forward;
+            }
+          }else{
+            headingHold = false;
+            state = searching;
+            search.reset(heading, tracker.lastAzimuth(targetColor));
+          }
+        }  break;
+
+        // Default Case
+        default: {
+          DEBUG_ERROR(MSG_INVALID_STATE, state);
+        } break;
+      }
+    }
+  }
+}
+
+HOT_CODE void FlightController::updateYawLoops(float dt) {
+  //outer loop, heading error to a rate setpoint
+  if (headingHold) {
+    if (state == approach) {
+      TargetTrack t = tracker.track(targetColor, micros()/1000000.0, heading);
+      if (t.valid) targetHeading = heading + t.bearing + guidance.leadAngle;
+    }
+    yawAnglePID.setScheduleKey(isnan(targetRange) ? yawAngleSchedule[1].key : targetRange);
+    yawInput = yawAnglePID.calculate(targetHeading, heading, dt);
+  }
+
+  //inner loop on the bias corrected rate
+  double deadband = 2.0; //To do
+
+  //forward command is the only airspeed measure we have, used if a gain schedule is set
+  yawRatePID.setScheduleKey(abs(forwardInput));
+  yawPIDInput = yawRatePID.calculate(yawInput, yawRateEstimate, dt);
+  if (abs(yawInput-yawRateEstimate) < deadband) {
+      yawPIDInput = 0;
+  } else {
+      yawPIDInput = tanh(yawPIDInput)*abs(yawPIDInput);
+  }
+}
+
+void FlightController::updateAltitudeHold(double dt, double heightOffset) {
+  if (!altitudeHold) holdHeight = kf.x;
+  double height = isnan(ceilingEstimate) ? holdHeight : ceilingEstimate - ceilingDistanceSetpoint;
+  driveAltitude(height + heightOffset, dt);
+}
+
+void FlightController::driveAltitude(double height, double dt) {
+  if (!altitudeHold) {
+    altitudePID.reset();
+    upCommandFilter.setInitial(0);
+    altitudeHold = true;
+  }
+
+  double up = upCommandFilter.filter(altitudePID.calculateWithRate(height, kf.x, kf.v, dt));
+  altitudeSetpoint = altitudePID.setpoint;
+  altitudeError = altitudePID.error;
+
+  //up is wanted along gravity, the thrust is vectored in the pitched body frame
+  upInput = up*cos(pitch*DEG_TO_RAD);
+  forwardInput = up*sin(pitch*DEG_TO_RAD);
+}
+
+void FlightController::setActuatorAuthority(double yaw, double up) {
+  if (altitudeHold) altitudePID.setAppliedOutput(altitudePID.output * up);
+
+  //inside the deadband nothing was asked of the motors, leave the integral alone
+  if (yawPIDInput == 0) return;
+  //tanh(x)*|x| is about x once the motors saturate, so scale the loop output directly
+  yawRatePID.setAppliedOutput(yawRatePID.output * yaw);
+}
@@ -0,0 +1,155 @@
+#include "FlightRecorder.h"
+#include "TeensyParams.h"
+#include "MemoryPlacement.h"
+#include "DebugLog.h"
+
+#if FLIGHTLOG_BACKEND == FLIGHTLOG_BACKEND_SD
+  #include <SD.h>
+#else
+  #include <LittleFS.h>
+  LittleFS_Program flightLogFS;
+#endif
+
+//only the raw buffers in OCRAM, DMAMEM is not initialised at boot
+BULK_DATA uint8_t FlightRecorder::buffers[2][FLIGHTLOG_BUFFER_SIZE];
+
+COLD_CODE bool FlightRecorder::openStorage() {
+#if FLIGHTLOG_BACKEND == FLIGHTLOG_BACKEND_SD
+  if (!SD.begin(FLIGHTLOG_SD_CS_PIN)) return false;
+  fs = &SD;
+#else
+  if (!flightLogFS.begin(FLIGHTLOG_LITTLEFS_SIZE)) return false;
+  fs = &flightLogFS;
+#endif
+  return true;
+}
+
+COLD_CODE bool FlightRecorder::Init(const char* blimpId) {
+  active = false;
+  if (!openStorage()) {
+    DEBUG_ERROR(MSG_FLIGHTLOG_NO_STORAGE);
+    return false;
+  }
+
+  // Next free FLTnnn.BIN
+  int index = 0;
+  for (; index < 1000; index++) {
+    snprintf(fileName, sizeof(fileName), "FLT%03d.BIN", index);
+    if (!fs->exists(fileName)) break;
+  }
+  if (index == 1000) {
+    DEBUG_ERROR(MSG_FLIGHTLOG_NO_NAME);
+    return false;
+  }
+
+  file = fs->open(fileName, FILE_WRITE_BEGIN);
+  if (!file) {
+    DEBUG_ERROR(MSG_FLIGHTLOG_OPEN_FAILED);
+    return false;
+  }
+
+  FlightLogFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "BLOG", 4);
+  header.version = FLIGHTLOG_VERSION;
+  header.headerSize = sizeof(header);
+  header.startMicros = micros();
+  strncpy(header.blimpId, blimpId, sizeof(header.blimpId) - 1);
+  file.write((const uint8_t*)&header, sizeof(header));
+  file.flush();
+
+  fill[0] = 0;
+  fill[1] = 0;
+  activeBuffer = 0;
+  pending = false;
+  droppedRecords = 0;
+  bytesWritten = sizeof(header);
+  lastSwapMillis = millis();
+  lastSyncMillis = millis();
+  active = true;
+
+  DEBUG_INFO(MSG_FLIGHTLOG_STARTED, (unsigned int)index);
+  return true;
+}
+
+void FlightRecorder::write(FlightLogRecordType type, const void* payload, uint8_t length) {
+  if (!active) return;
+
+  uint32_t size = sizeof(FlightLogRecordHeader) + length;
+  if (fill[activeBuffer] + size > FLIGHTLOG_BUFFER_SIZE) {
+    if (pending) {
+      // Writer is behind, never wait for it
+      droppedRecords++;
+      return;
+    }
+    swapBuffers();
+  }
+
+  FlightLogRecordHeader header;
+  header.sync = FLIGHTLOG_RECORD_SYNC;
+  header.type = type;
+  header.length = length;
+  header.timeMicros = micros();
+
+  uint8_t* dst = buffers[activeBuffer] + fill[activeBuffer];
+  memcpy(dst, &header, sizeof(header));
+  memcpy(dst + sizeof(header), payload, length);
+  fill[activeBuffer] += size;
+}
+
+void FlightRecorder::swapBuffers() {
+  pending = true;
+  pendingOffset = 0;
+  activeBuffer ^= 1;
+  fill[activeBuffer] = 0;
+  lastSwapMillis = millis();
+}
+
+void FlightRecorder::Update() {
+  if (!active) return;
+
+  uint32_t now = millis();
+  if (!pending && fill[activeBuffer] > 0 && now - lastSwapMillis >= FLIGHTLOG_SWAP_PERIOD) {
+    swapBuffers();
+  }
+
+  if (pending) {
+    // Write one chunk of the full buffer per call
+    uint8_t pendingBuffer = activeBuffer ^ 1;
+    uint32_t remaining = fill[pendingBuffer] - pendingOffset;
+    uint32_t n = remaining < FLIGHTLOG_CHUNK_SIZE ? remaining : FLIGHTLOG_CHUNK_SIZE;
+    size_t written = file.write(buffers[pendingBuffer] + pendingOffset, n);
+    if (written != n) {
+      file.close();
+      active = false;
+      DEBUG_ERROR(MSG_FLIGHTLOG_WRITE_FAILED);
+      return;
+    }
+    pendingOffset += n;
+    bytesWritten += n;
+    if (pendingOffset >= fill[pendingBuffer]) {
+      fill[pendingBuffer] = 0;
+      pending = false;
+    }
+  } else if (now - lastSyncMillis >= FLIGHTLOG_SYNC_PERIOD) {
+    // Commit the file size so a power cut loses at most the last few seconds
+    lastSyncMillis = now;
+    file.flush();
+  }
+}
+
+void FlightRecorder::stop() {
+  if (!active) return;
+  if (pending) {
+    uint8_t pendingBuffer = activeBuffer ^ 1;
+    file.write(buffers[pendingBuffer] + pendingOffset, fill[pendingBuffer] - pendingOffset);
+    bytesWritten += fill[pendingBuffer] - pendingOffset;
+    pending = false;
+  }
+  file.write(buffers[activeBuffer], fill[activeBuffer]);
+  bytesWritten += fill[activeBuffer];
+  fill[0] = 0;
+  fill[1] = 0;
+  file.close();
+  active = false;
+}
@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <cmath>
+#include "GainScheduledPID.h"
+#include "MemoryPlacement.h"
+
+using namespace std;
+
+GainScheduledPID::GainScheduledPID(double kp, double ki, double kd) :
+    _kp(kp),
+    _ki(ki),
+    _kd(kd)
+{
+}
+
+void GainScheduledPID::setKp(double kp) {
+    _kp = kp;
+}
+
+void GainScheduledPID::setKi(double ki) {
+    _ki = ki;
+}
+
+void GainScheduledPID::setKd(double kd) {
+    _kd = kd;
+}
+
+void GainScheduledPID::setKff(double kff) {
+    _kff = kff;
+}
+
+void GainScheduledPID::setDerivativeFilter(double tau) {
+    _tauD = max(tau, 0.0);
+}
+
+void GainScheduledPID::setTrackingGain(double kt) {
+    _kt = max(kt, 0.0);
+}
+
+void GainScheduledPID::setSetpointRateLimit(double rate) {
+    _rateLimit = abs(rate);
+}
+
+void GainScheduledPID::setOutputLimits(double min, double max) {
+    _out_min = min;
+    _out_max = max;
+    _limit_output = true;
+}
+
+bool GainScheduledPID::setSchedule(const GainPoint* points, int count) {
+    if (count < 0 || count > PID_SCHEDULE_POINTS) return false;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && points[i].key < points[i - 1].key) return false;
+        _schedule[i] = points[i];
+    }
+    _schedulePoints = count;
+    return true;
+}
+
+void GainScheduledPID::setScheduleKey(double key) {
+    _scheduleKey = key;
+}
+
+HOT_CODE void GainScheduledPID::gains(double& kp, double& ki, double& kd) {
+    if (_schedulePoints == 0) {
+        kp = _kp;
+        ki = _ki;
+        kd = _kd;
+        return;
+    }
+
+    int upper = 0;
+    while (upper < _schedulePoints && _schedule[upper].key < _scheduleKey) upper++;
+    if (upper == 0 || upper == _schedulePoints) {
+        const GainPoint& end = _schedule[upper == 0 ? 0 : _schedulePoints - 1];
+        kp = end.kp;
+        ki = end.ki;
+        kd = end.kd;
+        return;
+    }
+
+    const GainPoint& a = _schedule[upper - 1];
+    const GainPoint& b = _schedule[upper];
+    double t = (_scheduleKey - a.key) / (b.key - a.key);
+    kp = a.kp + t * (b.kp - a.kp);
+    ki = a.ki + t * (b.ki - a.ki);
+    kd = a.kd + t * (b.kd - a.kd);
+}
+
+HOT_CODE double GainScheduledPID::calculate(double target, double pv, double dt, double feedForward) {
+    return step(target, pv, 0, false, dt, feedForward);
+}
+
+HOT_CODE double GainScheduledPID::calculateWithRate(double target, double pv, double pvRate, double dt, double feedForward) {
+    return step(target, pv, pvRate, true, dt, feedForward);
+}
+
+HOT_CODE double GainScheduledPID::step(double target, double pv, double pvRate, bool measuredRate, double dt, double feedForward) {
+    double kp, ki, kd;
+    gains(kp, ki, kd);
+
+    // Rate limited setpoint, starts at the first target
+    if (!_started || _rateLimit == 0 || dt <= 0) {
+        if (!_started || _rateLimit == 0) setpoint = target;
+    } else {
+        double step = _rateLimit * dt;
+        setpoint += constrain(target - setpoint, -step, step);
+    }
+    error = setpoint - pv;
+
+    pTerm = kp * error;
+    ffTerm = _kff * setpoint + feedForward;
+
+    if (_started && dt > 0) {
+        _integral += ki * error * dt;
+
+        // Back-calculation: bleed the integral by what the actuators could not deliver.
+        // Only towards zero, a saturated P or D term must not wind it the other way.
+        double track = _kt * (_applied - _unsaturated) * dt;
+        if (track * _integral < 0) {
+            _integral = abs(track) < abs(_integral) ? _integral + track : 0;
+        }
+
+        // Derivative on measurement, no kick on setpoint steps
+        if (!measuredRate) pvRate = (pv - _prevPv) / dt;
+        dTerm += (-kd * pvRate - dTerm) * (_tauD > 0 ? dt / (_tauD + dt) : 1);
+    } else if (measuredRate) {
+        dTerm = -kd * pvRate;
+    }
+    iTerm = _integral;
+
+    _unsaturated = pTerm + iTerm + dTerm + ffTerm;
+    output = _unsaturated;
+    if (_limit_output) {
+        output = constrain(output, _out_min, _out_max);
+    }
+
+    // Until told otherwise the actuators deliver what was asked
+    _applied = output;
+    _prevPv = pv;
+    _started = true;
+    return output;
+}
+
+void GainScheduledPID::setAppliedOutput(double applied) {
+    _applied = applied;
+}
+
+void GainScheduledPID::reset() {
+    _integral = 0;
+    _unsaturated = 0;
+    _applied = 0;
+    _started = false;
+    setpoint = error = pTerm = iTerm = dTerm = ffTerm = output = 0;
+}
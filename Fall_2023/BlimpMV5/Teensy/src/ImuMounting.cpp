@@ -0,0 +1,43 @@
+#include "ImuMounting.h"
+#include "MemoryPlacement.h"
+#include <math.h>
+
+COLD_CODE void ImuAlignment::set(const float angles[3]) {
+  for (int i = 0; i < 3; i++) this->angles[i] = angles[i];
+  float cr = cosf(angles[0]*DEG_TO_RAD), sr = sinf(angles[0]*DEG_TO_RAD);
+  float cp = cosf(angles[1]*DEG_TO_RAD), sp = sinf(angles[1]*DEG_TO_RAD);
+  float cy = cosf(angles[2]*DEG_TO_RAD), sy = sinf(angles[2]*DEG_TO_RAD);
+
+  //Rz(yaw)*Ry(pitch)*Rx(roll)
+  m[0][0] = cy*cp;  m[0][1] = cy*sp*sr - sy*cr;  m[0][2] = cy*sp*cr + sy*sr;
+  m[1][0] = sy*cp;  m[1][1] = sy*sp*sr + cy*cr;  m[1][2] = sy*sp*cr - cy*sr;
+  m[2][0] = -sp;    m[2][1] = cp*sr;             m[2][2] = cp*cr;
+  active = angles[0] != 0 || angles[1] != 0 || angles[2] != 0;
+}
+
+COLD_CODE void ImuAlignment::level(const float accel[3], float trim[3][3]) {
+  //Rx(roll) zeroes the y component, then Ry(pitch) the x component
+  float roll = atan2f(accel[1], accel[2]);
+  float pitch = atan2f(-accel[0], sqrtf(accel[1]*accel[1] + accel[2]*accel[2]));
+  float cr = cosf(roll), sr = sinf(roll);
+  float cp = cosf(pitch), sp = sinf(pitch);
+  float rotation[3][3] = {{cp, sp*sr, sp*cr},
+                          {0,  cr,    -sr},
+                          {-sp, cp*sr, cp*cr}};
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) trim[r][c] = rotation[r][c];
+  }
+
+  //trim after the current alignment, back to angles
+  float total[3][3];
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      total[r][c] = trim[r][0]*m[0][c] + trim[r][1]*m[1][c] + trim[r][2]*m[2][c];
+    }
+  }
+  float levelled[3];
+  levelled[0] = atan2f(total[2][1], total[2][2])*RAD_TO_DEG;
+  levelled[1] = asinf(fmaxf(-1, fminf(1, -total[2][0])))*RAD_TO_DEG;
+  levelled[2] = atan2f(total[1][0], total[0][0])*RAD_TO_DEG;
+  set(levelled);
+}
@@ -0,0 +1,85 @@
+#include "InterceptGuidance.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+using namespace std;
+
+void InterceptGuidance::Init() {
+  leadAngle = 0;
+  verticalLead = 0;
+  climbRate = 0;
+  forward = 0;
+  closingSpeed = 0;
+  speed = 0;
+  terminal = false;
+  coast = 0;
+}
+
+void InterceptGuidance::reset(const TargetTrack& target) {
+  terminal = false;
+  coast = coastTime;
+  //start on pure pursuit
+  leadAngle = 0;
+  verticalLead = 0;
+  pathAngle = target.elevation;
+  lastBearing = target.bearing;
+  lastElevation = target.elevation;
+}
+
+bool InterceptGuidance::update(const TargetTrack& target, double range, double rangeRate, double dt) {
+  if (target.valid) {
+    lastBearing = target.bearing;
+    lastElevation = target.elevation;
+  }
+
+  //own speed from the forward command, a stationary target is assumed without a range
+  speed += (SPEED_PER_FORWARD*forward - speed)*min(dt/SPEED_TAU, 1.0);
+  if (!isnan(range) && !isnan(rangeRate)) {
+    closingSpeed = -rangeRate;
+  } else {
+    closingSpeed = speed*cos(lastBearing*DEG_TO_RAD)*cos(lastElevation*DEG_TO_RAD);
+  }
+
+  if (!target.valid) {
+    //only a committed terminal run goes on without the track
+    if (!terminal) return false;
+    coast -= dt;
+    forward = forwardTerminal;
+    return coast > 0;
+  }
+  coast = coastTime;
+
+  double losRate = sqrt(target.bearingRate*target.bearingRate + target.elevationRate*target.elevationRate);
+  if (!terminal) {
+    if (isnan(range)) terminal = losRate > terminalLosRate;
+    else if (closingSpeed > 0.05) terminal = range/closingSpeed < terminalTime;
+  }
+
+  //heading and flight path turn at N times the line of sight rates, the lead is the part beyond the
+  //line of sight itself. Frozen in the terminal phase where the rates blow up.
+  if (!terminal) {
+    leadAngle += ((navigationGain - 1)*target.bearingRate - pursuitGain*leadAngle)*dt;
+    leadAngle = max(-maxLead, min(maxLead, leadAngle));
+    verticalLead += ((navigationGain - 1)*target.elevationRate - pursuitGain*verticalLead)*dt;
+    verticalLead = max(-maxLead, min(maxLead, verticalLead));
+  }
+  pathAngle = max(-60.0, min(60.0, target.elevation + verticalLead));
+  climbRate = max(speed, 0.0)*tan(pathAngle*DEG_TO_RAD);
+  climbRate = max(-maxClimbRate, min(maxClimbRate, climbRate));
+
+  if (terminal) {
+    forward = forwardTerminal;
+  } else {
+    //slow down while the line of sight swings, the turn has to catch up first
+    double wanted = cruiseSpeed;
+    if (!isnan(range)) {
+      double far = (range - nearRange)/(farRange - nearRange);
+      wanted += (farSpeed - cruiseSpeed)*max(0.0, min(1.0, far));
+    }
+    wanted /= 1 + losRate/losRateScale;
+    forward = wanted/SPEED_PER_FORWARD + speedGain*(wanted - closingSpeed);
+    forward = max(0.0, min(maxForward, forward));
+  }
+  return true;
+}
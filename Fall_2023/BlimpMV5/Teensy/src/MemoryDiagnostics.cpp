@@ -0,0 +1,213 @@
+#include "MemoryDiagnostics.h"
+
+#include <Arduino.h>
+#include <malloc.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+extern "C" {
+  extern unsigned long _ebss;     // end of .bss in DTCM, the stack grows down towards it
+  extern unsigned long _estack;
+  extern unsigned long _heap_end; // end of RAM2
+  extern char* __brkval;          // heap top, moved by _sbrk
+}
+#else
+  #include <stdio.h>
+  #include <new>
+  #ifdef __GLIBC__
+    #include <execinfo.h>
+  #endif
+#endif
+
+namespace MemoryDiagnostics {
+  std::atomic<uint32_t> allocations(0);
+  std::atomic<uint32_t> frees(0);
+  std::atomic<uint32_t> forbiddenAllocations(0);
+#ifdef ARDUINO
+  bool forbidAllocations = false;
+#else
+  thread_local bool forbidAllocations = false;
+#endif
+
+  // bytes held through the hooks, for the peak between snapshots
+  static std::atomic<uint32_t> liveBytes(0);
+  static std::atomic<uint32_t> livePeak(0);
+
+  static uint32_t heapPeak = 0;
+  static uint32_t lastAllocations = 0;
+  static uint32_t lastSnapshotMillis = 0;
+
+#ifdef ARDUINO
+  static uint32_t* stackBottom = nullptr;
+  static uint32_t* stackTop = nullptr;
+  static uint32_t* stackLow = nullptr;    // lowest word seen overwritten
+  static uint32_t* scanPos = nullptr;
+#endif
+
+  static void countAllocation() {
+    allocations++;
+    if (forbidAllocations) {
+      forbiddenAllocations++;
+#ifndef ARDUINO
+      forbidAllocations = false;
+      fprintf(stderr, "allocation while allocations are forbidden\n");
+#ifdef __GLIBC__
+      void* frames[32];
+      backtrace_symbols_fd(frames, backtrace(frames, 32), 2);
+#endif
+      abort();
+#endif
+    }
+  }
+
+  static void allocated(void* p) {
+    if (p == nullptr) return;
+    uint32_t live = liveBytes += malloc_usable_size(p);
+    uint32_t peak = livePeak;
+    while (live > peak && !livePeak.compare_exchange_weak(peak, live)) {
+    }
+  }
+
+  static void released(void* p) {
+    if (p == nullptr) return;
+    frees++;
+    liveBytes -= malloc_usable_size(p);
+  }
+
+  void Init() {
+#ifdef ARDUINO
+    //paint from the end of .bss up to just below this frame
+    stackBottom = (uint32_t*)&_ebss;
+    stackTop = (uint32_t*)&_estack;
+    uint32_t* sp = (uint32_t*)__builtin_frame_address(0) - MEMDIAG_STACK_MARGIN/4;
+    for (uint32_t* p = stackBottom; p < sp; p++) *p = MEMDIAG_STACK_PAINT;
+    stackLow = sp;
+    scanPos = stackBottom;
+#endif
+    heapPeak = 0;
+    lastAllocations = allocations;
+    lastSnapshotMillis = millis();
+  }
+
+  void Update() {
+#ifdef ARDUINO
+    if (stackBottom == nullptr) return;
+    for (int i = 0; i < MEMDIAG_SCAN_WORDS; i++) {
+      if (scanPos >= stackLow) {
+        scanPos = stackBottom;
+        return;
+      }
+      if (*scanPos != MEMDIAG_STACK_PAINT) {
+        stackLow = scanPos;
+        scanPos = stackBottom;
+        return;
+      }
+      scanPos++;
+    }
+#endif
+  }
+
+  MemoryStats snapshot() {
+    MemoryStats stats;
+#ifdef ARDUINO
+    struct mallinfo info = mallinfo();
+    stats.heapUsed = info.uordblks;
+    stats.heapFree = info.fordblks - info.keepcost;
+    stats.largestFree = info.keepcost + ((char*)&_heap_end - __brkval);
+    stats.stackUsed = (char*)stackTop - (char*)stackLow;
+    stats.stackSize = (char*)stackTop - (char*)stackBottom;
+#else
+    struct mallinfo2 info = mallinfo2();
+    stats.heapUsed = info.uordblks;
+    stats.heapFree = info.fordblks - info.keepcost;
+    stats.largestFree = info.keepcost;
+    stats.stackUsed = 0;
+    stats.stackSize = 0;
+#endif
+    uint32_t peak = livePeak;
+    if (stats.heapUsed > peak) peak = stats.heapUsed;
+    if (peak > heapPeak) heapPeak = peak;
+    livePeak = (uint32_t)liveBytes;
+    stats.heapPeak = heapPeak;
+
+    uint32_t now = millis();
+    stats.allocations = allocations;
+    stats.allocationRate = now > lastSnapshotMillis ?
+        (stats.allocations - lastAllocations)*1000.0f/(now - lastSnapshotMillis) : 0;
+    lastAllocations = stats.allocations;
+    lastSnapshotMillis = now;
+    return stats;
+  }
+}
+
+using namespace MemoryDiagnostics;
+
+#if defined(ARDUINO) && defined(MEMDIAG_WRAP_MALLOC)
+// -Wl,--wrap=malloc etc. route every call through here, String and operator new included
+extern "C" {
+  void* __real_malloc(size_t size);
+  void* __real_calloc(size_t count, size_t size);
+  void* __real_realloc(void* p, size_t size);
+  void __real_free(void* p);
+
+  void* __wrap_malloc(size_t size) {
+    countAllocation();
+    void* p = __real_malloc(size);
+    allocated(p);
+    return p;
+  }
+
+  void* __wrap_calloc(size_t count, size_t size) {
+    countAllocation();
+    void* p = __real_calloc(count, size);
+    allocated(p);
+    return p;
+  }
+
+  void* __wrap_realloc(void* p, size_t size) {
+    countAllocation();
+    if (p != nullptr) liveBytes -= malloc_usable_size(p);
+    void* q = __real_realloc(p, size);
+    if (q == nullptr && p != nullptr) liveBytes += malloc_usable_size(p);
+    allocated(q);
+    return q;
+  }
+
+  void __wrap_free(void* p) {
+    released(p);
+    __real_free(p);
+  }
+}
+#endif
+
+#ifndef ARDUINO
+// The host libstdc++ can't be wrapped at link time, replace operator new/delete instead
+void* operator new(size_t size) {
+  countAllocation();
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  allocated(p);
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  released(p);
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  operator delete(p);
+}
+#endif
@@ -1,23 +1,33 @@
 #include "MotorMapping.h"
 #include "BlimpClock.h"
 #include "ROSHandler.h"
+#include "MemoryPlacement.h"
 
 BlimpClock rosClock_motorWrite;
 
-void MotorMapping::Init(int LSPin, int RSPin, int LMPin, int RMPin, double newdeadband, double newturnOnCom, double newminCom, double newmaxCom, double servoFilter, ROSHandler* rosHandlerPtr) {
+#define ATAN_LUT_SIZE 256
+
+// atan(r) in degrees for r in [0,1], one extra entry for the interpolation at r = 1
+struct AtanTable {
+  float deg[ATAN_LUT_SIZE + 2];
+  AtanTable() {
+    for (int i = 0; i <= ATAN_LUT_SIZE + 1; i++) deg[i] = atan((double)i / ATAN_LUT_SIZE) * RAD_TO_DEG;
+  }
+};
+static const AtanTable atanTable;
+
+COLD_CODE void MotorMapping::Init(int LSPin, int RSPin, int LMPin, int RMPin, double newdeadband, double newturnOnCom, double newminCom, double newmaxCom, double servoFilter, ROSHandler* rosHandlerPtr) {
     this->rosHandlerPtr = rosHandlerPtr;
     
     //set servo pins
     this->LServo.attach(LSPin);
     this->RServo.attach(RSPin);
-    this->LMotor.attach(LMPin);
-    this->RMotor.attach(RMPin);
 
     //set initial values
     this->LServo.write(135);
     this->RServo.write(45);
-    this->LMotor.write(1500);
-    this->RMotor.write(1500);
+    //ESCs at neutral
+    this->motorOutput.Init(LMPin, RMPin, ESC_PROTOCOL);
 
     this->servoLFilter.setAlpha(servoFilter);
     this->servoRFilter.setAlpha(servoFilter);
@@ -28,9 +38,18 @@ void MotorMapping::Init(int LSPin, int RSPin, int LMPin, int RMPin, double newde
     this->maxCom = newmaxCom;
 
     rosClock_motorWrite.setFrequency(5);
+
+    this->servoREstimate = 45;
+    this->servoLEstimate = 135;
+    this->lastUpdateMicros = micros();
+}
+
+void MotorMapping::setServoSlewRate(double degPerSec, double flipMargin) {
+    this->servoSlewRate = degPerSec;
+    this->servoFlipMargin = flipMargin;
 }
 
-void MotorMapping::update(double pitch, double forward, double up, double yaw) {
+HOT_CODE void MotorMapping::update(double pitch, double forward, double up, double yaw) {
 
   if(rosHandlerPtr != nullptr && rosClock_motorWrite.isReady()){
     String msg = "";
@@ -41,183 +60,46 @@ void MotorMapping::update(double pitch, double forward, double up, double yaw) {
     rosHandlerPtr->PublishTopic_String("motorMapping",msg);
   }
   
-  //yaw positive right, negative left for positive yaw
-  //calcs are in motor command domain that is shifted by -1500 so that zero throttle is the origin
-  //yaw, up, and forward are bounded by -500 to 500;
-
-
-  //bound combined motor commands
-  if (up > 500) {
-    up = 500;
-  } else if (up < -500) {
-    up = -500;
-  }
-  
-  if (yaw > 500) {
-    yaw = 500;
-  } else if (yaw < -500) {
-    yaw = -500;
-  }
-
-  if (forward > 500) {
-    forward = 500;
-  } else if (forward < -500) {
-    forward = -500;
-  }
-
-  //maintain yaw after sum
-  if (forward + yaw > 500) {
-    forward = - yaw+500;
-  }
-
-  if (forward - yaw > 500) {
-    forward = yaw+500;
-  }
-
-  if (forward - yaw < -500) {
-    forward = yaw - 500;
-  }
+  MotorMix m = mix(pitch, forward, up, yaw);
 
-  if (forward + yaw < -500) {
-    forward = -yaw - 500;
+  if (servoSlewRate > 0) {
+    chooseSide(m.servoR, m.magR, servoREstimate);
+    chooseSide(m.servoL, m.magL, servoLEstimate);
   }
-  
-  double brx = forward + yaw;
-  double brz = up;
-
-  double blx = forward - yaw;
-  double blz = up;
-
-  /*
-  Serial.print(brx);
-  Serial.print(" :brx \t");
-  Serial.print(blx);
-  Serial.print(" :blx\t");
-
-  Serial.print(brz);
-  Serial.print(" :brz \t");
-  Serial.print(blz);
-  Serial.println(" :blz\n");
-  
-  Serial.print(forward);
-  Serial.print(" :f\t");
-  Serial.print(yaw);
-  Serial.print(" :y\t");
-  Serial.print(up);
-  Serial.println(" :u \n");
-  */
-
-  
-  //right motor calculation
-  double thetaR = atan2(brz, brx);
-
-  //left motor calculation
-  double thetaL = atan2(blz, blx);
-
-  //mag calculation
-  double magR = sqrt(pow(brx,2)+pow(brz,2))*sqrt(2.0)/2.0;
-  double magL = sqrt(pow(blx,2)+pow(blz,2))*sqrt(2.0)/2.0;
-
-  //quadrant validation
-  double sR = sin(thetaR)*magR;
-  double cR = cos(thetaR)*magR;
-
-  double sL = sin(thetaL)*magL;
-  double cL = cos(thetaL)*magL;
-
-  /*
-  Serial.println("quadrant validation");
-  Serial.print(brx*sqrt(2.0)/2.0);
-  Serial.print("\t, -> brx = ");
-  Serial.println(cR);
-
-  Serial.print(brz*sqrt(2.0)/2.0);
-  Serial.print("\t, -> brz = ");
-  Serial.println(sR);
-
-  Serial.print(blx*sqrt(2.0)/2.0);
-  Serial.print("\t, -> blx = ");
-  Serial.println(cL);
 
-  Serial.print(blz*sqrt(2.0)/2.0);
-  Serial.print("\t, -> blz = ");
-  Serial.println(sL);
+  double RServoAngle = servoRFilter.filter(m.servoR);
+  double LServoAngle = servoLFilter.filter(m.servoL);
 
-  Serial.println();
-  */
-  //conversion to degrees for servo
-  thetaR = thetaR*180/3.1415 - pitch;
-  thetaL = thetaL*180/3.1415 - pitch;
-  /*
-  Serial.println("Coordinate Orientation");
-  Serial.print("ThetaR: ");
-  Serial.print(thetaR);
-  Serial.print("\tThetaL: ");
-  Serial.println(thetaL);
-  Serial.println();
-  */
-  //switch to servo angles
-  thetaR = 45 + thetaR;
-  thetaL = 135 - thetaL;
-
-  //make sure the angles are within sero motion limits
-
-  if (thetaR > 180) {
-    thetaR -= 180;
-    magR = -magR;
-  }
+  RServo.write(RServoAngle);
+  LServo.write(LServoAngle);
 
-  if (thetaR < 0) {
-    thetaR += 180;
-    magR = -magR;
-  }
+  //the servos lag, only push along the thrust direction they already give
+  if (servoSlewRate > 0) {
+    uint32_t now = micros();
+    double dt = min((now - lastUpdateMicros) / 1000000.0, 0.1);
+    lastUpdateMicros = now;
 
-  if (thetaL > 180) {
-    thetaL -= 180;
-    magL = -magL;
+    servoREstimate = slewTowards(servoREstimate, RServoAngle, servoSlewRate * dt);
+    servoLEstimate = slewTowards(servoLEstimate, LServoAngle, servoSlewRate * dt);
+    m.magR *= fmaxf(cosf((servoREstimate - m.servoR) * (float)DEG_TO_RAD), 0);
+    m.magL *= fmaxf(cosf((servoLEstimate - m.servoL) * (float)DEG_TO_RAD), 0);
   }
 
-  if (thetaL < 0) {
-    thetaL += 180;
-    magL = -magL;
-  }
+  //motorCom expects [-1000,1000], anything beyond is lost to the ESC limits
+  double peak = max(fabsf(m.magR), fabsf(m.magL));
+  double escScale = peak > 1000 ? 1000 / peak : 1;
+  this->yawAuthority = (abs(yaw) > 500 ? 500 / abs(yaw) : 1) * escScale;
+  this->upAuthority = (abs(up) > 500 ? 500 / abs(up) : 1) * escScale;
 
+  double RMotorMag = this->motorCom(m.magR);
+  double LMotorMag = this->motorCom(m.magL);
   
-  //comute correct motor direction
-  /*
-  Serial.println("Servo Orientation");
-  Serial.print("ThetaR: ");
-  Serial.print(thetaR);
-  Serial.print("\tThetaL: ");
-  Serial.println(thetaL);
-  Serial.println();
-  Serial.print("MagR: ");
-  Serial.print(magR);
-  Serial.print("\tMagL: ");
-  Serial.print(magL);
-  Serial.println("\n");
-  */
-  //shift motor mag to pulse width in microseconds
-  magR = magR * 2;
-  magL = magL * 2;
-
-    // char msg[128];
-    // snprintf(msg, 128, "magL=%0.2f, magR=%0.2f",magL, magR);
-    // Serial.println(msg);
+  motorOutput.write(LMotorMag, RMotorMag);
 
-  double RServoAngle = servoRFilter.filter(thetaR);
-  double LServoAngle = servoLFilter.filter(thetaL);
-
-  RServo.write(RServoAngle);
-  LServo.write(LServoAngle);
-
-  //delay(50); // Delay motors until servo motors reach desired position
-
-  double RMotorMag = this->motorCom(magR);
-  double LMotorMag = this->motorCom(magL);
-  
-  RMotor.write(RMotorMag);
-  LMotor.write(LMotorMag);
+  this->outRServo = RServoAngle;
+  this->outLServo = LServoAngle;
+  this->outRMotor = RMotorMag;
+  this->outLMotor = LMotorMag;
 
   /*
   if(rosHandlerPtr != nullptr && rosClock_motorWrite.isReady()){
@@ -231,6 +113,87 @@ void MotorMapping::update(double pitch, double forward, double up, double yaw) {
   */
 }
 
+HOT_CODE MotorMix MotorMapping::mix(float pitch, float forward, float up, float yaw) {
+  //yaw positive right, negative left for positive yaw
+  //calcs are in motor command domain that is shifted by -1500 so that zero throttle is the origin
+  //yaw, up, and forward are bounded by -500 to 500;
+  up = fminf(fmaxf(up, -500), 500);
+  yaw = fminf(fmaxf(yaw, -500), 500);
+
+  //maintain yaw after sum: |forward| + |yaw| <= 500
+  float forwardLimit = 500 - fabsf(yaw);
+  forward = fminf(fmaxf(forward, -forwardLimit), forwardLimit);
+
+  MotorMix m;
+  //right motor, servo at 45 deg points forward
+  solveSide(forward + yaw, up, pitch, m.servoR, m.magR);
+  m.servoR = 45 + m.servoR;
+  //left motor is mirrored, servo at 135 deg points forward
+  solveSide(forward - yaw, up, pitch, m.servoL, m.magL);
+  m.servoL = 135 - m.servoL;
+
+  //make sure the angles are within servo motion limits, reversing the motor instead
+  flipIntoRange(m.servoR, m.magR);
+  flipIntoRange(m.servoL, m.magL);
+  return m;
+}
+
+HOT_CODE void MotorMapping::solveSide(float x, float z, float pitch, float& theta, float& mag) {
+  theta = atan2Deg(z, x) - pitch;
+  //mag = |(x,z)|*sqrt(2)/2, then shifted to pulse width in microseconds (*2)
+  mag = sqrtf(x*x + z*z) * (float)M_SQRT2;
+}
+
+HOT_CODE void MotorMapping::flipIntoRange(float& angle, float& mag) {
+  if (angle > 180) {
+    angle -= 180;
+    mag = -mag;
+  }
+  if (angle < 0) {
+    angle += 180;
+    mag = -mag;
+  }
+}
+
+HOT_CODE float MotorMapping::atan2Deg(float y, float x) {
+#if MOTORMAPPING_ATAN_LUT
+  float ax = fabsf(x);
+  float ay = fabsf(y);
+  if (ax == 0 && ay == 0) return 0;
+
+  //reduce to the first octant, r in [0,1]
+  bool steep = ay > ax;
+  float r = steep ? ax / ay : ay / ax;
+  float index = r * ATAN_LUT_SIZE;
+  int i = (int)index;
+  float a = atanTable.deg[i] + (index - i) * (atanTable.deg[i + 1] - atanTable.deg[i]);
+
+  if (steep) a = 90 - a;
+  if (x < 0) a = 180 - a;
+  return y < 0 ? -a : a;
+#else
+  return atan2f(y, x) * (float)RAD_TO_DEG;
+#endif
+}
+
+HOT_CODE void MotorMapping::chooseSide(float& angle, float& mag, double estimate) {
+  //the same thrust from the other end of the servo range with the motor reversed,
+  //clamped into the range and paid for by the direction error
+  float other = angle < 90 ? angle + 180 : angle - 180;
+  float clamped = fminf(fmaxf(other, 0), 180);
+  float error = fabsf(other - clamped);
+  if (error > servoFlipMargin) return;
+
+  if (fabsf(clamped - estimate) < fabsf(angle - estimate)) {
+    angle = clamped;
+    mag = -mag * cosf(error * (float)DEG_TO_RAD);
+  }
+}
+
+HOT_CODE double MotorMapping::slewTowards(double estimate, double command, double maxStep) {
+  return estimate + max(-maxStep, min(command - estimate, maxStep));
+}
+
 void MotorMapping::writeLServo(double angle) {
   this->LServo.write(angle);
 }
@@ -239,7 +202,7 @@ void MotorMapping::writeRServo(double angle) {
   this->RServo.write(angle);
 }
 
-double MotorMapping::motorCom(double command) {
+HOT_CODE double MotorMapping::motorCom(double command) {
     //input from -1000, to 1000 is expected from controllers (from command)
     double adjustedCom = 1500;
     
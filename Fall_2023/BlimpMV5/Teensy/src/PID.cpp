@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <cmath>
 #include "PID.h"
+#include "MemoryPlacement.h"
 
 using namespace std;
 
@@ -37,7 +38,19 @@ void PID::setDLimit(double dLimit) {
     _d_limit = abs(dLimit);
 }
 
-double PID::calculate(double setpoint, double pv, double dt) {
+void PID::setKp(double kp) {
+    _kp = kp;
+}
+
+void PID::setKi(double ki) {
+    _ki = ki;
+}
+
+void PID::setKd(double kd) {
+    _kd = kd;
+}
+
+HOT_CODE double PID::calculate(double setpoint, double pv, double dt) {
     // Calculate error
     _error = setpoint - pv;
     
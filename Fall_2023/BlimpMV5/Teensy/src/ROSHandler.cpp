@@ -3,6 +3,8 @@
 #include <stdexcept>
 #include <algorithm>
 #include <Arduino.h>
+#include "DebugLog.h"
+#include "BootSequence.h"
 
 using namespace std;
 using namespace std::placeholders;
@@ -77,6 +79,9 @@ void ROSHandler::PublishTopic_Int64(String topicName, int64_t value){
 }
 
 void ROSHandler::callback_UDPRecvMsg(String message){
+    // Anything from the bridge means the whole chain is up
+    if(bootSequence.mark(BOOT_ROS)) DEBUG_INFO(MSG_ROS_CONNECTED);
+
     char messageFlag = message.charAt(0);
     message = message.substring(1);
     if(messageFlag == flag_publish){
@@ -234,7 +239,7 @@ double ROSHandler::StringToDouble(String str){
     // Serial.print("\n");
     if(str.length()==0) return 0;
     else if(any_of(str.begin(),str.end(),::isalpha)){
-        Serial.print("UDP Message corrupted, throwing out data\n");
+        DEBUG_WARN(MSG_UDP_CORRUPTED);
         return 0;
     }
     double value = stod(&str[0]);
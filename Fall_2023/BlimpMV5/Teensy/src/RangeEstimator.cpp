@@ -0,0 +1,81 @@
+#include "RangeEstimator.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+void RangeEstimator::Init() {
+  reset();
+}
+
+void RangeEstimator::reset() {
+  started = false;
+  outliers = 0;
+  range = NAN;
+  rangeVariance = NAN;
+  rangeRate = NAN;
+}
+
+void RangeEstimator::start(double z, double r) {
+  inverse = z;
+  inverseRate = 0;
+  p00 = r;
+  p01 = 0;
+  p11 = z * z * z * z;   // (1 m/s)^2 in range rate
+  outliers = 0;
+  started = true;
+}
+
+void RangeEstimator::update(double time, double width) {
+  if (isnan(width) || width <= 0) return;
+
+  // measured inverse range and its variance
+  double f = (RESOLUTION_WIDTH / 2) / tan(CAMERA_HFOV / 2 * DEG_TO_RAD);
+  double z = width / (f * TARGET_DIAMETER);
+  double sigma = (pixelNoise + relativeNoise * width) / (f * TARGET_DIAMETER);
+  double r = sigma * sigma;
+
+  if (!started || time - lastTime > timeout) {
+    start(z, r);
+  } else {
+    // a constant range rate is not a constant inverse range rate, d(rate)/dt = 2 rate^2 / inverse.
+    // P = F P F' + Q, F = [1 dt; 0 1], Q from white range acceleration mapped to the inverse
+    double dt = time - lastTime;
+    double dt2 = dt * dt;
+    double q = qAccel * inverse * inverse * inverse * inverse;
+    if (inverse > 0) inverseRate += 2 * inverseRate * inverseRate / inverse * dt;
+    inverse += inverseRate * dt;
+    p00 += dt * (2 * p01 + dt * p11) + q * dt2 * dt / 3;
+    p01 += dt * p11 + q * dt2 / 2;
+    p11 += q * dt;
+
+    double s = p00 + r;
+    double innovation = z - inverse;
+    if (innovation * innovation / s > gate) {
+      // a few in a row is a different target, not noise
+      if (++outliers >= 3) start(z, r);
+    } else {
+      outliers = 0;
+      double k0 = p00 / s;
+      double k1 = p01 / s;
+      inverse += k0 * innovation;
+      inverseRate += k1 * innovation;
+      p11 -= k1 * p01;
+      p01 -= k0 * p01;
+      p00 -= k0 * p00;
+    }
+  }
+  lastTime = time;
+
+  if (inverse > 0) {
+    range = 1 / inverse;
+    rangeVariance = p00 * range * range * range * range;
+    rangeRate = -inverseRate * range * range;
+  } else {
+    range = rangeVariance = rangeRate = NAN;
+  }
+}
+
+bool RangeEstimator::valid(double time) const {
+  return started && !isnan(range) && time - lastTime <= timeout &&
+         sqrt(rangeVariance) < maxRelativeSigma * range;
+}
@@ -0,0 +1,96 @@
+#include "SearchPlanner.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+using namespace std;
+
+// Angle difference in [-180, 180)
+static double wrap180(double angle) {
+  return angle - 360*floor((angle + 180)/360);
+}
+
+void SearchPlanner::Init() {
+  scanning = true;
+  yawRate = 0;
+  forward = 0;
+  heightOffset = 0;
+  speed = 0;
+  sweepDirection = -1;
+  reset(0, NAN);
+}
+
+void SearchPlanner::reset(double heading, double lastAzimuth) {
+  scanning = true;
+  turned = 0;
+  lastHeading = heading;
+  leg = 0;
+  heightOffset = 0;
+
+  if (isnan(lastAzimuth)) {
+    //the old constant search turned right
+    spinDirection = -1;
+    baseHeading = heading;
+  } else {
+    //turn towards where the target was last seen and start the pattern along it
+    spinDirection = wrap180(lastAzimuth - heading) >= 0 ? 1 : -1;
+    baseHeading = lastAzimuth;
+  }
+  turnDirection = spinDirection;
+}
+
+void SearchPlanner::startLeg(int n) {
+  leg = n;
+  legDistance = 0;
+  scanning = false;
+
+  if (pattern == SEARCH_LAWNMOWER) {
+    int lanes = max(1, (int)(arenaWidth/laneSpacing));
+    int lane = n/2;
+    if (n % 2 == 0) {
+      headingSetpoint = baseHeading + (lane % 2 ? 180 : 0);
+      legLength = arenaLength;
+    } else {
+      //step across, back the other way once the arena width is covered
+      double across = (lane/lanes) % 2 ? -turnDirection : turnDirection;
+      headingSetpoint = baseHeading + across*90;
+      legLength = laneSpacing;
+    }
+  } else {
+    headingSetpoint = baseHeading + turnDirection*90*n;
+    legLength = laneSpacing*(n/2 + 1);
+    if (legLength > max(arenaLength, arenaWidth)) {
+      //covered the arena, scan again and restart from here
+      reset(lastHeading, NAN);
+    }
+  }
+}
+
+void SearchPlanner::update(double heading, double dt) {
+  speed += (SPEED_PER_FORWARD*forward - speed)*min(dt/SPEED_TAU, 1.0);
+
+  if (scanning) {
+    turned += fabs(heading - lastHeading);
+    lastHeading = heading;
+    yawRate = spinDirection*scanRate;
+    forward = 0;
+
+    if (pattern == SEARCH_VERTICAL_SWEEP) {
+      heightOffset += sweepDirection*sweepRate*dt;
+      if (heightOffset < -sweepDepth) sweepDirection = 1;
+      if (heightOffset > 0) sweepDirection = -1;
+      heightOffset = max(-sweepDepth, min(0.0, heightOffset));
+    } else if (turned >= 360) {
+      startLeg(0);
+    }
+    return;
+  }
+  lastHeading = heading;
+
+  //unwrapped so the heading hold takes the short way round
+  headingSetpoint = heading + wrap180(headingSetpoint - heading);
+  forward = fabs(headingSetpoint - heading) < turnTolerance ? searchForward : 0;
+
+  legDistance += speed*dt;
+  if (legDistance >= legLength) startLeg(leg + 1);
+}
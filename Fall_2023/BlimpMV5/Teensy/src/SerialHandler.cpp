@@ -1,7 +1,14 @@
 #include "SerialHandler.h"
+#include "TeensyParams.h"
+#include "MemoryPlacement.h"
 
 void SerialHandler::Init(){
     Serial.begin(115200);
+    // Bursts of publishes and parameter messages in OCRAM instead of blocking
+    static BULK_DATA uint8_t rxBuffer[ESP_RX_BUFFER];
+    static BULK_DATA uint8_t txBuffer[ESP_TX_BUFFER];
+    Serial1.addMemoryForRead(rxBuffer, sizeof(rxBuffer));
+    Serial1.addMemoryForWrite(txBuffer, sizeof(txBuffer));
     Serial1.begin(115200);
 }
 
@@ -0,0 +1,148 @@
+#include "TargetTracker.h"
+
+#include <Arduino.h>
+#include <math.h>
+#include "MemoryPlacement.h"
+
+COLD_CODE void TargetTracker::Init() {
+  for (Track& t : tracks) t = Track();
+  for (double& azimuth : lastDetection) azimuth = NAN;
+}
+
+void TargetTracker::Axis::start(float z, float r) {
+  angle = z;
+  rate = 0;
+  p00 = r;
+  p01 = 0;
+  p11 = 100;    // (10 deg/s)^2, nothing known about the target motion yet
+}
+
+HOT_CODE void TargetTracker::Axis::predict(float dt, float q) {
+  angle += rate * dt;
+  // P = F P F' + Q, F = [1 dt; 0 1], Q from white acceleration
+  float dt2 = dt * dt;
+  p00 += dt * (2 * p01 + dt * p11) + q * dt2 * dt / 3;
+  p01 += dt * p11 + q * dt2 / 2;
+  p11 += q * dt;
+}
+
+HOT_CODE void TargetTracker::Axis::correct(float z, float r) {
+  float s = p00 + r;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+  float innovation = z - angle;
+  angle += k0 * innovation;
+  rate += k1 * innovation;
+  p11 -= k1 * p01;
+  p01 -= k0 * p01;
+  p00 -= k0 * p00;
+}
+
+int TargetTracker::newTrack(int color) {
+  // a free slot, else the stalest tentative track, of the same colour if there is one
+  int slot = -1;
+  int sameColor = -1;
+  for (int i = 0; i < TRACKER_MAX_TRACKS; i++) {
+    const Track& t = tracks[i];
+    if (!t.used) return i;
+    if (t.confirmed) continue;
+    if (slot < 0 || t.lastTime < tracks[slot].lastTime) slot = i;
+    if (t.color == color && (sameColor < 0 || t.lastTime < tracks[sameColor].lastTime)) sameColor = i;
+  }
+  return sameColor >= 0 ? sameColor : slot;
+}
+
+HOT_CODE void TargetTracker::update(double time, double heading, const float x[TRACKER_COLORS], const float y[TRACKER_COLORS]) {
+  float tanHalf = tanf(CAMERA_HFOV / 2 * DEG_TO_RAD);
+  bool updated[TRACKER_MAX_TRACKS] = {false};
+
+  for (int color = 0; color < TRACKER_COLORS; color++) {
+    if (isnan(x[color]) || isnan(y[color])) continue;
+
+    // positive x is right of centre, a negative yaw
+    float azimuth = heading - atanf(x[color] * tanHalf) * RAD_TO_DEG;
+    float elevation = atanf(y[color] * tanHalf) * RAD_TO_DEG;
+    lastDetection[color] = azimuth;
+
+    // nearest track of this colour inside the gate
+    int best = -1;
+    float bestDistance = gate;
+    for (int i = 0; i < TRACKER_MAX_TRACKS; i++) {
+      Track& t = tracks[i];
+      if (!t.used || t.color != color || updated[i]) continue;
+
+      float dt = time - t.lastTime;
+      Axis az = t.azimuth;
+      Axis el = t.elevation;
+      az.predict(dt, qAccel);
+      el.predict(dt, qAccel);
+      float dAz = azimuth - az.angle;
+      float dEl = elevation - el.angle;
+      float distance = dAz * dAz / az.innovationVariance(rAngle) + dEl * dEl / el.innovationVariance(rAngle);
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        best = i;
+      }
+    }
+
+    if (best >= 0) {
+      Track& t = tracks[best];
+      float dt = time - t.lastTime;
+      t.azimuth.predict(dt, qAccel);
+      t.elevation.predict(dt, qAccel);
+      t.azimuth.correct(azimuth, rAngle);
+      t.elevation.correct(elevation, rAngle);
+      t.lastTime = time;
+      if (t.hits < 255) t.hits++;
+      if (t.hits >= TRACK_CONFIRM_HITS) t.confirmed = true;
+      updated[best] = true;
+      continue;
+    }
+
+    int slot = newTrack(color);
+    if (slot < 0) continue;
+    Track& t = tracks[slot];
+    t.used = true;
+    t.confirmed = false;
+    t.color = color;
+    t.hits = 1;
+    t.lastTime = time;
+    t.azimuth.start(azimuth, rAngle);
+    t.elevation.start(elevation, rAngle);
+    updated[slot] = true;
+  }
+
+  // tentative tracks must be seen every frame, confirmed ones within the timeout
+  for (int i = 0; i < TRACKER_MAX_TRACKS; i++) {
+    Track& t = tracks[i];
+    if (!t.used || updated[i]) continue;
+    if (!t.confirmed || time - t.lastTime > timeout) t.used = false;
+  }
+}
+
+TargetTrack TargetTracker::track(int color, double time, double heading) const {
+  TargetTrack out;
+  const Track* best = nullptr;
+  for (const Track& t : tracks) {
+    if (!t.used || !t.confirmed || t.color != color) continue;
+    if (best == nullptr || t.lastTime > best->lastTime) best = &t;
+  }
+  if (best == nullptr || time - best->lastTime > timeout) return out;
+
+  float dt = time - best->lastTime;
+  out.valid = true;
+  out.age = dt;
+  out.bearing = best->azimuth.angle + best->azimuth.rate * dt - heading;
+  out.bearingRate = best->azimuth.rate;
+  out.elevation = best->elevation.angle + best->elevation.rate * dt;
+  out.elevationRate = best->elevation.rate;
+  return out;
+}
+
+int TargetTracker::confirmedTracks() const {
+  int n = 0;
+  for (const Track& t : tracks) {
+    if (t.used && t.confirmed) n++;
+  }
+  return n;
+}
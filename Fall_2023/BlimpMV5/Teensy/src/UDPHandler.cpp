@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "UDPHandler.h"
+#include "BootSequence.h"
+#include "DebugLog.h"
 #include <functional>
 
 using namespace std;
@@ -8,6 +10,10 @@ using namespace std::placeholders;
 void UDPHandler::Init(){
     serialHandler.callback_SerialRecvMsg = bind(&UDPHandler::callback_SerialRecvMsg, this, _1);
     serialHandler.Init();
+
+    // Offer the connection details right away, an ESP that is already up
+    // joins WiFi without waiting for its next status report
+    SendConnectionData();
 }
 
 void UDPHandler::Update(){
@@ -21,27 +27,36 @@ void UDPHandler::SendUDP(char flag, String message){
 void UDPHandler::callback_SerialRecvMsg(String message){
     char messageFlag = message.charAt(0);
     message = message.substring(1);
+    bootSequence.mark(BOOT_ESP);
     if(messageFlag == flag_UDPConnectionData){
         // UDP connection status
         bool connectedToUDP = (message.charAt(0) != '0');
-        Serial.println("ESP connected to WiFi: " + String(connectedToUDP));
+        if(connectedToUDP != espConnected){
+            espConnected = connectedToUDP;
+            DEBUG_INFO(MSG_ESP_WIFI, espConnected);
+        }
         if(!connectedToUDP){
             // No active UDP connection
             // Send UDP connection to ESP
-            String initMsg = "";
-            initMsg += StringLength(wifi_ssid, 2) + wifi_ssid;
-            initMsg += StringLength(wifi_password, 2) + wifi_password;
-            initMsg += StringLength(bridgeIP, 2) + bridgeIP;
-            initMsg += StringLength(UDP_port, 1) + UDP_port;
-            serialHandler.SendSerial(flag_UDPConnectionData, initMsg);
+            SendConnectionData();
         }else{
             // There is an active UDP connection
+            bootSequence.mark(BOOT_WIFI);
         }
     }else if(messageFlag == flag_UDPMessage){
         callback_UDPRecvMsg(message);
     }
 }
 
+void UDPHandler::SendConnectionData(){
+    String initMsg = "";
+    initMsg += StringLength(wifi_ssid, 2) + wifi_ssid;
+    initMsg += StringLength(wifi_password, 2) + wifi_password;
+    initMsg += StringLength(bridgeIP, 2) + bridgeIP;
+    initMsg += StringLength(UDP_port, 1) + UDP_port;
+    serialHandler.SendSerial(flag_UDPConnectionData, initMsg);
+}
+
 String UDPHandler::StringLength(String variable, unsigned int numDigits){
     int length = variable.length();
     String lengthStr = String(length);
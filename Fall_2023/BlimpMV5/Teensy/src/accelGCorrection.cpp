@@ -1,10 +1,12 @@
+#include <Arduino.h>
 #include "accelGCorrection.h"
+#include "MemoryPlacement.h"
 
 void AccelGCorrection::Init() {
     Serial.println("Starting correction");
 }
 
-void AccelGCorrection::updateData(float accX, float accY, float accZ, float pitch, float roll) {
+HOT_CODE void AccelGCorrection::updateData(float accX, float accY, float accZ, float pitch, float roll) {
 
     pitch = pitch*3.1415/180;
     roll = roll*3.1415/180;
@@ -20,7 +22,7 @@ void AccelGCorrection::updateData(float accX, float accY, float accZ, float pitc
     Matrix<3,3> r = rPitch*rRoll;
 
     //multiply by gravity and subtract from measurement
-    Matrix<3,1> a = {accX*9.81+0.0081, accY*9.81+0.0014, -accZ*9.81+0.1672};
+    Matrix<3,1> a = {accX*9.81*scale[0]+offset[0], accY*9.81*scale[1]+offset[1], -accZ*9.81*scale[2]+offset[2]};
     Matrix<3,1> ac = a-r*g;
 
     Matrix<3,1> ag = ~r*ac;
@@ -1,6 +1,7 @@
 #include "baro_acc_kf.h"
+#include "MemoryPlacement.h"
 
-void BaroAccKF::Init() {
+COLD_CODE void BaroAccKF::Init() {
   this->Xkp = {0,
                0,
                0,
@@ -11,13 +12,13 @@ void BaroAccKF::Init() {
                0,0,2,0,
                0,0,0,2};
                
-  this->Qkp = {0.001,0,0,0,
-               0,0.01,0,0,
-               0,0,0.1,0,
-               0,0,0,0}; 
+  this->Qkp = {qPos,0,0,0,
+               0,qVel,0,0,
+               0,0,qAcc,0,
+               0,0,0,qBias};
 }
 
-void BaroAccKF::predict(float dt) {
+HOT_CODE void BaroAccKF::predict(float dt) {
   Matrix<4,4> A = {1,dt,0,0,
                    0,1,dt,-dt,
                    0,0,1,0,
@@ -36,9 +37,9 @@ void BaroAccKF::predict(float dt) {
   this->b = Xkp(3);
 }
 
-void BaroAccKF::updateBaro(float baro) {
+HOT_CODE void BaroAccKF::updateBaro(float baro) {
   Matrix<1,4> H = {1,0,0,0};
-  Matrix<1,1> R = {0.36};   
+  Matrix<1,1> R = {rBaro};
 
   //update step
   Matrix<1,1> y = {baro};
@@ -61,10 +62,10 @@ void BaroAccKF::updateBaro(float baro) {
   this->b = Xkp(3);
 }
 
-void BaroAccKF::updateAccel(float acc) {
+HOT_CODE void BaroAccKF::updateAccel(float acc) {
 
   Matrix<1,4> H = {0, 0, 1, 0};
-  Matrix<1,1> R = {0.001};
+  Matrix<1,1> R = {rAccel};
 
   //update step
   Matrix<1,1> y = {acc};
@@ -86,3 +87,31 @@ void BaroAccKF::updateAccel(float acc) {
   this->a = Xkp(2);
   this->b = Xkp(3);
 }
+
+COLD_CODE void BaroAccKF::warmStart(float bias, const float variance[4]) {
+  //at rest the accel state reads the bias
+  Xkp(2) = bias;
+  Xkp(3) = bias;
+  for (int i = 2; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      Pkp(i,j) = 0;
+      Pkp(j,i) = 0;
+    }
+    Pkp(i,i) = variance[i];
+  }
+
+  this->a = Xkp(2);
+  this->b = Xkp(3);
+}
+
+COLD_CODE void BaroAccKF::resetHeight() {
+  Xkp(0) = 0;
+  Xkp(1) = 0;
+  this->x = 0;
+  this->v = 0;
+}
+
+void BaroAccKF::getState(float& bias, float variance[4]) const {
+  bias = Xkp(3);
+  for (int i = 0; i < 4; i++) variance[i] = Pkp(i,i);
+}
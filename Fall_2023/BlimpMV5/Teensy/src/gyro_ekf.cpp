@@ -1,16 +1,17 @@
 #include "gyro_ekf.h"
 #include "Arduino.h"
-
-void GyroEKF::Init() {
-    this->Qkp = {0.000001,0,0,0,0,0,0,0,0,
-                0,0.000001,0,0,0,0,0,0,0,
-                0,0,0.000001,0,0,0,0,0,0,
-                0,0,0,0.0001,0,0,0,0,0,
-                0,0,0,0,0.0001,0,0,0,0,
-                0,0,0,0,0,0.0001,0,0,0,
-                0,0,0,0,0,0,0,0,0,
-                0,0,0,0,0,0,0,0,0,
-                0,0,0,0,0,0,0,0,0};
+#include "MemoryPlacement.h"
+
+COLD_CODE void GyroEKF::Init() {
+    this->Qkp = {qAngle,0,0,0,0,0,0,0,0,
+                0,qAngle,0,0,0,0,0,0,0,
+                0,0,qAngle,0,0,0,0,0,0,
+                0,0,0,qRate,0,0,0,0,0,
+                0,0,0,0,qRate,0,0,0,0,
+                0,0,0,0,0,qRate,0,0,0,
+                0,0,0,0,0,0,qBias,0,0,
+                0,0,0,0,0,0,0,qBias,0,
+                0,0,0,0,0,0,0,0,qBias};
 
     this->Pkp = {1,0,0,0,0,0,0,0,0,
                 0,1,0,0,0,0,0,0,0,
@@ -18,9 +19,9 @@ void GyroEKF::Init() {
                 0,0,0,1,0,0,0,0,0,
                 0,0,0,0,1,0,0,0,0,
                 0,0,0,0,0,1,0,0,0,
-                0,0,0,0,0,0,1,0,0,
-                0,0,0,0,0,0,0,1,0,
-                0,0,0,0,0,0,0,0,1};
+                0,0,0,0,0,0,pBias,0,0,
+                0,0,0,0,0,0,0,pBias,0,
+                0,0,0,0,0,0,0,0,pBias};
 
     this->Xkp = {0,
                 0,
@@ -33,7 +34,7 @@ void GyroEKF::Init() {
                 0};
 }
 
-void GyroEKF::predict(float dt) {
+HOT_CODE void GyroEKF::predict(float dt) {
 
     Matrix<9,1> Xk = {Xkp(0) + (cos(Xkp(1))*(Xkp(3)-Xkp(6))+sin(Xkp(1))*(Xkp(5)-Xkp(8)))*dt,
         Xkp(1) + (Xkp(4)-Xkp(7))*dt,
@@ -70,12 +71,12 @@ void GyroEKF::predict(float dt) {
     yawRateB = Xkp(8);
 }
 
-void GyroEKF::updateGyro(float gyrox, float gyroy, float gyroz) {
+HOT_CODE void GyroEKF::updateGyro(float gyrox, float gyroy, float gyroz) {
     Matrix<3,9> H = {0,0,0,1,0,0,0,0,0,
                      0,0,0,0,1,0,0,0,0,
                      0,0,0,0,0,1,0,0,0};
 
-    float r = 0.01;
+    float r = this->rGyro;
 
     Matrix<3,3> R = {r,0,0,
                      0,r,0,
@@ -97,7 +98,7 @@ void GyroEKF::updateGyro(float gyrox, float gyroy, float gyroz) {
     Pkp = Pkp-K*S*~K;   
 }
 
-void GyroEKF::updateAccel(float accx, float accy, float accz) {
+HOT_CODE void GyroEKF::updateAccel(float accx, float accy, float accz) {
     
     //compute angle for the angle update
     float phi = atan2(accy, sqrt(accx*accx+accz*accz));
@@ -106,7 +107,7 @@ void GyroEKF::updateAccel(float accx, float accy, float accz) {
     Matrix<2,9> H = {1,0,0,0,0,0,0,0,0,
                      0,1,0,0,0,0,0,0,0};
 
-    float r = 0.01;
+    float r = this->rAccel;
 
     Matrix<2,2> R = {r,0,
                      0,r};   
@@ -125,4 +126,31 @@ void GyroEKF::updateAccel(float accx, float accy, float accz) {
     Matrix<9,2> K = Pkp*~H*S_inv;
     Xkp = Xkp+K*V;
     Pkp = Pkp-K*S*~K;   
-}
\ No newline at end of file
+}
+
+COLD_CODE void GyroEKF::warmStart(const float bias[3], const float variance[9]) {
+    for (int i = 0; i < 3; i++) {
+        //at rest the rates read the bias
+        Xkp(3+i) = bias[i];
+        Xkp(6+i) = bias[i];
+    }
+    for (int i = 3; i < 9; i++) {
+        for (int j = 0; j < 9; j++) {
+            Pkp(i,j) = 0;
+            Pkp(j,i) = 0;
+        }
+        Pkp(i,i) = variance[i];
+    }
+
+    rollRate = Xkp(3);
+    pitchRate = Xkp(4);
+    yawRate = Xkp(5);
+    rollRateB = Xkp(6);
+    pitchRateB = Xkp(7);
+    yawRateB = Xkp(8);
+}
+
+void GyroEKF::getState(float bias[3], float variance[9]) const {
+    for (int i = 0; i < 3; i++) bias[i] = Xkp(6+i);
+    for (int i = 0; i < 9; i++) variance[i] = Pkp(i,i);
+}
@@ -8,14 +8,18 @@
 #include "BlimpClock.h"
 #include "Servo.h"
 #include "MotorMapping.h"
-#include "accelGCorrection.h"
 #include "BangBang.h"
-#include "baro_acc_kf.h"
-#include "gyro_ekf.h"
-#include "Madgwick_Filter.h"
+#include "FlightController.h"
+#include "CameraLink.h"
 
 #include "ROSHandler.h"
 #include "NonBlockingTimer.h"
+#include "FlightRecorder.h"
+#include "DebugLog.h"
+#include "MemoryDiagnostics.h"
+#include "MemoryPlacement.h"
+#include "BootSequence.h"
+#include "Calibration.h"
 
 
 // IMPORTANT: Critical parameters are located in /include/TeensyParams.h 
@@ -27,40 +31,12 @@ using namespace std;
 ROSHandler rosHandler;
 NonBlockingTimer timer_pub;
 
-enum states {
-  searching,
-  approach,
-}state;
-
 const char* stateNames[] = {IDNAME(searching), IDNAME(approach)};
 const char* stateStr[] = {"searching", "approach"};
 
-enum autonomousStates {
-  manual,
-  autonomous,
-  lost,
-} autonomousState;
-
 const char* autonomousStatesNames[] = {IDNAME(manual), IDNAME(autonomous), IDNAME(lost)};
 const char* autonomousStatesStr[] = {"manual", "autonomous", "lost"};
 
-enum targetColors {
-  blue,
-  red,
-  green,
-};
-targetColors targetColor = red;
-// blue = 0, red = 1
-
-//motor pins
-const int LMPIN = 9; // 26 is pin for Left motor object
-const int RMPIN =  6; // 27 is pin for Right motor object
-const int LSPIN = 2; //14 is pin for Left servo object
-const int RSPIN = 4; //12 is pin for Right servo object 
-
-const float RESOLUTION_WIDTH = 320;
-const float RESOLUTION_HEIGHT = 240;
-
 // Pinout
 
 //msg variables
@@ -73,49 +49,40 @@ MotorMapping motors;
 
 //objects
 BerryIMU_v3 BerryIMU;
-Madgwick_Filter madgwick;
-BaroAccKF kf;
-AccelGCorrection accelGCorrection;
+
+//estimators, state machine and yaw rate loop
+FlightController controller;
 
 // Kalman_Filter_Tran_Vel_Est kal_vel;
 // OpticalEKF xekf(DIST_CONSTANT, GYRO_X_CONSTANT, GYRO_YAW_CONSTANT);
 // OpticalEKF yekf(DIST_CONSTANT, GYRO_Y_CONSTANT, 0);
 
-GyroEKF gyroEKF;
+//write buffers in OCRAM, DTCM stays for the stack and the filters
+FlightRecorder flightRecorder;
+
+//sensor calibration and filter state from the last calibrate command, see Calibration.h
+CalibrationStore calibrationStore;
+//saved once calibrationAllowed(), the EEPROM write blocks the loop
+bool saveFilterStateRequested = false;
+bool logStateThisLoop = false;
+int flightLogDecimationCount = 0;
 
-EMAFilter yawRateFilter;
 EMAFilter pitchRateFilter;
 
 EMAFilter pitchAngleFilter;
 EMAFilter rollAngleFilter;
 
-//pre process for accel before vertical kalman filter
-EMAFilter verticalAccelFilter;
-
 //baro offset computation from base station value
 EMAFilter baroOffset;
 //roll offset computation from imu
 EMAFilter rollOffset;
 
 // PIDs
-PID yawRatePID(3,0,0);  
 PID pitchRatePID(2.4,0,0);
-//adjust  these for Openmv dont change the middle zeros
-PID xPos(200,0,4);
-PID yPos(150,0,5);
-
-EMAFilter EMA_targetEstimateX;
-EMAFilter EMA_targetEstimateY;
-
-double targetEstimateX = 0; // [-1,1]
-double targetEstimateY = 0; // [-1,1]
-const double targetEstimateTau = 2; // [seconds], keep looking at last estimate (even if you don't see anything right now)
-double targetEstimateLastTime = -1; // [seconds]
 
 //WIFI objects
 BlimpClock udpClock;
 BlimpClock heartbeat;
-BlimpClock motorClock;
 BlimpClock serialHeartbeat;
 
 BlimpClock rosClock_ceilHeight;
@@ -124,6 +91,9 @@ BlimpClock rosClock_debug;
 BlimpClock rosClock_debug2;
 BlimpClock rosClock_state;
 BlimpClock rosClock_targetEstimate;
+BlimpClock cameraCommandClock;
+BlimpClock rosClock_memory;
+bool memoryReportRequested = false;
 const bool rosLog = false;
 
 //variables
@@ -131,50 +101,45 @@ double feedbackData[FEEDBACK_BUF_SIZE];
 bool autoTransition = false;
 bool motorsOff = false; //used for safegaurd
 
-double forwardInput = 0;
-double yawInput = 0;
-double upInput = 0;
-
-double lastOuterLoopTime = 0;
-
-// Actual
-double ceilHeight = 500;
-
-//IMU orentation
-float rotation = -90;
-
 //timing global variables for each update loop
 float lastSensorFastLoopTick = 0.0;
 float lastBaroLoopTick = 0.0;
 
+//whether the boot times went to ROS, see BootSequence.h
+bool bootReported = false;
+
 //base station baro
 float baseBaro = 0.0;
 
 //corrected baro
 float actualBaro = 0.0;
 
-//sensor data
-float pitch = 0;
-float yaw = 0;
-float roll = 0;
-
 String s = "";
 
-String buffer_serial2;
+CameraFrameParser cameraParser;
 
 
-std::vector<std::vector<double>> detections;
-vector<double> targetDetection;
-void processSerial(String msg);
+void processCamera();
 
 // Callbacks for topics
 void callback_motors(vector<double> values);
 void callback_auto(bool value);
 void callback_targetColor(int64_t value);
+void callback_memory(bool value);
+void publishMemory();
+void callback_calibrate(bool value);
+bool calibrationAllowed();
+void saveCalibration();
+void logCalibration(uint8_t event, const CalibrationData& c, const float trim[3][3]);
+void logCommand();
+void storeDebugRecord(const DebugRecord& record);
+void publishDebugLine(const char* text);
 
 unsigned long identify_time;
 
-void setup() {
+COLD_CODE void setup() {
+  //paint the stack before anything runs deep
+  MemoryDiagnostics::Init();
   Serial.begin(115200);
   rosHandler.Init();
 
@@ -183,28 +148,43 @@ void setup() {
 
   //motor->(pin,deadband,turn on,min,max)
   motors.Init(LSPIN, RSPIN, LMPIN, RMPIN, 5, 50, 1000, 2000, 0.3, &rosHandler);
+  motors.setServoSlewRate(SERVO_SLEW_RATE, SERVO_FLIP_MARGIN);
 
-  // Sensors
-  BerryIMU.Init();
-  madgwick.Init();
-  kf.Init();
-  accelGCorrection.Init();
-  gyroEKF.Init();
+  // Sensors, probed rather than waited for
+  bool sensorsFound = BerryIMU.Init();
+  controller.Init();
 
   // EMA Filters
-  yawRateFilter.Init(0.2);
   pitchRateFilter.Init(0.1);
   pitchAngleFilter.Init(0.2);
   rollAngleFilter.Init(0.2);
-  //pre process for accel before vertical kalman filter
-  verticalAccelFilter.Init(0.05);
   //baro offset computation from base station value
   baroOffset.Init(0.5);
   //roll offset computation from imu
   rollOffset.Init(0.5);
 
-  EMA_targetEstimateX.Init(0.3);
-  EMA_targetEstimateY.Init(0.3);
+  if (FLIGHTLOG_ENABLED) flightRecorder.Init(BLIMP_ID);
+
+  //debug messages go to the flight log as they happen, USB and ROS when the loop has time
+  debugLog.store = storeDebugRecord;
+  if (rosLog) debugLog.publish = publishDebugLine;
+  debugLog.rosLevel = DEBUG_LEVEL_INFO;
+  if (!sensorsFound) DEBUG_ERROR(MSG_SENSOR_MISSING, (unsigned int)BerryIMU.sensorsMissing);
+
+  //warm start from the stored calibration, the filters' Init() priors otherwise
+  if (calibrationStore.load()) {
+    CalibrationData& c = calibrationStore.data;
+    controller.applyCalibration(c);
+    BerryIMU.setStoredReference(c.baroReference);
+    BerryIMU.alignment.set(c.mountAlignment);
+    DEBUG_INFO(MSG_CALIBRATION_LOADED, c.gyroBias[0], c.gyroBias[1], c.gyroBias[2]);
+    logCalibration(LOG_CALIBRATION_LOADED, c, nullptr);
+  } else {
+    DEBUG_WARN(MSG_CALIBRATION_REJECTED, (unsigned int)calibrationStore.failure);
+    CalibrationData c;
+    controller.storeCalibration(c);
+    logCalibration(LOG_CALIBRATION_DEFAULTS, c, nullptr);
+  }
 
   // Subscriber Setup //
 
@@ -212,15 +192,18 @@ void setup() {
   rosHandler.SubscribeTopic_Float64MultiArray(MULTIARRAY_TOPIC, callback_motors);
   rosHandler.SubscribeTopic_Bool(AUTO_TOPIC, callback_auto);
   rosHandler.SubscribeTopic_Int64(COLOR_TOPIC, callback_targetColor);
+  rosHandler.SubscribeTopic_Bool(MEMORY_TOPIC, callback_memory);
+  rosHandler.SubscribeTopic_Bool(CALIBRATE_TOPIC, callback_calibrate);
 
   // Publisher
   rosHandler.PublishTopic_String("/identify", BLIMP_ID);
   identify_time = micros();
 
-  //UART Comm (OpenMV)
+  //UART Comm (OpenMV), a larger receive ring so frames survive a slow loop
+  static BULK_DATA uint8_t cameraRxBuffer[CAMERA_RX_BUFFER];
+  HWSERIAL.addMemoryForRead(cameraRxBuffer, sizeof(cameraRxBuffer));
   HWSERIAL.begin(115200);
-  Serial.println("Color tracking program started");
-  delay(2000);
+  DEBUG_INFO(MSG_BOOT);
 
   //initializations
   heartbeat.setFrequency(20);
@@ -230,7 +213,6 @@ void setup() {
       feedbackData[i] = 0;
   }
 
-  motorClock.setFrequency(30);
   serialHeartbeat.setFrequency(1);
 
   rosClock_ceilHeight.setFrequency(5);
@@ -239,11 +221,12 @@ void setup() {
   rosClock_debug2.setFrequency(5);
   rosClock_state.setFrequency(5);
   rosClock_targetEstimate.setFrequency(5);
-  
-  //wait 2 seconds
-  delay(2000);
+  cameraCommandClock.setFrequency(OUTERLOOP);
+  rosClock_memory.setFrequency(1);
 
-  if(rosLog) rosHandler.PublishTopic_String("log", "Teensy booted and connected to network.");
+  //no waiting here, the loop starts the filters once the IMU has samples
+  //and the camera, ESP and ROS report in when they are up
+  bootSequence.mark(BOOT_SETUP);
 }
 
 /*test_callback
@@ -258,21 +241,14 @@ void setup() {
 // }
 
 
-double tempforward;
-double tempyaw;
-double tempup;
 /*multiarray_callback
  * Description: Callback intended to convert Float64MultiArray messages to motor commands 
  */
 void callback_motors(vector<double> values)
 {
   if (values.size() == 4){
-    tempforward = values[1];
-    tempyaw = values[0];
-    tempup = values[3];
-    // forwardInput = values[1];
-    // yawInput = values[0];
-    // upInput = values[3];
+    controller.setManualInput(values[0], values[1], values[3]);
+    logCommand();
   }
 }
 
@@ -281,27 +257,35 @@ void callback_motors(vector<double> values)
  */
 void callback_auto(bool value) {
   int newState = value ? manual : autonomous;
-  if (newState == manual && autonomousState == autonomous) {
-    std::string msg = std::string("Going Manual for a Bit...");
-    if(rosLog) rosHandler.PublishTopic_String("log", msg.c_str());
+  if (newState == manual && controller.autonomousState == autonomous) {
+    DEBUG_INFO(MSG_AUTO_OFF);
   }
-  else if (newState == autonomous && autonomousState == manual) {
-    std::string msg = std::string("Activating Auto Mode");
-    if(rosLog) rosHandler.PublishTopic_String("log", msg.c_str());
+  else if (newState == autonomous && controller.autonomousState == manual) {
+    DEBUG_INFO(MSG_AUTO_ON);
   }
-  autonomousState = value ? manual : autonomous;
+  controller.autonomousState = value ? manual : autonomous;
+  logCommand();
 }
 
 void callback_targetColor(int64_t value){
+  //the tracker and the search index their per colour state with it
+  if (value < blue || value > green) {
+    DEBUG_WARN(MSG_TARGET_COLOR_INVALID, (int)value);
+    return;
+  }
   targetColors newTargetColor = static_cast<targetColors>(value);
-  if (newTargetColor == red && targetColor != red) {
-    if(rosLog) rosHandler.PublishTopic_String("log","Target Color changed to red.");
-  } else if (newTargetColor == green && targetColor != green) {
-    if(rosLog) rosHandler.PublishTopic_String("log","Target Color changed to green.");
-  } else if (newTargetColor == blue && targetColor != blue) {
-    if(rosLog) rosHandler.PublishTopic_String("log","Target Color changed to blue.");
-  }
-  targetColor = newTargetColor;
+  targetColors targetColor = controller.targetColor;
+  if (newTargetColor != targetColor) {
+    DEBUG_INFO(MSG_TARGET_COLOR, newTargetColor);
+  }
+  controller.targetColor = newTargetColor;
+  logCommand();
+}
+
+void logCommand() {
+  LogCommand logCommand = {(uint8_t)controller.autonomousState, (uint8_t)controller.targetColor,
+                           (float)controller.manualYaw, (float)controller.manualForward, (float)controller.manualUp};
+  flightRecorder.write(LOG_COMMAND, logCommand);
 }
 
 vector<float> times;
@@ -341,14 +325,13 @@ void loop() {
   */
 
   if(rosClock_targetEstimate.isReady()){
-    double currentTime2 = micros()/1000000.0;
-    double elapsedTime2 = currentTime2 - targetEstimateLastTime;
-    rosHandler.PublishTopic_String("targetEstimate","Estimate ("+String(roundDouble(EMA_targetEstimateX.last,2))+", "+String(roundDouble(EMA_targetEstimateY.last,2))+") - Last");
+    TargetTrack target = controller.target;
+    rosHandler.PublishTopic_String("targetEstimate","Track ("+String(roundDouble(target.bearing,1))+", "+String(roundDouble(target.elevation,1))+") Rate "+String(roundDouble(target.bearingRate,1))+" - "+(target.valid ? String(roundDouble(target.age,2)) : String("none"))+" - Tracks "+String(controller.tracker.confirmedTracks()));
   }
 
   if(rosClock_state.isReady()){
-    rosHandler.PublishTopic_String("state",stateNames[state]);
-    Serial.println("State: " + String(stateNames[state]));
+    rosHandler.PublishTopic_String("state",stateNames[controller.state]);
+    DEBUG_VERBOSE(MSG_STATE, controller.state);
   }
 
   unsigned long now = micros();
@@ -409,23 +392,21 @@ void loop() {
     }
   }
   */
-  // NEW IMPLEMENTATION
+  // Binary frames, see CameraLink.h
   while(Serial2.available() > 0){
-    char currentChar = Serial2.read();
-    if(currentChar == startDelimiter){
-      buffer_serial2 = "";
-    }else if(currentChar == endDelimiter){
-      String msg = buffer_serial2;
-      buffer_serial2 = "";
-
-      //Ensure the packet is of the right size
-      Serial.println("msg: " + msg);
-      processSerial(msg);
-    }else{
-      buffer_serial2 += currentChar;
+    if(cameraParser.push(Serial2.read())){
+      processCamera();
     }
   }
 
+  // Tell the camera which colour and window to search
+  if(cameraCommandClock.isReady()){
+    CameraCommand command;
+    controller.cameraRequest(command);
+    sealCameraCommand(command);
+    Serial2.write((const uint8_t*)&command, sizeof(command));
+  }
+
   //reading data from base station
 
   // Retrieve inputs from packet
@@ -433,73 +414,87 @@ void loop() {
 
 
   // ************************** IMU LOOP ************************** //
+  //nothing reaches the filters or the motors until the IMU has settled and delivers samples
+  bool imuReady = bootSequence.reached(BOOT_IMU);
+  if (!imuReady && millis() - BerryIMU.configuredMillis >= IMU_BOOT_SETTLE && BerryIMU.dataReady()) {
+    bootSequence.mark(BOOT_IMU);
+    lastSensorFastLoopTick = micros()/MICROS_TO_SEC - 1.0/FAST_SENSOR_LOOP_FREQ;
+    lastBaroLoopTick = lastSensorFastLoopTick;
+  }
+
   float dt = micros()/MICROS_TO_SEC-lastSensorFastLoopTick;
-  if (dt >= 1.0/FAST_SENSOR_LOOP_FREQ) {
+  if (imuReady && dt >= 1.0/FAST_SENSOR_LOOP_FREQ) {
     lastSensorFastLoopTick = micros()/MICROS_TO_SEC;
 
     //read sensor values and update madgwick
     BerryIMU.IMU_read();
-    BerryIMU.IMU_ROTATION(rotation);
-
-    madgwick.Madgwick_Update(BerryIMU.gyr_rateXraw,
-                            BerryIMU.gyr_rateYraw,
-                            BerryIMU.gyr_rateZraw,
-                            BerryIMU.AccXraw,
-                            BerryIMU.AccYraw,
-                            BerryIMU.AccZraw);
-
-    //get orientation from madgwick
-    pitch = madgwick.pitch_final;
-    //Serial.println("PITCH:");
-    //Serial.println (pitch);
-    roll = madgwick.roll_final;
-    yaw = madgwick.yaw_final;
-
-    //compute the acceleration in the barometers vertical reference frame
-    accelGCorrection.updateData(BerryIMU.AccXraw, BerryIMU.AccYraw, BerryIMU.AccZraw, pitch, roll);
 
-    //run the prediction step of the vertical velecity kalman filter
-    kf.predict(dt);
-    // xekf.predict(dt);
-    // yekf.predict(dt);
-    gyroEKF.predict(dt);
+    //madgwick, vertical kalman filter and gyro ekf
+    controller.updateImu(BerryIMU.gyr_rateXraw, BerryIMU.gyr_rateYraw, BerryIMU.gyr_rateZraw,
+                         BerryIMU.AccXraw, BerryIMU.AccYraw, BerryIMU.AccZraw, dt);
 
+    //record the raw sample and, every FLIGHTLOG_STATE_DECIMATION loops, the filter states
+    LogImu logImu = {BerryIMU.gyr_rateXraw, BerryIMU.gyr_rateYraw, BerryIMU.gyr_rateZraw,
+                     BerryIMU.AccXraw, BerryIMU.AccYraw, BerryIMU.AccZraw, dt};
+    flightRecorder.write(LOG_IMU, logImu);
 
-    //pre filter accel before updating vertical velocity kalman filter
-    verticalAccelFilter.filter(-accelGCorrection.agz);
+    if (++flightLogDecimationCount >= FLIGHTLOG_STATE_DECIMATION) {
+      flightLogDecimationCount = 0;
+      logStateThisLoop = true;
 
-    //update vertical velocity kalman filter acceleration
-    kf.updateAccel(verticalAccelFilter.last);
+      GyroEKF& gyroEKF = controller.gyroEKF;
+      LogAttitude logAttitude = {controller.roll, controller.pitch, controller.yaw,
+                                 gyroEKF.roll, gyroEKF.pitch, gyroEKF.yaw, gyroEKF.yawRate, gyroEKF.yawRateB};
+      flightRecorder.write(LOG_ATTITUDE, logAttitude);
 
-    //update filtered yaw rate
-    yawRateFilter.filter(BerryIMU.gyr_rateZraw);
-
-    //perform gyro update
-    gyroEKF.updateGyro(BerryIMU.gyr_rateXraw*3.14/180, BerryIMU.gyr_rateYraw*3.14/180, BerryIMU.gyr_rateZraw*3.14/180);
-    gyroEKF.updateAccel(BerryIMU.AccXraw, BerryIMU.AccYraw, BerryIMU.AccZraw);
-
-    //Serial.println(BerryIMU.AccXraw);
+      BaroAccKF& kf = controller.kf;
+      LogAltitude logAltitude = {kf.x, kf.v, kf.a, kf.b, (float)controller.verticalAccelFilter.last};
+      flightRecorder.write(LOG_ALTITUDE, logAltitude);
+    }
     
   } 
 
+  //the motors are held at zero while calibrating, give them back as soon as they are wanted
+  if (controller.calibrating() && !calibrationAllowed()) {
+    controller.cancelCalibration();
+    DEBUG_WARN(MSG_CALIBRATION_CANCELLED);
+  }
+  //a finished calibration also levels the IMU and zeroes the height at the current pressure
+  if (controller.calibrationFinished()) {
+    CalibrationData run;
+    controller.storeCalibration(run);
+    float trim[3][3];
+    BerryIMU.alignment.level(controller.restAccel, trim);
+    controller.rotateAxes(trim);
+    BerryIMU.ref_ground_press = BerryIMU.comp_press;
+    controller.zeroHeight();
+    logCalibration(LOG_CALIBRATION_RUN, run, trim);
+    saveFilterStateRequested = true;
+  }
+  if (saveFilterStateRequested && calibrationAllowed()) {
+    saveFilterStateRequested = false;
+    saveCalibration();
+  }
+
   // ************************** BARO LOOP ************************** //
   dt = micros()/MICROS_TO_SEC-lastBaroLoopTick;
-  if (dt >= 1.0/BARO_LOOP_FREQ) {
+  if (imuReady && dt >= 1.0/BARO_LOOP_FREQ) {
     lastBaroLoopTick = micros()/MICROS_TO_SEC;
 
-    //get most current imu values
-    BerryIMU.IMU_read();
-    BerryIMU.IMU_ROTATION(rotation);
-    
-    //update kalman with uncorreced barometer data
-    kf.updateBaro(BerryIMU.alt);
+    //only fresh samples reach the kalman filter, the BMP388 has one every 1/BARO_ODR_FREQ
+    if (BerryIMU.baroRead()) {
+      //update kalman with uncorreced barometer data
+      controller.updateBaro(BerryIMU.alt);
 
+      LogBaro logBaro = {BerryIMU.alt, BerryIMU.comp_press, BerryIMU.comp_temp};
+      flightRecorder.write(LOG_BARO, logBaro);
 
-    //compute the corrected height with base station baro data and offset
-    actualBaro = BerryIMU.alt - baseBaro + baroOffset.last;
+      //compute the corrected height with base station baro data and offset
+      actualBaro = BerryIMU.alt - baseBaro + baroOffset.last;
 
-    // xekf.updateBaro(CEIL_HEIGHT_FROM_START-actualBaro);
-    // yekf.updateBaro(CEIL_HEIGHT_FROM_START-actualBaro);
+      // xekf.updateBaro(CEIL_HEIGHT_FROM_START-actualBaro);
+      // yekf.updateBaro(CEIL_HEIGHT_FROM_START-actualBaro);
+    }
   }
 
   // ******************* PACKET RELATED LOGIC ******************* //
@@ -550,165 +545,20 @@ void loop() {
   // Serial.println(targetColor);
 
   // ******************* STATE MACHINE ******************* //
-  // Manual
-  if (autonomousState == manual){
-
-    if (motorClock.isReady()) {
-      //State Machine
-      //MANUAL
-      //Default
-
-      //Serial.println(udp.packetMoveGetInput()[2].c_str());
-      
-      //stod() was toDouble()
-      //forwardInput = atof(inputs[4].c_str());
-      //yawInput = atof(inputs[1].c_str());
-      //upInput = atof(inputs[2].c_str());
-
-      //safegaurd: if motor reads any command that is greater than 1, shut the motor off!!!
-
-      forwardInput = max(-1.00, min(1.00,tempforward));
-      upInput = max(-1.00, min(1.00,tempup));
-      yawInput = max(-1.00, min(1.00,tempyaw));
-
-      // if (abs(forwardInput) >1.0 || abs(yawInput)>1.0 || abs(upInput)>1.0){
-      //   motorsOff = true;
-      //   Serial.println("Invalid motor input!!!!!");
-      // }
-
-      // Serial.println("\nMotor inputs: ");
-      // Serial.print(forwardInput);
-      // Serial.print(",");
-      // Serial.print(upInput);
-      // Serial.print(",");
-      // Serial.print(yawInput);
-      // Serial.print("\n");    
-
-      //map controller input to yaw rate
-      //Serial.println(yawInput);
-      upInput = 500*upInput;
-      forwardInput = 500*forwardInput;
-      yawInput = -yawInput*200;    //120 degrees per second
-
-
-
-      //Serial.println(yawInput);
-    }
-
-  // Autonomous
-  } else if (autonomousState == autonomous) {
-
-    //AUTONOMOUS
-    //Serial.println("auto");
-    double outerLoopTime = millis() - lastOuterLoopTime;
+  //manual/autonomous decisions and the yaw rate loop, see FlightController.cpp
+  controller.update();
 
-    if (outerLoopTime > (1.0/OUTERLOOP)*1000) {
-      lastOuterLoopTime = millis();
+  double forwardInput = controller.forwardInput;
+  double upInput = controller.upInput;
+  double yawInput = controller.yawInput;
+  double yawPIDInput = controller.yawPIDInput;
+  autonomousStates autonomousState = controller.autonomousState;
 
-      //ultrasonic
-      // Serial.print("Ceiling Height: ");
-      Serial.println(ceilHeight);
-    
-
-      //perform decisions
-      state = searching;
-      switch (state) {
-
-        //Search
-        case searching: {
-          if (true) {
-            yawInput = -20;   //turning rate while searching
-            // yawInput = 0;
-
-            // Serial.print(ceilHeight);
-            //check if the height of the blimp is within this range (ft), adjust accordingly to fall in the zone 
-            if (ceilHeight > 400){
-              // Ultrasonic not working
-              upInput = 0;
-              forwardInput = 0;
-            } else if (ceilHeight > 200) {
-              //Serial.println("up");
-              upInput = 100*cos(pitch*3.1415/180.0); //or just 100 (without pitch control)
-              forwardInput = 100*sin(pitch*3.1415/180.0);
-              
-            } else if (ceilHeight < 60) {
-              //Serial.println("down");
-              upInput = -100*cos(pitch*3.1415/180.0);
-              forwardInput = -100*sin(pitch*3.1415/180.0);
-            } else {
-              upInput = 0;
-              forwardInput = 0;
-            }
-            
-            // Testing on Ground
-            upInput = 0;
-            
-            //we see something o_O
-            if(targetDetection.size() > 0){
-              state = approach;
-            }
-            /*
-            if (detections.size() == 3 && detections[targetColor].size() == 2 && detections[targetColor][0] < 500) {
-              state = approach;
-            }
-            */
-            
-          }
-        } break;
-
-        // Approach
-        case approach: {
-          double currentTime1 = micros()/1000000.0;
-          double elapsedTime1 = currentTime1 - targetEstimateLastTime;
-
-          if(elapsedTime1 < targetEstimateTau){
-            
-            yawInput = xPos.calculate(0, EMA_targetEstimateX.last, min(elapsedTime1, 0.5));
-            upInput = yPos.calculate(0, EMA_targetEstimateY.last, min(elapsedTime1, 0.5));
-            forwardInput = 100;
-
-            //Enforce saturation
-            double maxSaturation = 50;
-            yawInput = min(max(yawInput, -maxSaturation), maxSaturation);
-            //upInput = min(max(upInput, -maxSaturation), maxSaturation);
-          }else{
-            state = searching;
-          }
-
-          // OLD if statement
-          /*
-          if (detections.size() == 3 && detections[targetColor].size() == 2 && detections[targetColor][0] < 500) {
-          } else {
-            state = searching;
-          }*/
-
-        }  break;
-
-        // Default Case
-        default: {
-          Serial.println("Invalid State");
-        } break;
-      }
-    }
-  }
-  
   if(rosClock_debug.isReady()){
-    rosHandler.PublishTopic_String("debug","ceilHeight (" + String(ceilHeight) + ") - yaw("+String(yawInput)+") - Up("+upInput+") - Forward("+forwardInput+")");
+    rosHandler.PublishTopic_String("debug","ceilHeight (" + String(controller.ceilHeight) + ") - yaw("+String(yawInput)+") - Up("+upInput+") - Forward("+forwardInput+")"
+                                   + " - AltErr(" + String(controller.altitudeError) + ")");
   }
 
-  // ******************* MOTOR INPUTS ******************* //
-  double yawPIDInput = 0.0;
-  double deadband = 2.0; //To do
-
-  //Serial.println(state);
-  
-  yawPIDInput = yawRatePID.calculate(yawInput, yawRateFilter.last, 100);   
-  if (abs(yawInput-yawRateFilter.last) < deadband) {
-      yawPIDInput = 0;
-  } else {
-      yawPIDInput = tanh(yawPIDInput)*abs(yawPIDInput);
-  }
-            
   if(rosClock_debug2.isReady()){
     rosHandler.PublishTopic_String("debug2","Yaw Rate: Pre-PID("+String(yawInput)+") - Post-Filter("+yawPIDInput+")");
   }
@@ -721,7 +571,8 @@ void loop() {
   //turing the motors off for debugging for second case
   if (autonomousState == lost){
     motors.update(0,0,0,0);
-  }else if (MOTORS_OFF == false && motorsOff == false) {
+    controller.setActuatorAuthority(0, 0);
+  }else if (MOTORS_OFF == false && motorsOff == false && imuReady && !controller.calibrating()) {
     // Serial.println("\nafter: ");
     // Serial.println(yawInput);
     // Serial.print(",");
@@ -730,90 +581,84 @@ void loop() {
     // Serial.println(forwardInput);
 
     motors.update(0, forwardInput, upInput, yawPIDInput);
+    controller.setActuatorAuthority(motors.yawAuthority, motors.upAuthority);
   } else {
     motors.update(0,0,0,0);
+    controller.setActuatorAuthority(0, 0);
   }
   motorsOff = false;
-
-  // End Main Loop
-}
-
-// process Serial message from the camera
-void processSerial(String msg) {
-  Serial.println("pS");
-  String cameraMessageTopicName = "cameraMessage";
-
-  // PARSE MESSAGE
-  // Format:
-  // #,#,#,#,#,#,#,
-  // blue_x, blue_y, red_x, red_y, green_x, green_y, barometer,
-
-  double parsedDoubles[7];
-  int parsedDoublesIndex = 0;
-
-  String tempBuffer = "";
-  for(int i=0; i<msg.length(); i++){
-    char currentChar = msg.charAt(i);
-    if(currentChar == ',' || currentChar == ';'){
-      String currentBuffer = tempBuffer;
-      tempBuffer = "";
-
-      // Parse currentBuffer
-      if(currentBuffer.length() == 0) continue;
-
-      char firstChar = currentBuffer.charAt(0);
-      if(firstChar == '-' || firstChar == '.' || ('0' <= firstChar && firstChar <= '9')){
-        double currentDouble = stod(currentBuffer.c_str());
-        parsedDoubles[parsedDoublesIndex] = currentDouble;
-        parsedDoublesIndex++;
-      }
-    }else{
-      tempBuffer += currentChar;
-    }
+  if (imuReady) bootSequence.mark(BOOT_CONTROL);
+
+  //boot phase times once there is someone to tell
+  if (!bootReported && bootSequence.reached(BOOT_ROS)) {
+    bootReported = true;
+    char bootTimes[96];
+    bootSequence.format(bootTimes, sizeof(bootTimes));
+    rosHandler.PublishTopic_String("boot", bootTimes);
   }
 
-  if(parsedDoublesIndex != 7){
-    // Could not parse all 7 numbers
-    Serial.println("SERIAL2 PARSE ERROR");
-    return;
+  if (logStateThisLoop) {
+    logStateThisLoop = false;
+
+    LogControl logControl = {(uint8_t)controller.state, (uint8_t)autonomousState, (float)forwardInput, (float)upInput,
+                             (float)yawInput, (float)controller.yawRateEstimate, (float)yawPIDInput,
+                             controller.target.bearing, controller.target.elevation};
+    flightRecorder.write(LOG_CONTROL, logControl);
+
+    LogAltitudeHold logAltitudeHold = {(uint8_t)controller.altitudeHold, (float)controller.ceilingEstimate,
+                                       (float)controller.altitudeSetpoint, (float)controller.altitudeError,
+                                       (float)controller.altitudePID.output};
+    flightRecorder.write(LOG_ALTITUDE_HOLD, logAltitudeHold);
+
+    InterceptGuidance& guidance = controller.guidance;
+    LogGuidance logGuidance = {(uint8_t)(controller.state == approach), (uint8_t)guidance.terminal,
+                               controller.target.bearingRate, controller.target.elevationRate,
+                               (float)guidance.leadAngle, (float)guidance.pathAngle, (float)guidance.climbRate,
+                               (float)guidance.forward, (float)guidance.closingSpeed,
+                               (float)controller.targetRange, (float)sqrt(controller.rangeEstimator.rangeVariance),
+                               (float)controller.rangeEstimator.rangeRate};
+    flightRecorder.write(LOG_GUIDANCE, logGuidance);
+
+    LogMotor logMotor = {(float)motors.outRServo, (float)motors.outLServo, (float)motors.outRMotor, (float)motors.outLMotor};
+    flightRecorder.write(LOG_MOTOR, logMotor);
   }
 
-  // Populate targetDetection
-  targetDetection.clear();
+  //write out at most one chunk of buffered log data
+  flightRecorder.Update();
+  //and the debug messages the USB buffer has room for
+  debugLog.Update();
 
-  double x_raw;
-  double y_raw;
-
-  if(targetColor == targetColors::blue){
-    x_raw = parsedDoubles[0];
-    y_raw = parsedDoubles[1];
-  }else if(targetColor == targetColors::red){
-    x_raw = parsedDoubles[2];
-    y_raw = parsedDoubles[3];
-  }else if(targetColor == targetColors::green){
-    x_raw = parsedDoubles[4];
-    y_raw = parsedDoubles[5];
+  //heap and stack use, the stack scan is spread over many loops
+  MemoryDiagnostics::Update();
+  if (rosClock_memory.isReady() || memoryReportRequested) {
+    memoryReportRequested = false;
+    publishMemory();
   }
 
-  if(x_raw == 1000 && y_raw == 1000){
-    // OpenMV couldn't find a blob
+  // End Main Loop
+}
 
-  }else{
-    // OpenMV found a blob
+// process a frame from the camera, in cameraParser.frame
+void processCamera() {
+  bootSequence.mark(BOOT_CAMERA);
+  String cameraMessageTopicName = "cameraMessage";
 
-    // DEFAULT OPENMV BEHAVIOR
-    // - finds blobs in frame, top-left = (0,0), bottom-right = (320,240)
-    
-    // Scale back to normal frame
-    double x = x_raw*2/RESOLUTION_WIDTH - 1;
-    double y = (-2*y_raw + RESOLUTION_HEIGHT)/RESOLUTION_WIDTH;
-    
-    targetDetection.push_back(x);
-    targetDetection.push_back(y);
-  }
+  // blue_x, blue_y, red_x, red_y, green_x, green_y, rangefinder
+  double parsedDoubles[7];
+  cameraParser.toParsed(parsedDoubles);
+  double blobWidths[3];
+  cameraParser.toWidths(blobWidths);
 
-  // Populate ceilHeight
-  ceilHeight = parsedDoubles[6];
+  //target selection, target estimate, range and ceilHeight
+  controller.updateCamera(parsedDoubles, blobWidths);
+  vector<double>& targetDetection = controller.targetDetection;
+
+  LogCamera logCamera;
+  for (int i = 0; i < 6; i++) logCamera.blobs[i] = parsedDoubles[i];
+  logCamera.ceilHeight = parsedDoubles[6];
+  logCamera.targetColor = controller.targetColor;
+  for (int i = 0; i < 3; i++) logCamera.widths[i] = blobWidths[i];
+  flightRecorder.write(LOG_CAMERA, logCamera);
 
   // std::vector<double> green;
   // std::vector<double> blue;
@@ -933,35 +778,8 @@ void processSerial(String msg) {
   //   object.clear();
   // }
 
-  if(targetDetection.size() > 0){
-    // Detected a target
-    double currentTime = micros()/1000000.0;
-    if(targetEstimateLastTime < 0){
-      // First information, initialize!
-      targetEstimateLastTime = currentTime;
-      // targetEstimateX = targetDetection[0];
-      // targetEstimateY = targetDetection[1];
-      EMA_targetEstimateX.setInitial(targetDetection[0]);
-      EMA_targetEstimateY.setInitial(targetDetection[1]);
-    }else{
-      // Not first information, update
-      double elapsedTime = currentTime - targetEstimateLastTime;
-      targetEstimateLastTime = currentTime;
-
-      EMA_targetEstimateX.filter(targetDetection[0]);
-      EMA_targetEstimateY.filter(targetDetection[1]);
-
-      // double updateStep = elapsedTime/targetEstimateTau; // Can never be bigger than 1
-      // updateStep = min(updateStep, 1.0);
-      // updateStep = max(updateStep, 0.01);
-      // targetEstimateX = targetEstimateX + updateStep * (targetDetection[0] - targetEstimateX);
-      // targetEstimateY = targetEstimateY + updateStep * (targetDetection[1] - targetEstimateY);
-    }
-  }
-
-
   // ceilHeight = (double)splitData[3].toFloat();
-  if(rosClock_ceilHeight.isReady()) rosHandler.PublishTopic_Float64("ceilHeight",ceilHeight);
+  if(rosClock_ceilHeight.isReady()) rosHandler.PublishTopic_Float64("ceilHeight",controller.ceilHeight);
   // Serial.println(ceilHeight);
 
   // detections.clear();
@@ -988,7 +806,83 @@ void processSerial(String msg) {
   }else{
     cameraMessage = "Target Detected (" + String(roundDouble(targetDetection[0],doubleDecimals)) + ", " + String(roundDouble(targetDetection[1],doubleDecimals)) + ")";
   }
+  cameraMessage = cameraMessage + " - " + String(cameraParser.frame.fps) + " fps mode " + String(cameraParser.frame.mode) + " - Frames " + String(cameraParser.frames) + " missed " + String(cameraParser.missedFrames) + " crc " + String(cameraParser.crcErrors);
   
   if(rosClock_cameraMessage.isReady()) rosHandler.PublishTopic_String(cameraMessageTopicName, cameraMessage);
 }
 
+void storeDebugRecord(const DebugRecord& record) {
+  LogDebug logDebug = {record.id, record.level, record.argc,
+                       {record.args[0], record.args[1], record.args[2]}};
+  flightRecorder.write(LOG_DEBUG, logDebug);
+}
+
+void publishDebugLine(const char* text) {
+  rosHandler.PublishTopic_String("log", text);
+}
+
+void callback_memory(bool value) {
+  if (value) memoryReportRequested = true;
+}
+
+//both start a calibration and save the filter state only on the ground: manual, sticks centred
+void callback_calibrate(bool value) {
+  if (!calibrationAllowed()) {
+    DEBUG_WARN(MSG_CALIBRATION_REFUSED, (int)controller.autonomousState);
+    return;
+  }
+  if (value) controller.startCalibration(CALIBRATION_SECONDS);
+  else saveFilterStateRequested = true;
+}
+
+//nothing commands the motors, so holding them at zero or blocking the loop costs no thrust
+bool calibrationAllowed() {
+  return controller.autonomousState == manual && controller.manualForward == 0 &&
+         controller.manualUp == 0 && controller.manualYaw == 0;
+}
+
+//calibration in use, the current filter state and ground pressure to EEPROM
+void saveCalibration() {
+  CalibrationData& c = calibrationStore.data;
+  controller.storeCalibration(c);
+  c.baroReference = BerryIMU.ref_ground_press;
+  BerryIMU.alignment.get(c.mountAlignment);
+  if (calibrationStore.save()) {
+    DEBUG_INFO(MSG_CALIBRATION_SAVED, c.gyroBias[0], c.gyroBias[1], c.gyroBias[2]);
+    logCalibration(LOG_CALIBRATION_SAVED, c, nullptr);
+  } else {
+    DEBUG_ERROR(MSG_CALIBRATION_SAVE_FAILED);
+  }
+}
+
+//calibration as handed to the filters, trim the rotation applied after it (nullptr: none)
+void logCalibration(uint8_t event, const CalibrationData& c, const float trim[3][3]) {
+  LogCalibration l;
+  l.event = event;
+  memcpy(l.gyroBias, c.gyroBias, sizeof(l.gyroBias));
+  memcpy(l.accelOffset, c.accelOffset, sizeof(l.accelOffset));
+  memcpy(l.accelScale, c.accelScale, sizeof(l.accelScale));
+  memcpy(l.gyroEKFBias, c.gyroEKFBias, sizeof(l.gyroEKFBias));
+  memcpy(l.gyroEKFVariance, c.gyroEKFVariance, sizeof(l.gyroEKFVariance));
+  l.kfBias = c.kfBias;
+  memcpy(l.kfVariance, c.kfVariance, sizeof(l.kfVariance));
+  const float identity[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  memcpy(l.trim, trim != nullptr ? trim : identity, sizeof(l.trim));
+  float alignment[3];
+  BerryIMU.alignment.get(alignment);
+  memcpy(l.mountAlignment, alignment, sizeof(l.mountAlignment));
+  l.baroReference = BerryIMU.ref_ground_press;
+  flightRecorder.write(LOG_CALIBRATION, l);
+}
+
+void publishMemory() {
+  MemoryStats m = MemoryDiagnostics::snapshot();
+  LogMemory logMemory = {m.heapUsed, m.heapPeak, m.heapFree, m.largestFree, m.allocations,
+                         m.allocationRate, m.stackUsed, m.stackSize};
+  flightRecorder.write(LOG_MEMORY, logMemory);
+
+  rosHandler.PublishTopic_String("memory", "Heap " + String(m.heapUsed) + " peak " + String(m.heapPeak) +
+                                 " free " + String(m.heapFree) + " largest " + String(m.largestFree) +
+                                 " - Allocs " + String(m.allocations) + " (" + String(roundDouble(m.allocationRate, 1)) + "/s)" +
+                                 " - Stack " + String(m.stackUsed) + "/" + String(m.stackSize));
+}
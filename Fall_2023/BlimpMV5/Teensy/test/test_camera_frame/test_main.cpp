@@ -0,0 +1,60 @@
+/*
+ test_camera_frame - CameraFrameParser keeps good frames and drops corrupted ones
+*/
+
+#include <unity.h>
+#include "CameraLink.h"
+
+static CameraFrame frame;
+static CameraFrameParser* parser;
+
+void setUp() {
+  frame = {};
+  frame.sync[0] = CAMERA_SYNC1;
+  frame.sync[1] = CAMERA_SYNC2;
+  frame.time = 123456;
+  frame.blobs[1] = {161, 97, 850, 34, 31};
+  frame.range = 1275;
+  parser = new CameraFrameParser();
+}
+
+void tearDown() {
+  delete parser;
+}
+
+static void push(uint16_t number, bool corrupt) {
+  uint8_t* bytes = (uint8_t*)&frame;
+  frame.frame = number;
+  frame.crc = crc16(bytes + 2, sizeof(CameraFrame) - 4);
+  if (corrupt) frame.blobs[1].cx ^= 4;
+  for (uint32_t i = 0; i < sizeof(CameraFrame); i++) parser->push(bytes[i]);
+  if (corrupt) frame.blobs[1].cx ^= 4;
+}
+
+static void test_good_frame_parsed() {
+  push(0, false);
+  double parsed[7];
+  parser->toParsed(parsed);
+  TEST_ASSERT_EQUAL_UINT32(1, parser->frames);
+  TEST_ASSERT_EQUAL_UINT32(0, parser->crcErrors);
+  TEST_ASSERT_EQUAL_DOUBLE(1000, parsed[0]);
+  TEST_ASSERT_EQUAL_DOUBLE(161, parsed[2]);
+  TEST_ASSERT_EQUAL_DOUBLE(127.5, parsed[6]);
+}
+
+// a good frame, one with a flipped bit and a good one again: two frames, one crc error
+static void test_corrupted_frame_rejected() {
+  push(0, false);
+  push(1, true);
+  push(2, false);
+  TEST_ASSERT_EQUAL_UINT32(2, parser->frames);
+  TEST_ASSERT_EQUAL_UINT32(1, parser->crcErrors);
+  TEST_ASSERT_EQUAL_UINT32(1, parser->missedFrames);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_good_frame_parsed);
+  RUN_TEST(test_corrupted_frame_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,40 @@
+/*
+ test_reference - the kernels that replaced older code, against that code (bench/BenchReference.h)
+*/
+
+#include <unity.h>
+#include "BenchReference.h"
+
+#define MIX_ANGLE_TOLERANCE     0.02    // [deg], the reference used 3.1415 for pi
+#define MIX_MAG_TOLERANCE       0.01    // [us]
+#define MOUNTING_TOLERANCE      1e-6    // relative, the reference's cos(-90 deg) is not quite 0
+#define BARO_ALTITUDE_TOLERANCE 0.005   // [m]
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+static void test_mix_matches_reference() {
+  double maxAngleError, maxMagError;
+  mixReferenceError(maxAngleError, maxMagError);
+  TEST_ASSERT_DOUBLE_WITHIN(MIX_ANGLE_TOLERANCE, 0, maxAngleError);
+  TEST_ASSERT_DOUBLE_WITHIN(MIX_MAG_TOLERANCE, 0, maxMagError);
+}
+
+static void test_mounting_matches_reference() {
+  TEST_ASSERT_DOUBLE_WITHIN(MOUNTING_TOLERANCE, 0, mountingReferenceError());
+}
+
+static void test_baro_altitude_matches_formula() {
+  TEST_ASSERT_DOUBLE_WITHIN(BARO_ALTITUDE_TOLERANCE, 0, baroAltitudeReferenceError());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_mix_matches_reference);
+  RUN_TEST(test_mounting_matches_reference);
+  RUN_TEST(test_baro_altitude_matches_formula);
+  return UNITY_END();
+}
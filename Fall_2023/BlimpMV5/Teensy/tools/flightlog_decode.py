@@ -0,0 +1,163 @@
+"""
+flightlog_decode.py - converts a FLTnnn.BIN flight log (see include/FlightLogFormat.h) to CSV
+
+Usage: python3 flightlog_decode.py FLT000.BIN [--out-dir dir]
+
+Writes one CSV per record type (imu.csv, baro.csv, ...) with the record time in
+seconds since the log was opened as the first column. Debug messages are turned
+back into text with the format strings in include/DebugMessages.h. Damaged regions are skipped
+by searching for the next sync byte, and a short summary is printed at the end.
+"""
+
+import argparse
+import csv
+import os
+import re
+import struct
+import sys
+
+FLIGHTLOG_VERSION = 9
+RECORD_SYNC = 0xA5
+
+FILE_HEADER = struct.Struct("<4sHHI16s")
+RECORD_HEADER = struct.Struct("<BBBI")
+
+# type id -> (name, payload layout, column names), mirrors FlightLogFormat.h
+RECORD_TYPES = {
+    1: ("imu", "<7f", ["gx", "gy", "gz", "ax", "ay", "az", "dt"]),
+    2: ("baro", "<3f", ["alt", "pressure", "temperature"]),
+    3: ("camera", "<7fB3f", ["blue_x", "blue_y", "red_x", "red_y", "green_x", "green_y",
+                             "ceilHeight", "targetColor", "blue_w", "red_w", "green_w"]),
+    4: ("attitude", "<8f", ["roll", "pitch", "yaw", "ekfRoll", "ekfPitch", "ekfYaw",
+                            "ekfYawRate", "ekfYawRateBias"]),
+    5: ("altitude", "<5f", ["x", "v", "a", "b", "verticalAccel"]),
+    6: ("control", "<BB7f", ["state", "autonomousState", "forwardInput", "upInput", "yawInput",
+                             "yawRate", "yawPIDInput", "targetBearing", "targetElevation"]),
+    7: ("motor", "<4f", ["servoR", "servoL", "motorR", "motorL"]),
+    8: ("command", "<BB3f", ["autonomousState", "targetColor", "yaw", "forward", "up"]),
+    9: ("altitude_hold", "<B4f", ["active", "ceilingEstimate", "setpoint", "error", "upCommand"]),
+    10: ("guidance", "<BB10f", ["active", "terminal", "bearingRate", "elevationRate", "leadAngle",
+                                "pathAngle", "climbRate", "forward", "closingSpeed", "range",
+                                "rangeSigma", "rangeRate"]),
+    11: ("debug", "<HBB3I", ["id", "level", "argc", "arg0", "arg1", "arg2"]),
+    12: ("memory", "<5If2I", ["heapUsed", "heapPeak", "heapFree", "largestFree", "allocations",
+                              "allocationRate", "stackUsed", "stackSize"]),
+    13: ("calibration", "<B39f", ["event"] + [f"gyroBias{a}" for a in "xyz"] + [f"accelOffset{a}" for a in "xyz"]
+         + [f"accelScale{a}" for a in "xyz"] + [f"gyroEKFBias{i}" for i in range(3)]
+         + [f"gyroEKFVariance{i}" for i in range(9)] + ["kfBias"] + [f"kfVariance{i}" for i in range(4)]
+         + [f"trim{r}{c}" for r in range(3) for c in range(3)] + ["mountRoll", "mountPitch", "mountYaw"]
+         + ["baroReference"]),
+}
+
+DEBUG_LEVELS = ["error", "warn", "info", "verbose"]
+DEBUG_MESSAGES_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "DebugMessages.h")
+
+
+def load_debug_messages(path=DEBUG_MESSAGES_H):
+    """Format strings in DebugMessages.h order, the index is the message id"""
+    try:
+        with open(path) as f:
+            source = f.read()
+    except OSError:
+        print(f"warning: {path} not found, debug messages stay numeric", file=sys.stderr)
+        return []
+    return [bytes(fmt, "ascii").decode("unicode_escape")
+            for _, fmt in re.findall(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', source)]
+
+
+def format_debug(messages, message_id, argc, words):
+    """printf the way DebugLog::format does, the argument type from each conversion letter"""
+    if message_id >= len(messages):
+        return f"unknown message {message_id}"
+    args = []
+    specs = re.findall(r"%[^%diucxXfgeE]*([diucxXfgeE])", messages[message_id].replace("%%", ""))
+    for i, letter in enumerate(specs):
+        word = words[i] if i < argc else 0
+        if letter in "dic":
+            args.append(word - (1 << 32) if word & 0x80000000 else word)
+        elif letter in "uxX":
+            args.append(word)
+        else:
+            args.append(struct.unpack("<f", struct.pack("<I", word))[0])
+    return messages[message_id] % tuple(args)
+
+
+def decode(path, out_dir):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if len(data) < FILE_HEADER.size:
+        sys.exit("file too short for a flight log header")
+    magic, version, header_size, start_micros, blimp_id = FILE_HEADER.unpack_from(data, 0)
+    if magic != b"BLOG":
+        sys.exit("not a flight log (bad magic)")
+    if version != FLIGHTLOG_VERSION:
+        # the record layouts change between versions, an older log would be misread
+        sys.exit(f"log version {version}, this decoder reads version {FLIGHTLOG_VERSION} only; "
+                 "use the tools from the revision that recorded it")
+
+    os.makedirs(out_dir, exist_ok=True)
+    writers = {}
+    files = []
+    counts = {}
+    skipped_bytes = 0
+    last_time = {}
+    gaps = {}
+    messages = load_debug_messages()
+
+    offset = header_size
+    while offset + RECORD_HEADER.size <= len(data):
+        sync, rtype, length, time_micros = RECORD_HEADER.unpack_from(data, offset)
+        end = offset + RECORD_HEADER.size + length
+        layout = RECORD_TYPES.get(rtype)
+        if sync != RECORD_SYNC or layout is None or end > len(data) \
+                or struct.calcsize(layout[1]) != length:
+            # Damaged or truncated, resync on the next candidate
+            offset += 1
+            skipped_bytes += 1
+            continue
+
+        name, fmt, columns = layout
+        values = struct.unpack_from(fmt, data, offset + RECORD_HEADER.size)
+        if name == "debug":
+            message_id, level, argc = values[:3]
+            level_name = DEBUG_LEVELS[level] if level < len(DEBUG_LEVELS) else str(level)
+            values = (message_id, level_name, format_debug(messages, message_id, argc, values[3:]))
+            columns = ["id", "level", "text"]
+        if name not in writers:
+            f = open(os.path.join(out_dir, name + ".csv"), "w", newline="")
+            files.append(f)
+            writers[name] = csv.writer(f)
+            writers[name].writerow(["time"] + columns)
+        t = ((time_micros - start_micros) & 0xFFFFFFFF) / 1e6
+        writers[name].writerow([f"{t:.6f}"] + [f"{v:.6g}" if isinstance(v, float) else v for v in values])
+
+        counts[name] = counts.get(name, 0) + 1
+        if name in last_time:
+            gaps[name] = max(gaps.get(name, 0.0), t - last_time[name])
+        last_time[name] = t
+        offset = end
+
+    for f in files:
+        f.close()
+
+    duration = max(last_time.values()) if last_time else 0.0
+    blimp = blimp_id.split(b"\0", 1)[0].decode(errors="replace")
+    print(f"{path}: blimp {blimp}, {duration:.1f} s")
+    for name, count in counts.items():
+        rate = count / duration if duration > 0 else 0.0
+        print(f"  {name:10s} {count:8d} records  {rate:7.1f} Hz  max gap {gaps.get(name, 0.0) * 1000:7.1f} ms")
+    if skipped_bytes:
+        print(f"  skipped {skipped_bytes} damaged bytes")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log")
+    parser.add_argument("--out-dir", default=None, help="defaults to the log name without extension")
+    args = parser.parse_args()
+    decode(args.log, args.out_dir or os.path.splitext(args.log)[0])
+
+
+if __name__ == "__main__":
+    main()
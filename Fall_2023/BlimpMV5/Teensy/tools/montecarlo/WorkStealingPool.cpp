@@ -0,0 +1,54 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(unsigned workers) : stealCount(0) {
+  if (workers == 0) workers = std::thread::hardware_concurrency();
+  this->workerCount = std::max(workers, 1u);
+  for (unsigned w = 0; w < workerCount; w++) queues.emplace_back(new Queue());
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t)>& task) {
+  stealCount = 0;
+
+  // contiguous blocks keep neighbouring tasks on one worker until stolen
+  for (unsigned w = 0; w < workerCount; w++) {
+    size_t begin = count * w / workerCount;
+    size_t end = count * (w + 1) / workerCount;
+    for (size_t i = begin; i < end; i++) queues[w]->tasks.push_back(i);
+  }
+
+  std::vector<std::thread> threads;
+  for (unsigned w = 1; w < workerCount; w++) threads.emplace_back(&WorkStealingPool::work, this, w, std::cref(task));
+  work(0, task);
+  for (std::thread& t : threads) t.join();
+}
+
+void WorkStealingPool::work(unsigned self, const std::function<void(size_t)>& task) {
+  size_t index;
+  // No task adds new ones, so a worker that finds every deque empty is done
+  while (popOwn(self, index) || steal(self, index)) task(index);
+}
+
+bool WorkStealingPool::popOwn(unsigned self, size_t& index) {
+  Queue& q = *queues[self];
+  std::lock_guard<std::mutex> guard(q.lock);
+  if (q.tasks.empty()) return false;
+  index = q.tasks.front();
+  q.tasks.pop_front();
+  return true;
+}
+
+bool WorkStealingPool::steal(unsigned self, size_t& index) {
+  for (unsigned offset = 1; offset < workerCount; offset++) {
+    Queue& victim = *queues[(self + offset) % workerCount];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (victim.tasks.empty()) continue;
+    index = victim.tasks.back();
+    victim.tasks.pop_back();
+    stealCount++;
+    return true;
+  }
+  return false;
+}
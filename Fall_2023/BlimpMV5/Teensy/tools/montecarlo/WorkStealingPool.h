@@ -0,0 +1,47 @@
+/*
+ WorkStealingPool.h - runs a batch of independent tasks on all cores
+
+ Task indices are dealt out in contiguous blocks, one deque per worker. A
+ worker takes from the front of its own deque and, once that is empty, steals
+ from the back of the others, so long and short tasks even out without a
+ shared queue every task has to go through.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+class WorkStealingPool {
+  public:
+    // 0 workers means one per hardware thread
+    explicit WorkStealingPool(unsigned workers = 0);
+
+    // Calls task(i) for every i in [0, count) and returns when all are done.
+    // task is called concurrently from different threads.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    unsigned workers() const { return workerCount; }
+
+    // tasks taken from another worker's deque during the last run()
+    size_t steals() const { return stealCount; }
+
+  private:
+    struct Queue {
+      std::mutex lock;
+      std::deque<size_t> tasks;
+    };
+
+    void work(unsigned self, const std::function<void(size_t)>& task);
+    bool popOwn(unsigned self, size_t& index);
+    bool steal(unsigned self, size_t& index);
+
+    unsigned workerCount;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> stealCount;
+};
@@ -0,0 +1,277 @@
+/*
+ montecarlo_main.cpp - thousands of randomised SIL flights of one scenario
+
+ pio run -e montecarlo_native
+ .pio/build/montecarlo_native/program tools/sim/scenarios/moving_target.txt
+     [--runs N] [--jobs N] [--seed N] [--out dir]
+     [--vary name=lo:hi] ... [--set name=value] ...
+
+ Run i flies with sensor/gust seed (--seed + i) and draws every --vary value
+ uniformly from its range, so a batch is reproducible for any --jobs. --vary
+ and --set take scenario names (see tools/sim/SimConfig.h, vector components
+ as e.g. target.velocity.y) and FlightController parameters. Writes
+ dir/runs.csv (draws and metrics of every run) and dir/summary.txt, which is
+ also printed.
+*/
+
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SilRunner.h"
+#include "WorkStealingPool.h"
+
+struct Variation {
+  std::string name;
+  double lo, hi;
+};
+
+struct Run {
+  std::vector<double> draws;
+  SimResult result;
+  bool passed = false;
+};
+
+static void usage(const char* program) {
+  fprintf(stderr, "usage: %s SCENARIO [--runs N] [--jobs N] [--seed N] [--out dir] "
+                  "[--vary name=lo:hi]... [--set name=value]...\n", program);
+}
+
+static std::string formatValue(double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.17g", value);
+  return text;
+}
+
+// Linear interpolation between order statistics, values must be sorted
+static double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return NAN;
+  double rank = p * (sorted.size() - 1);
+  size_t below = (size_t)rank;
+  size_t above = std::min(below + 1, sorted.size() - 1);
+  return sorted[below] + (sorted[above] - sorted[below]) * (rank - below);
+}
+
+// Wilson score interval for a success rate, 95 %
+static void wilson(size_t successes, size_t n, double& lo, double& hi) {
+  if (n == 0) {
+    lo = hi = NAN;
+    return;
+  }
+  const double z = 1.96;
+  double p = (double)successes / n;
+  double centre = (p + z * z / (2 * n)) / (1 + z * z / n);
+  double half = z * sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / (1 + z * z / n);
+  lo = centre - half;
+  hi = centre + half;
+}
+
+static void printStat(FILE* out, const char* name, std::vector<double> values, const char* unit) {
+  if (values.empty()) {
+    fprintf(out, "%-20s n/a\n", name);
+    return;
+  }
+  std::sort(values.begin(), values.end());
+  double mean = 0;
+  for (double v : values) mean += v;
+  mean /= values.size();
+  fprintf(out, "%-20s mean %8.3f  p10 %8.3f  p50 %8.3f  p90 %8.3f %s\n", name, mean,
+          percentile(values, 0.1), percentile(values, 0.5), percentile(values, 0.9), unit);
+}
+
+static void printRate(FILE* out, const char* name, size_t successes, size_t n) {
+  double lo, hi;
+  wilson(successes, n, lo, hi);
+  fprintf(out, "%-20s %5.1f %%  (%zu/%zu, 95 %% CI %.1f-%.1f %%)\n", name, 100.0 * successes / std::max<size_t>(n, 1),
+          successes, n, 100 * lo, 100 * hi);
+}
+
+static void writeSummary(FILE* out, const char* scenarioPath, const std::vector<Run>& runs) {
+  std::vector<double> acquire, intercept, minDistance, effort, servoTravel, altitude, ceilingHold, yawRate, ekfYawRate;
+  size_t acquired = 0, intercepted = 0, passed = 0;
+  for (const Run& run : runs) {
+    const SimResult& r = run.result;
+    if (r.acquired) {
+      acquired++;
+      acquire.push_back(r.timeToAcquire);
+    }
+    if (r.intercepted) {
+      intercepted++;
+      intercept.push_back(r.interceptTime);
+    }
+    if (run.passed) passed++;
+    minDistance.push_back(r.minDistance);
+    effort.push_back(r.thrustEffortMean);
+    servoTravel.push_back(r.servoTravel);
+    altitude.push_back(r.altitudeErrorRms);
+    if (r.ceilingHoldErrorRms >= 0) ceilingHold.push_back(r.ceilingHoldErrorRms);
+    yawRate.push_back(r.yawRateErrorRms);
+    ekfYawRate.push_back(r.ekfYawRateErrorRms);
+  }
+
+  fprintf(out, "scenario             %s, %zu runs\n", scenarioPath, runs.size());
+  printRate(out, "acquired", acquired, runs.size());
+  printRate(out, "intercepted", intercepted, runs.size());
+  printRate(out, "expectations met", passed, runs.size());
+  printStat(out, "time to acquire", acquire, "s");
+  printStat(out, "time to intercept", intercept, "s");
+  printStat(out, "closest approach", minDistance, "m");
+  printStat(out, "thrust effort", effort, "");
+  printStat(out, "servo travel", servoTravel, "deg");
+  printStat(out, "altitude rmse", altitude, "m");
+  printStat(out, "ceiling hold rmse", ceilingHold, "m");
+  printStat(out, "yaw rate rmse", yawRate, "deg/s");
+  printStat(out, "ekf yaw rate rmse", ekfYawRate, "deg/s");
+}
+
+int main(int argc, char** argv) {
+  const char* scenarioPath = nullptr;
+  std::string outDir;
+  size_t runCount = 1000;
+  unsigned jobs = 0;
+  unsigned baseSeed = 1;
+  std::vector<Variation> variations;
+  std::vector<std::pair<std::string, std::string>> settings;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--runs" && i + 1 < argc) runCount = strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--jobs" && i + 1 < argc) jobs = atoi(argv[++i]);
+    else if (arg == "--seed" && i + 1 < argc) baseSeed = strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--out" && i + 1 < argc) outDir = argv[++i];
+    else if ((arg == "--vary" || arg == "--set") && i + 1 < argc) {
+      std::string spec = argv[++i];
+      size_t eq = spec.find('=');
+      if (eq == std::string::npos) {
+        fprintf(stderr, "bad %s %s\n", arg.c_str(), spec.c_str());
+        return 2;
+      }
+      if (arg == "--set") {
+        settings.push_back({spec.substr(0, eq), spec.substr(eq + 1)});
+        continue;
+      }
+      Variation v;
+      v.name = spec.substr(0, eq);
+      if (sscanf(spec.c_str() + eq + 1, "%lf:%lf", &v.lo, &v.hi) != 2 || v.hi < v.lo) {
+        fprintf(stderr, "bad --vary %s, expected name=lo:hi\n", spec.c_str());
+        return 2;
+      }
+      variations.push_back(v);
+    }
+    else if (scenarioPath == nullptr && arg[0] != '-') scenarioPath = argv[i];
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (scenarioPath == nullptr || runCount == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  SimConfig scenario;
+  ControllerParameters parameters;
+  std::string error;
+  if (!scenario.load(scenarioPath, error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+  for (const auto& s : settings) {
+    if (!applySetting(scenario, parameters, s.first, s.second)) {
+      fprintf(stderr, "bad setting %s = %s\n", s.first.c_str(), s.second.c_str());
+      return 2;
+    }
+  }
+  // Check the --vary names once here rather than in every run
+  for (const Variation& v : variations) {
+    SimConfig probe = scenario;
+    ControllerParameters probeParameters;
+    if (!applySetting(probe, probeParameters, v.name, formatValue(v.lo))) {
+      fprintf(stderr, "unknown --vary name %s\n", v.name.c_str());
+      return 2;
+    }
+  }
+
+  if (outDir.empty()) outDir = std::filesystem::path(scenarioPath).stem().string() + "_montecarlo";
+  std::filesystem::create_directories(outDir);
+
+  std::vector<Run> runs(runCount);
+  std::atomic<size_t> finished(0);
+
+  WorkStealingPool pool(jobs);
+  auto start = std::chrono::steady_clock::now();
+
+  std::atomic<bool> done(false);
+  std::thread progress([&]() {
+    for (int ticks = 1; !done; ticks++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (ticks % 20 == 0) fprintf(stderr, "\r%zu/%zu runs", finished.load(), runCount);
+    }
+  });
+
+  pool.run(runCount, [&](size_t i) {
+    Run& run = runs[i];
+    SimConfig config = scenario;
+    ControllerParameters runParameters = parameters;
+    config.seed = baseSeed + i;
+
+    std::seed_seq seq{baseSeed, (unsigned)i};
+    std::mt19937 rng(seq);
+    for (const Variation& v : variations) {
+      double value = std::uniform_real_distribution<double>(v.lo, v.hi)(rng);
+      applySetting(config, runParameters, v.name, formatValue(value));
+      run.draws.push_back(value);
+    }
+
+    run.result = runSimulation(config, runParameters, std::string());
+    std::string why;
+    run.passed = checkExpectations(config, run.result, why);
+    finished++;
+  });
+
+  done = true;
+  progress.join();
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "\r%40s\r", "");
+
+  double flightSeconds = 0;
+  for (const Run& run : runs) flightSeconds += run.result.duration;
+
+  std::string runsPath = outDir + "/runs.csv";
+  FILE* csv = fopen(runsPath.c_str(), "w");
+  if (csv == nullptr) {
+    fprintf(stderr, "cannot write %s\n", runsPath.c_str());
+    return 1;
+  }
+  fprintf(csv, "run,seed");
+  for (const Variation& v : variations) fprintf(csv, ",%s", v.name.c_str());
+  fprintf(csv, ",duration,acquired,timeToAcquire,intercepted,interceptTime,minDistance,thrustEffortMean,"
+               "servoTravel,altitudeErrorRms,ceilingHoldErrorRms,yawRateErrorRms,ekfYawRateErrorRms,passed\n");
+  for (size_t i = 0; i < runs.size(); i++) {
+    const SimResult& r = runs[i].result;
+    fprintf(csv, "%zu,%zu", i, baseSeed + i);
+    for (double d : runs[i].draws) fprintf(csv, ",%g", d);
+    fprintf(csv, ",%g,%d,%g,%d,%g,%g,%g,%g,%g,%g,%g,%g,%d\n", r.duration, r.acquired, r.timeToAcquire,
+            r.intercepted, r.interceptTime, r.minDistance, r.thrustEffortMean, r.servoTravel,
+            r.altitudeErrorRms, r.ceilingHoldErrorRms, r.yawRateErrorRms, r.ekfYawRateErrorRms, runs[i].passed);
+  }
+  fclose(csv);
+
+  std::string summaryPath = outDir + "/summary.txt";
+  FILE* summary = fopen(summaryPath.c_str(), "w");
+  if (summary != nullptr) {
+    writeSummary(summary, scenarioPath, runs);
+    fclose(summary);
+  }
+  writeSummary(stdout, scenarioPath, runs);
+  printf("%.0f s of flight in %.1f s wall (%.0fx real time), %u thread(s), %zu steal(s)\n",
+         flightSeconds, wallSeconds, flightSeconds / std::max(wallSeconds, 1e-9), pool.workers(), pool.steals());
+  printf("runs: %s\n", runsPath.c_str());
+  return 0;
+}
@@ -0,0 +1,120 @@
+"""
+placement_report.py - where the linked Teensy 4.0 firmware put its code and data
+
+Usage: python3 placement_report.py .pio/build/teensy40/firmware.elf [--top 10] [--src src]
+
+Sums the sections of the ELF per memory region (ITCM, DTCM, OCRAM, flash) and
+shows how much of RAM1 is left for the stack once ITCM has taken its 32 KB
+banks. Lists the largest symbols of each region, then checks that every
+function marked HOT_CODE in the sources (include/MemoryPlacement.h) ended up in
+ITCM. Exits with status 1 when one of them is in flash. Needs arm-none-eabi-size
+and arm-none-eabi-nm on the PATH, or --toolchain with their prefix.
+"""
+
+import argparse
+import glob
+import math
+import os
+import re
+import subprocess
+import sys
+
+RAM1_SIZE = 512 * 1024
+ITCM_BANK = 32 * 1024
+
+# name, first address, end address
+REGIONS = [
+    ("ITCM", 0x00000000, 0x00080000),
+    ("DTCM", 0x20000000, 0x20080000),
+    ("OCRAM", 0x20200000, 0x20280000),
+    ("flash", 0x60000000, 0x70000000),
+]
+
+
+def region_of(address):
+    for name, start, end in REGIONS:
+        if start <= address < end:
+            return name
+    return None
+
+
+def run(tool, elf):
+    return subprocess.run(tool + [elf], check=True, capture_output=True, text=True).stdout
+
+
+def section_sizes(toolchain, elf):
+    sizes = {name: 0 for name, _, _ in REGIONS}
+    for line in run([toolchain + "size", "-A"], elf).splitlines():
+        fields = line.split()
+        if len(fields) != 3 or not fields[1].isdigit():
+            continue
+        name, size, address = fields[0], int(fields[1]), int(fields[2])
+        region = region_of(address)
+        if region is None or size == 0 or name.startswith(".debug"):
+            continue
+        sizes[region] += size
+    return sizes
+
+
+def symbols(toolchain, elf):
+    out = []
+    for line in run([toolchain + "nm", "-S", "-C", "--defined-only"], elf).splitlines():
+        m = re.match(r"([0-9a-f]+) ([0-9a-f]+) (\w) (.*)", line)
+        if m:
+            out.append((int(m.group(1), 16), int(m.group(2), 16), m.group(3), m.group(4)))
+    return out
+
+
+def hot_functions(src_dir):
+    names = set()
+    for path in glob.glob(os.path.join(src_dir, "*.cpp")):
+        with open(path, "r") as f:
+            for line in f:
+                m = re.match(r"HOT_CODE\s+[\w:<>&*\s]+?\s[&*]?([\w:]+)\s*\(", line)
+                if m:
+                    names.add(m.group(1))
+    return sorted(names)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("--top", type=int, default=10, help="largest symbols listed per region")
+    parser.add_argument("--src", default=os.path.join(os.path.dirname(__file__), "..", "src"))
+    parser.add_argument("--toolchain", default="arm-none-eabi-")
+    args = parser.parse_args()
+
+    sizes = section_sizes(args.toolchain, args.elf)
+    itcm_banks = int(math.ceil(sizes["ITCM"] / float(ITCM_BANK)))
+    dtcm_size = RAM1_SIZE - itcm_banks * ITCM_BANK
+    print("%-6s %10s" % ("region", "bytes"))
+    for name, _, _ in REGIONS:
+        print("%-6s %10d" % (name, sizes[name]))
+    print("ITCM %d x 32 KB banks, DTCM %d bytes, %d left for the stack" %
+          (itcm_banks, dtcm_size, dtcm_size - sizes["DTCM"]))
+
+    syms = symbols(args.toolchain, args.elf)
+    for name, _, _ in REGIONS:
+        in_region = sorted((s for s in syms if region_of(s[0]) == name), key=lambda s: -s[1])
+        print("\n%s, largest symbols:" % name)
+        for address, size, _, symbol in in_region[:args.top]:
+            print("  %08x %8d %s" % (address, size, symbol))
+
+    # demangled names carry the parameter list, match on the qualified name
+    misplaced = []
+    hot = hot_functions(args.src)
+    for function in hot:
+        found = [s for s in syms if s[2] in "tT" and s[3].split("(")[0] == function]
+        if not found:
+            print("\nwarning: %s not found, inlined or renamed" % function)
+        elif any(region_of(s[0]) != "ITCM" for s in found):
+            misplaced.append(function)
+
+    print("\n%d HOT_CODE functions, %d outside ITCM" % (len(hot), len(misplaced)))
+    for function in misplaced:
+        print("  " + function)
+    return 1 if misplaced else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,78 @@
+#include "FlightLogReader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Payload size of each record type, 0 for unknown types
+static uint8_t payloadSize(uint8_t type) {
+  switch (type) {
+    case LOG_IMU: return sizeof(LogImu);
+    case LOG_BARO: return sizeof(LogBaro);
+    case LOG_CAMERA: return sizeof(LogCamera);
+    case LOG_ATTITUDE: return sizeof(LogAttitude);
+    case LOG_ALTITUDE: return sizeof(LogAltitude);
+    case LOG_CONTROL: return sizeof(LogControl);
+    case LOG_MOTOR: return sizeof(LogMotor);
+    case LOG_COMMAND: return sizeof(LogCommand);
+    case LOG_ALTITUDE_HOLD: return sizeof(LogAltitudeHold);
+    case LOG_GUIDANCE: return sizeof(LogGuidance);
+    case LOG_DEBUG: return sizeof(LogDebug);
+    case LOG_MEMORY: return sizeof(LogMemory);
+    case LOG_CALIBRATION: return sizeof(LogCalibration);
+    default: return 0;
+  }
+}
+
+bool FlightLogReader::load(const char* path) {
+  records.clear();
+  skippedBytes = 0;
+
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    error = std::string("cannot open ") + path;
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.insert(data.end(), chunk, chunk + n);
+  fclose(file);
+
+  if (data.size() < sizeof(FlightLogFileHeader)) {
+    error = "file too short for a flight log header";
+    return false;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  if (memcmp(header.magic, "BLOG", 4) != 0) {
+    error = "not a flight log (bad magic)";
+    return false;
+  }
+  // The record layouts change between versions, an older log would be misread
+  if (header.version != FLIGHTLOG_VERSION) {
+    error = "log version " + std::to_string(header.version) + ", this tool reads version "
+            + std::to_string(FLIGHTLOG_VERSION) + " only; use the tools from the revision that recorded it";
+    return false;
+  }
+
+  size_t offset = header.headerSize;
+  while (offset + sizeof(FlightLogRecordHeader) <= data.size()) {
+    FlightLogRecordHeader recordHeader;
+    memcpy(&recordHeader, &data[offset], sizeof(recordHeader));
+    size_t end = offset + sizeof(recordHeader) + recordHeader.length;
+    if (recordHeader.sync != FLIGHTLOG_RECORD_SYNC || payloadSize(recordHeader.type) == 0
+        || payloadSize(recordHeader.type) != recordHeader.length || end > data.size()) {
+      // Damaged or truncated, resync on the next candidate
+      offset++;
+      skippedBytes++;
+      continue;
+    }
+
+    FlightLogRecord record;
+    record.type = recordHeader.type;
+    record.timeMicros = recordHeader.timeMicros;
+    memcpy(&record.imu, &data[offset + sizeof(recordHeader)], recordHeader.length);
+    records.push_back(record);
+    offset = end;
+  }
+  return true;
+}
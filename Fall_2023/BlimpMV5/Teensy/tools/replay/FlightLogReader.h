@@ -0,0 +1,42 @@
+/*
+ FlightLogReader.h - loads a FLTnnn.BIN flight log (see include/FlightLogFormat.h) on the host
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "FlightLogFormat.h"
+
+struct FlightLogRecord {
+  uint8_t type;
+  uint32_t timeMicros;
+  union {
+    LogImu imu;
+    LogBaro baro;
+    LogCamera camera;
+    LogAttitude attitude;
+    LogAltitude altitude;
+    LogControl control;
+    LogMotor motor;
+    LogCommand command;
+    LogAltitudeHold altitudeHold;
+    LogGuidance guidance;
+    LogDebug debug;
+    LogMemory memory;
+    LogCalibration calibration;
+  };
+};
+
+class FlightLogReader {
+  public:
+    // Returns false if the file is missing or not a flight log, see error
+    bool load(const char* path);
+
+    FlightLogFileHeader header;
+    std::vector<FlightLogRecord> records;
+    uint32_t skippedBytes = 0;
+    std::string error;
+};
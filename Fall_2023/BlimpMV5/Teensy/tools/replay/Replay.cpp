@@ -0,0 +1,166 @@
+#include "Replay.h"
+
+#include <Arduino.h>
+#include <mutex>
+#include <string.h>
+
+#include "FlightController.h"
+#include "MotorMapping.h"
+#include "TeensyParams.h"
+
+// MotorMapping::Init touches a file scope clock in MotorMapping.cpp
+static std::mutex initMutex;
+
+static const char* TRACE_HEADER =
+  "time,gx,gy,gz,ax,ay,az,"
+  "roll,pitch,yaw,ekfRoll,ekfPitch,ekfYaw,ekfYawRate,ekfYawRateBias,"
+  "x,v,a,b,verticalAccel,"
+  "state,autonomousState,forwardInput,upInput,yawInput,yawRate,yawRateFilter,yawPIDInput,targetBearing,targetElevation,"
+  "servoR,servoL,motorR,motorL\n";
+
+static void writeTraceRow(FILE* trace, double t, const LogImu& imu, FlightController& c, const MotorMapping& motors) {
+  fprintf(trace, "%.6f,%g,%g,%g,%g,%g,%g,", t, imu.gx, imu.gy, imu.gz, imu.ax, imu.ay, imu.az);
+  fprintf(trace, "%g,%g,%g,%g,%g,%g,%g,%g,", c.roll, c.pitch, c.yaw,
+          c.gyroEKF.roll, c.gyroEKF.pitch, c.gyroEKF.yaw, c.gyroEKF.yawRate, c.gyroEKF.yawRateB);
+  fprintf(trace, "%g,%g,%g,%g,%g,", c.kf.x, c.kf.v, c.kf.a, c.kf.b, c.verticalAccelFilter.last);
+  fprintf(trace, "%d,%d,%g,%g,%g,%g,%g,%g,%g,%g,", (int)c.state, (int)c.autonomousState,
+          c.forwardInput, c.upInput, c.yawInput, c.yawRateEstimate, c.yawRateFilter.last, c.yawPIDInput,
+          c.target.bearing, c.target.elevation);
+  fprintf(trace, "%g,%g,%g,%g\n", motors.outRServo, motors.outLServo, motors.outRMotor, motors.outLMotor);
+}
+
+ReplayResult runReplay(const std::vector<FlightLogRecord>& records, const ParameterSet& parameters, const std::string& tracePath) {
+  ReplayResult result;
+  if (records.empty()) return result;
+
+  // LOG_COMMAND is only written when a command arrives, without one the mode is in LOG_CONTROL
+  bool haveCommands = false;
+  for (const FlightLogRecord& r : records) {
+    if (r.type == LOG_COMMAND) {
+      haveCommands = true;
+      break;
+    }
+  }
+
+  nativeClock::setMicros(records.front().timeMicros);
+
+  FlightController controller{};
+  for (const auto& p : parameters) controller.setParameter(p.first.c_str(), p.second);
+  controller.Init();
+
+  // Unused pins, same as the benchmarks. Value initialised like the firmware
+  // global so the servo filters start from 0
+  MotorMapping motors{};
+  {
+    std::lock_guard<std::mutex> lock(initMutex);
+    motors.Init(20, 21, 22, 23, 5, 50, 1000, 2000, 0.3, nullptr);
+  }
+  motors.setServoSlewRate(SERVO_SLEW_RATE, SERVO_FLIP_MARGIN);
+
+  FILE* trace = nullptr;
+  if (!tracePath.empty()) {
+    trace = fopen(tracePath.c_str(), "w");
+    if (trace != nullptr) fputs(TRACE_HEADER, trace);
+  }
+
+  double yawErrorSq = 0, baroInnovationSq = 0, pitchDiffSq = 0, yawEffort = 0;
+  uint32_t fastLoops = 0, baroUpdates = 0, approachLoops = 0;
+  uint32_t startMicros = records.front().timeMicros;
+
+  for (const FlightLogRecord& r : records) {
+    nativeClock::setMicros(r.timeMicros);
+    double t = (uint32_t)(r.timeMicros - startMicros) / MICROS_TO_SEC;
+
+    switch (r.type) {
+      case LOG_IMU: {
+        controller.updateImu(r.imu.gx, r.imu.gy, r.imu.gz, r.imu.ax, r.imu.ay, r.imu.az, r.imu.dt);
+        controller.update();
+
+        if (controller.autonomousState == lost || MOTORS_OFF) {
+          motors.update(0,0,0,0);
+          controller.setActuatorAuthority(0, 0);
+        } else {
+          motors.update(0, controller.forwardInput, controller.upInput, controller.yawPIDInput);
+          controller.setActuatorAuthority(motors.yawAuthority, motors.upAuthority);
+        }
+
+        double yawError = controller.yawInput - controller.yawRateEstimate;
+        yawErrorSq += yawError * yawError;
+        double pitchDiff = controller.pitch - controller.gyroEKF.pitch * RAD_TO_DEG;
+        pitchDiffSq += pitchDiff * pitchDiff;
+        yawEffort += fabs(controller.yawPIDInput);
+        if (controller.state == approach) approachLoops++;
+        fastLoops++;
+
+        if (trace != nullptr) writeTraceRow(trace, t, r.imu, controller, motors);
+      } continue;
+
+      case LOG_BARO: {
+        double innovation = r.baro.alt - controller.kf.x;
+        baroInnovationSq += innovation * innovation;
+        baroUpdates++;
+        controller.updateBaro(r.baro.alt);
+      } break;
+
+      case LOG_CAMERA: {
+        double parsed[7];
+        for (int i = 0; i < 6; i++) parsed[i] = r.camera.blobs[i];
+        parsed[6] = r.camera.ceilHeight;
+        double widths[3] = {r.camera.widths[0], r.camera.widths[1], r.camera.widths[2]};
+        controller.updateCamera(parsed, widths);
+      } break;
+
+      case LOG_COMMAND: {
+        controller.autonomousState = (autonomousStates)r.command.autonomousState;
+        controller.targetColor = (targetColors)r.command.targetColor;
+        controller.setManualInput(r.command.yaw, r.command.forward, r.command.up);
+      } break;
+
+      case LOG_CONTROL: {
+        if (!haveCommands) controller.autonomousState = (autonomousStates)r.control.autonomousState;
+        result.recordedYawPIDMaxDiff = std::max(result.recordedYawPIDMaxDiff, fabs(r.control.yawPIDInput - controller.yawPIDInput));
+      } break;
+
+      case LOG_ALTITUDE: {
+        result.recordedAltitudeMaxDiff = std::max(result.recordedAltitudeMaxDiff, (double)fabs(r.altitude.x - controller.kf.x));
+      } break;
+
+      case LOG_CALIBRATION: {
+        // the flight's gyro bias and filter warm start, saving changes nothing
+        const LogCalibration& l = r.calibration;
+        if (l.event != LOG_CALIBRATION_LOADED && l.event != LOG_CALIBRATION_RUN) break;
+        CalibrationData data;
+        memcpy(data.gyroBias, l.gyroBias, sizeof(data.gyroBias));
+        memcpy(data.accelOffset, l.accelOffset, sizeof(data.accelOffset));
+        memcpy(data.accelScale, l.accelScale, sizeof(data.accelScale));
+        memcpy(data.gyroEKFBias, l.gyroEKFBias, sizeof(data.gyroEKFBias));
+        memcpy(data.gyroEKFVariance, l.gyroEKFVariance, sizeof(data.gyroEKFVariance));
+        data.kfBias = l.kfBias;
+        memcpy(data.kfVariance, l.kfVariance, sizeof(data.kfVariance));
+        controller.applyCalibration(data);
+        if (l.event == LOG_CALIBRATION_RUN) {
+          float trim[3][3];
+          memcpy(trim, l.trim, sizeof(trim));
+          controller.rotateAxes(trim);
+          controller.zeroHeight();
+        }
+      } break;
+
+      default:
+        break;
+    }
+    controller.update();
+  }
+
+  if (trace != nullptr) fclose(trace);
+
+  result.duration = (uint32_t)(records.back().timeMicros - startMicros) / MICROS_TO_SEC;
+  if (fastLoops > 0) {
+    result.yawRateErrorRms = sqrt(yawErrorSq / fastLoops);
+    result.pitchDisagreementRms = sqrt(pitchDiffSq / fastLoops);
+    result.yawEffortMean = yawEffort / fastLoops;
+    result.approachFraction = (double)approachLoops / fastLoops;
+  }
+  if (baroUpdates > 0) result.baroInnovationRms = sqrt(baroInnovationSq / baroUpdates);
+  return result;
+}
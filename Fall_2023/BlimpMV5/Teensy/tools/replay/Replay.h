@@ -0,0 +1,34 @@
+/*
+ Replay.h - re-runs FlightController and MotorMapping on a recorded flight log
+
+ Records are fed in their original order with the virtual clock set to each
+ record's timestamp, so everything that reads micros()/millis() sees the same
+ times as in flight. FlightController::update() runs after every record; the
+ firmware runs it on every loop() pass, which only matters for the 30 Hz manual
+ and 10 Hz outer loop gates, both driven by the same clock here.
+*/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FlightLogReader.h"
+
+typedef std::vector<std::pair<std::string, double>> ParameterSet;
+
+struct ReplayResult {
+  double duration = 0;              // [s] of flight replayed
+  double yawRateErrorRms = 0;       // [deg/s] yaw rate setpoint - filtered yaw rate
+  double baroInnovationRms = 0;     // [m] baro altitude - kf.x before each baro update
+  double pitchDisagreementRms = 0;  // [deg] madgwick pitch - gyro ekf pitch
+  double yawEffortMean = 0;         // mean |yawPIDInput|
+  double approachFraction = 0;      // share of fast loops spent in approach
+  // Against the values recorded in flight, ~0 when replaying with the flight parameters
+  double recordedYawPIDMaxDiff = 0;
+  double recordedAltitudeMaxDiff = 0;
+};
+
+// Runs one replay, writing one row per fast loop to tracePath unless it is empty
+ReplayResult runReplay(const std::vector<FlightLogRecord>& records, const ParameterSet& parameters, const std::string& tracePath);
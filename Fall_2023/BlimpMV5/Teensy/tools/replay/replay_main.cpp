@@ -0,0 +1,169 @@
+/*
+ replay_main.cpp - offline re-run of the flight code on a recorded flight log
+
+ pio run -e replay_native
+ .pio/build/replay_native/program FLT003.BIN [--out dir] [--jobs N] [--no-trace]
+                                  [--set name=v1,v2,...] [--set name=start:stop:step] ...
+
+ Every combination of the --set values is one run (a grid). Runs are spread
+ over --jobs threads, each with its own virtual clock. Each run writes
+ dir/run_NNN.csv (all intermediate states, one row per fast loop) and
+ dir/summary.csv lists the parameters and metrics of every run. Parameter
+ names are the ones accepted by FlightController::setParameter.
+*/
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FlightController.h"
+#include "FlightLogReader.h"
+#include "Replay.h"
+
+struct GridAxis {
+  std::string name;
+  std::vector<double> values;
+};
+
+// "a,b,c" or "start:stop:step"
+static bool parseValues(const std::string& text, std::vector<double>& values) {
+  values.clear();
+  double start, stop, step;
+  if (sscanf(text.c_str(), "%lf:%lf:%lf", &start, &stop, &step) == 3) {
+    if (step <= 0 || stop < start) return false;
+    for (int i = 0; start + i * step <= stop + step * 1e-9; i++) values.push_back(start + i * step);
+    return true;
+  }
+  size_t begin = 0;
+  while (begin <= text.size()) {
+    size_t end = text.find(',', begin);
+    if (end == std::string::npos) end = text.size();
+    char* parsedEnd;
+    std::string item = text.substr(begin, end - begin);
+    double value = strtod(item.c_str(), &parsedEnd);
+    if (item.empty() || *parsedEnd != '\0') return false;
+    values.push_back(value);
+    begin = end + 1;
+  }
+  return !values.empty();
+}
+
+static std::vector<ParameterSet> expandGrid(const std::vector<GridAxis>& axes) {
+  std::vector<ParameterSet> sets(1);
+  for (const GridAxis& axis : axes) {
+    std::vector<ParameterSet> next;
+    for (const ParameterSet& set : sets) {
+      for (double value : axis.values) {
+        ParameterSet extended = set;
+        extended.push_back({axis.name, value});
+        next.push_back(extended);
+      }
+    }
+    sets.swap(next);
+  }
+  return sets;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr, "usage: %s FLIGHT_LOG [--out dir] [--jobs N] [--no-trace] [--set name=values]...\n", program);
+}
+
+int main(int argc, char** argv) {
+  const char* logPath = nullptr;
+  std::string outDir;
+  unsigned jobs = std::thread::hardware_concurrency();
+  bool writeTraces = true;
+  std::vector<GridAxis> axes;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--out" && i + 1 < argc) outDir = argv[++i];
+    else if (arg == "--jobs" && i + 1 < argc) jobs = atoi(argv[++i]);
+    else if (arg == "--no-trace") writeTraces = false;
+    else if (arg == "--set" && i + 1 < argc) {
+      std::string spec = argv[++i];
+      size_t eq = spec.find('=');
+      GridAxis axis;
+      FlightController probe;
+      if (eq == std::string::npos || !parseValues(spec.substr(eq + 1), axis.values)) {
+        fprintf(stderr, "bad --set %s\n", spec.c_str());
+        return 2;
+      }
+      axis.name = spec.substr(0, eq);
+      if (!probe.setParameter(axis.name.c_str(), 0)) {
+        fprintf(stderr, "unknown parameter %s\n", axis.name.c_str());
+        return 2;
+      }
+      axes.push_back(axis);
+    }
+    else if (logPath == nullptr && arg[0] != '-') logPath = argv[i];
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (logPath == nullptr) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (jobs == 0) jobs = 1;
+
+  FlightLogReader reader;
+  if (!reader.load(logPath)) {
+    fprintf(stderr, "%s: %s\n", logPath, reader.error.c_str());
+    return 1;
+  }
+  if (reader.skippedBytes > 0) fprintf(stderr, "%s: skipped %u damaged bytes\n", logPath, reader.skippedBytes);
+
+  if (outDir.empty()) outDir = std::filesystem::path(logPath).stem().string() + "_replay";
+  std::filesystem::create_directories(outDir);
+
+  std::vector<ParameterSet> runs = expandGrid(axes);
+  std::vector<ReplayResult> results(runs.size());
+  std::atomic<size_t> nextRun(0);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned w = 0; w < std::min<size_t>(jobs, runs.size()); w++) {
+    workers.emplace_back([&]() {
+      size_t run;
+      while ((run = nextRun++) < runs.size()) {
+        char tracePath[64] = "";
+        if (writeTraces) snprintf(tracePath, sizeof(tracePath), "/run_%03zu.csv", run);
+        results[run] = runReplay(reader.records, runs[run], writeTraces ? outDir + tracePath : std::string());
+      }
+    });
+  }
+  for (std::thread& worker : workers) worker.join();
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::string summaryPath = outDir + "/summary.csv";
+  FILE* summary = fopen(summaryPath.c_str(), "w");
+  if (summary == nullptr) {
+    fprintf(stderr, "cannot write %s\n", summaryPath.c_str());
+    return 1;
+  }
+  fprintf(summary, "run");
+  for (const GridAxis& axis : axes) fprintf(summary, ",%s", axis.name.c_str());
+  fprintf(summary, ",yawRateErrorRms,baroInnovationRms,pitchDisagreementRms,yawEffortMean,approachFraction,"
+                   "recordedYawPIDMaxDiff,recordedAltitudeMaxDiff\n");
+  for (size_t run = 0; run < runs.size(); run++) {
+    const ReplayResult& r = results[run];
+    fprintf(summary, "%zu", run);
+    for (const auto& p : runs[run]) fprintf(summary, ",%g", p.second);
+    fprintf(summary, ",%g,%g,%g,%g,%g,%g,%g\n", r.yawRateErrorRms, r.baroInnovationRms, r.pitchDisagreementRms,
+            r.yawEffortMean, r.approachFraction, r.recordedYawPIDMaxDiff, r.recordedAltitudeMaxDiff);
+  }
+  fclose(summary);
+
+  double flightSeconds = results.empty() ? 0 : results[0].duration;
+  printf("%zu run(s) of %.1f s of flight in %.2f s wall (%.0fx real time), %u thread(s)\n",
+         runs.size(), flightSeconds, wallSeconds, wallSeconds > 0 ? flightSeconds * runs.size() / wallSeconds : 0.0,
+         (unsigned)workers.size());
+  printf("summary: %s\n", summaryPath.c_str());
+  return 0;
+}
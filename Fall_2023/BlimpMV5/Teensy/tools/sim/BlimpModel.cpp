@@ -0,0 +1,108 @@
+#include "BlimpModel.h"
+
+#include <algorithm>
+
+#define GRAVITY       9.81
+#define ENVELOPE_TOP  0.25    // [m] CB to top of the envelope, for the ceiling contact
+
+void BlimpModel::Init(const SimConfig* config) {
+  this->config = config;
+  position = config->start;
+  velocity = Vec3();
+  rates = Vec3();
+  accelBody = Vec3();
+  roll = 0;
+  pitch = 0;
+  yaw = config->startYaw * M_PI / 180;
+  servoAngleR = servoCommandR = 45;
+  servoAngleL = servoCommandL = 135;
+  thrustR = thrustL = 0;
+  escR = escL = 1500;
+}
+
+void BlimpModel::setActuators(double servoR, double servoL, double escR, double escL) {
+  this->servoCommandR = std::min(std::max(servoR, 0.0), 180.0);
+  this->servoCommandL = std::min(std::max(servoL, 0.0), 180.0);
+  this->escR = escR;
+  this->escL = escL;
+}
+
+double BlimpModel::thrustFromEsc(double us) {
+  double command = us - 1500;
+  double magnitude = fabs(command) - config->escDeadband;
+  if (magnitude <= 0) return 0;
+  double throttle = std::min(magnitude / (500 - config->escDeadband), 1.0);
+  double thrust = config->maxThrust * pow(throttle, config->thrustExponent);
+  return command > 0 ? thrust : -thrust * config->reverseEfficiency;
+}
+
+static double slew(double current, double target, double maxStep) {
+  return current + std::min(std::max(target - current, -maxStep), maxStep);
+}
+
+static Vec3 absMul(const Vec3& v) {
+  return Vec3(fabs(v.x) * v.x, fabs(v.y) * v.y, fabs(v.z) * v.z);
+}
+
+void BlimpModel::step(double dt, const Vec3& windWorld) {
+  const SimConfig& c = *config;
+
+  // actuators
+  servoAngleR = slew(servoAngleR, servoCommandR, c.servoRate * dt);
+  servoAngleL = slew(servoAngleL, servoCommandL, c.servoRate * dt);
+  double lag = std::min(dt / c.motorTau, 1.0);
+  thrustR += (thrustFromEsc(escR) - thrustR) * lag;
+  thrustL += (thrustFromEsc(escL) - thrustL) * lag;
+
+  // Thrust elevation from the servo angles, inverse of the MotorMapping servo offsets
+  double elevationR = (servoAngleR - 45) * M_PI / 180;
+  double elevationL = (135 - servoAngleL) * M_PI / 180;
+  Vec3 forceR = Vec3(cos(elevationR), 0, sin(elevationR)) * thrustR;
+  Vec3 forceL = Vec3(cos(elevationL), 0, sin(elevationL)) * thrustL;
+  Vec3 armR(0, -c.armY, c.armZ);
+  Vec3 armL(0, c.armY, c.armZ);
+
+  Rotation R(roll, pitch, yaw);
+  Vec3 airVelocity = velocity - R.toBody(windWorld);
+
+  Vec3 mass = c.addedMass + Vec3(c.mass, c.mass, c.mass);
+  Vec3 inertia = c.inertia + c.addedInertia;
+
+  Vec3 force = forceR + forceL;
+  force += -(c.dragLinear.mul(airVelocity) + c.dragQuad.mul(absMul(airVelocity)));
+  force += R.toBody(Vec3(0, 0, c.netLift));
+  force += -rates.cross(mass.mul(velocity));
+
+  Vec3 weight = R.toBody(Vec3(0, 0, -c.mass * GRAVITY));
+  Vec3 torque = armR.cross(forceR) + armL.cross(forceL);
+  torque += Vec3(0, 0, -c.cgBelowCb).cross(weight);
+  torque += c.addedMass.mul(airVelocity).cross(airVelocity) * c.munkScale;
+  torque += -(c.rotDragLinear.mul(rates) + c.rotDragQuad.mul(absMul(rates)));
+  torque += -rates.cross(inertia.mul(rates));
+
+  Vec3 velocityDot = force.div(mass);
+  Vec3 ratesDot = torque.div(inertia);
+  accelBody = velocityDot + rates.cross(velocity);
+
+  velocity += velocityDot * dt;
+  rates += ratesDot * dt;
+
+  position += R.toWorld(velocity) * dt;
+
+  double sr = sin(roll), cr = cos(roll);
+  double tp = tan(pitch), cp = cos(pitch);
+  roll += (rates.x + (rates.y * sr + rates.z * cr) * tp) * dt;
+  pitch += (rates.y * cr - rates.z * sr) * dt;
+  yaw += (rates.y * sr + rates.z * cr) / cp * dt;
+  yaw = remainder(yaw, 2 * M_PI);
+
+  // Envelope against the ceiling, gondola against the floor
+  double top = c.ceiling - ENVELOPE_TOP;
+  if (position.z > top || position.z < 0) {
+    position.z = std::min(std::max(position.z, 0.0), top);
+    Rotation R2(roll, pitch, yaw);
+    Vec3 worldVelocity = R2.toWorld(velocity);
+    worldVelocity.z = 0;
+    velocity = R2.toBody(worldVelocity);
+  }
+}
@@ -0,0 +1,42 @@
+/*
+ BlimpModel.h - 6-DOF rigid body with added mass, drag, buoyancy and two vectored thrusters
+
+ Translation and rotation are integrated in the body frame (see SimConfig.h)
+ with diagonal rigid + added mass/inertia, linear + quadratic drag relative
+ to the air, the pendulum moment from the CG sitting below the CB and the
+ Munk moment of the added mass. Each thruster tilts in the body x-z plane on
+ its servo and follows its ESC command with a first order lag.
+*/
+
+#pragma once
+
+#include "SimConfig.h"
+#include "SimMath.h"
+
+class BlimpModel {
+  public:
+    void Init(const SimConfig* config);
+
+    // Actuator commands as written to the pins: servo angles [deg], ESC pulses [us]
+    void setActuators(double servoR, double servoL, double escR, double escL);
+
+    void step(double dt, const Vec3& windWorld);
+
+    // state
+    Vec3 position;      // world [m]
+    Vec3 velocity;      // body [m/s]
+    double roll = 0, pitch = 0, yaw = 0;  // [rad]
+    Vec3 rates;         // body p, q, r [rad/s]
+    Vec3 accelBody;     // last body acceleration incl. rotation terms [m/s^2]
+
+    // actuators
+    double servoAngleR = 45, servoAngleL = 135;  // [deg] actual
+    double thrustR = 0, thrustL = 0;             // [N] actual
+
+  private:
+    double thrustFromEsc(double us);
+
+    const SimConfig* config = nullptr;
+    double servoCommandR = 45, servoCommandL = 135;
+    double escR = 1500, escL = 1500;
+};
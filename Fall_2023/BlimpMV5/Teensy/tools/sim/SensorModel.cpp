@@ -0,0 +1,106 @@
+#include "SensorModel.h"
+
+#include <algorithm>
+
+#include "TeensyParams.h"
+
+#define GRAVITY           9.81
+#define IMAGE_WIDTH       320
+#define IMAGE_HEIGHT      240
+#define NOT_SEEN          1000
+
+void SensorModel::Init(const SimConfig* config, unsigned seed) {
+  this->config = config;
+  rng.seed(seed);
+  normal = std::normal_distribution<double>(0, 1);
+  uniform = std::uniform_real_distribution<double>(0, 1);
+  nextImu = nextBaro = nextCamera = 0;
+  baroDrift = 0;
+  imuQueue.clear();
+  baroQueue.clear();
+  cameraQueue.clear();
+}
+
+double SensorModel::gaussian(double std) {
+  return std > 0 ? normal(rng) * std : 0;
+}
+
+void SensorModel::sample(double t, const BlimpModel& blimp, const Vec3& target) {
+  const SimConfig& c = *config;
+  Rotation R(blimp.roll, blimp.pitch, blimp.yaw);
+
+  if (t >= nextImu) {
+    nextImu += 1.0 / FAST_SENSOR_LOOP_FREQ;
+    Vec3 gyro = blimp.rates * (180 / M_PI) + c.gyroBias;
+    // Specific force, +1 g on z at rest
+    Vec3 accel = (blimp.accelBody - R.toBody(Vec3(0, 0, -GRAVITY))) * (1 / GRAVITY);
+    ImuSample s = {gyro.x + gaussian(c.gyroNoise), gyro.y + gaussian(c.gyroNoise), gyro.z + gaussian(c.gyroNoise),
+                   accel.x + gaussian(c.accelNoise), accel.y + gaussian(c.accelNoise), accel.z + gaussian(c.accelNoise)};
+    imuQueue.push_back({t + c.imuLatency, s});
+  }
+
+  if (t >= nextBaro) {
+    double period = 1.0 / BARO_ODR_FREQ;
+    nextBaro += period;
+    baroDrift += gaussian(c.baroDrift * sqrt(period));
+    double alt = blimp.position.z - c.start.z + baroDrift + gaussian(c.baroNoise);
+    baroQueue.push_back({t + c.baroLatency, alt});
+  }
+
+  if (c.cameraFps > 0 && t >= nextCamera) {
+    nextCamera += 1.0 / c.cameraFps;
+    CameraSample s;
+    for (int i = 0; i < 6; i++) s.parsed[i] = NOT_SEEN;
+    for (int i = 0; i < 3; i++) s.width[i] = 0;
+
+    // Pinhole camera looking along body x, image x to the right and y down
+    Vec3 p = R.toBody(target - blimp.position);
+    double f = (IMAGE_WIDTH / 2) / tan(c.cameraHfov * M_PI / 360);
+    targetInView = false;
+    if (p.x > 0.1 && p.norm() < c.cameraMaxRange) {
+      double px = IMAGE_WIDTH / 2 + f * (-p.y / p.x);
+      double py = IMAGE_HEIGHT / 2 + f * (-p.z / p.x);
+      targetInView = px >= 0 && px < IMAGE_WIDTH && py >= 0 && py < IMAGE_HEIGHT;
+      bool searched = window.color == CAMERA_ALL_COLORS || window.color == (int)c.targetColor;
+      if (window.roiW > 0) {
+        searched = searched && px >= window.roiX && px < window.roiX + window.roiW &&
+                   py >= window.roiY && py < window.roiY + window.roiH;
+      }
+      if (targetInView && searched && uniform(rng) < c.detectProbability) {
+        int slot = 2 * (int)c.targetColor;
+        s.parsed[slot] = std::min(std::max(px + gaussian(c.pixelNoise), 0.0), IMAGE_WIDTH - 1.0);
+        s.parsed[slot + 1] = std::min(std::max(py + gaussian(c.pixelNoise), 0.0), IMAGE_HEIGHT - 1.0);
+        // bounding box width, cut by the frame edges
+        double width = f * c.targetDiameter / p.norm();
+        width += gaussian(c.pixelNoise + c.widthNoise * width);
+        double left = std::max(px - width / 2, 0.0);
+        double right = std::min(px + width / 2, IMAGE_WIDTH * 1.0);
+        s.width[(int)c.targetColor] = std::max(right - left, 1.0);
+      }
+    }
+
+    double ceilingDistance = c.ceiling - blimp.position.z;
+    s.parsed[6] = ceilingDistance > c.rangefinderMaxRange ? NOT_SEEN : ceilingDistance * 100 + gaussian(c.rangefinderNoise);
+    cameraQueue.push_back({t + c.cameraLatency, s});
+  }
+}
+
+template <typename T>
+bool SensorModel::pop(std::deque<Delayed<T>>& queue, double t, T& out) {
+  if (queue.empty() || queue.front().due > t) return false;
+  out = queue.front().value;
+  queue.pop_front();
+  return true;
+}
+
+bool SensorModel::popImu(double t, ImuSample& out) {
+  return pop(imuQueue, t, out);
+}
+
+bool SensorModel::popBaro(double t, double& out) {
+  return pop(baroQueue, t, out);
+}
+
+bool SensorModel::popCamera(double t, CameraSample& out) {
+  return pop(cameraQueue, t, out);
+}
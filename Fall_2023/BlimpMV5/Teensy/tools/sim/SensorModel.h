@@ -0,0 +1,72 @@
+/*
+ SensorModel.h - IMU, barometer, OpenMV camera and rangefinder as the firmware sees them
+
+ Each sensor samples the true state at its own rate, adds noise/bias from
+ SimConfig and is handed to the flight code after its latency. Samples come
+ out in the units FlightController expects: gyro deg/s and accel g in body
+ axes (ImuMounting.h), baro metres, and the 7 value OpenMV message (pixels, 1000 when
+ nothing is seen, ceiling distance in cm) with the blob widths.
+*/
+
+#pragma once
+
+#include <deque>
+#include <random>
+
+#include "BlimpModel.h"
+#include "CameraLink.h"
+#include "SimConfig.h"
+
+struct ImuSample {
+  double gx, gy, gz;  // [deg/s]
+  double ax, ay, az;  // [g]
+};
+
+struct CameraSample {
+  double parsed[7];
+  double width[3];    // [px] blob width per colour, 0 when not seen
+};
+
+class SensorModel {
+  public:
+    void Init(const SimConfig* config, unsigned seed);
+
+    // Samples due at time t [s] are queued, call once per physics step
+    void sample(double t, const BlimpModel& blimp, const Vec3& target);
+
+    // Pop a sample whose latency has elapsed, false if none is ready
+    bool popImu(double t, ImuSample& out);
+    bool popBaro(double t, double& out);
+    bool popCamera(double t, CameraSample& out);
+
+    // Colour and window the OpenMV searches, from FlightController::cameraRequest
+    void setCameraCommand(const CameraCommand& command) { window = command; }
+
+    // true while the target projects into the frame, before detection dropouts
+    bool targetInView = false;
+
+  private:
+    template <typename T>
+    struct Delayed {
+      double due;
+      T value;
+    };
+
+    template <typename T>
+    static bool pop(std::deque<Delayed<T>>& queue, double t, T& out);
+
+    double gaussian(double std);
+
+    const SimConfig* config = nullptr;
+    std::mt19937 rng;
+    std::normal_distribution<double> normal;
+    std::uniform_real_distribution<double> uniform;
+
+    CameraCommand window = {{0, 0}, CAMERA_ALL_COLORS, CAMERA_QVGA, 0, 0, 0, 0, 0};
+    double nextImu = 0, nextBaro = 0, nextCamera = 0;
+    double baroDrift = 0;
+
+    std::deque<Delayed<ImuSample>> imuQueue;
+    std::deque<Delayed<double>> baroQueue;
+    std::deque<Delayed<CameraSample>> cameraQueue;
+};
@@ -0,0 +1,290 @@
+#include "SilRunner.h"
+
+#include <Arduino.h>
+#include <Servo.h>
+#include <algorithm>
+#include <mutex>
+#include <random>
+
+#include "BlimpModel.h"
+#include "FlightController.h"
+#include "MemoryDiagnostics.h"
+#include "MotorMapping.h"
+#include "SensorModel.h"
+#include "TeensyParams.h"
+
+#define PHYSICS_DT      0.001   // [s]
+#define TRACE_PERIOD    0.01    // [s]
+#define SERVO_FRAME     0.02    // [s] Servo library refresh
+
+// MotorMapping::Init touches a file scope clock in MotorMapping.cpp
+static std::mutex initMutex;
+
+static const char* TRACE_HEADER =
+  "time,x,y,z,roll,pitch,yaw,u,v,w,p,q,r,targetX,targetY,targetZ,distance,"
+  "state,autonomousState,forwardInput,upInput,yawInput,yawRateFilter,yawPIDInput,kfX,"
+  "servoR,servoL,escR,escL,thrustR,thrustL,range,rangeSigma,rangeRate,terminal\n";
+
+// Flight code calls in scope may not allocate when forbid is set (forbidAllocationsAfter)
+struct FirmwareCall {
+  explicit FirmwareCall(bool forbid) { MemoryDiagnostics::forbidAllocations = forbid; }
+  ~FirmwareCall() { MemoryDiagnostics::forbidAllocations = false; }
+};
+
+// Servo stand-in pulse width back to the angle passed to write()
+static double servoAngle(int us) {
+  return (us - 544) * 180.0 / (2400 - 544);
+}
+
+// Throttle [us] as an ESC with protocol auto detection reads a pulse: OneShot125 is 125-250 us
+static double escThrottle(float pulse) {
+  if (pulse <= 0) return 1500;
+  return pulse < 500 ? pulse * 8 : pulse;
+}
+
+static void applyModes(const SimConfig& config, FlightController& controller) {
+  controller.autonomousState = config.autonomous != 0 ? autonomous : manual;
+  controller.targetColor = (targetColors)(int)config.targetColor;
+  controller.setManualInput(config.stickYaw, config.stickForward, config.stickUp);
+}
+
+static void moveTarget(const SimConfig& config, Vec3& target, Vec3& velocity, double dt) {
+  target += velocity * dt;
+  if (config.arenaHalfSize.x > 0 && fabs(target.x) > config.arenaHalfSize.x) {
+    target.x = copysign(config.arenaHalfSize.x, target.x);
+    velocity.x = -velocity.x;
+  }
+  if (config.arenaHalfSize.y > 0 && fabs(target.y) > config.arenaHalfSize.y) {
+    target.y = copysign(config.arenaHalfSize.y, target.y);
+    velocity.y = -velocity.y;
+  }
+}
+
+SimResult runSimulation(const SimConfig& initialConfig, const ControllerParameters& parameters, const std::string& tracePath) {
+  SimResult result;
+  SimConfig config = initialConfig;
+  size_t nextEvent = 0;
+
+  nativeClock::setMicros(0);
+
+  FlightController controller{};
+  for (const auto& p : parameters) controller.setParameter(p.first.c_str(), p.second);
+  controller.Init();
+  applyModes(config, controller);
+
+  // Value initialised like the firmware global so the servo filters start from 0
+  MotorMapping motors{};
+  {
+    std::lock_guard<std::mutex> lock(initMutex);
+    motors.Init(LSPIN, RSPIN, LMPIN, RMPIN, 5, 50, 1000, 2000, 0.3, nullptr);
+  }
+  motors.setServoSlewRate(SERVO_SLEW_RATE, SERVO_FLIP_MARGIN);
+
+  BlimpModel blimp;
+  blimp.Init(&config);
+
+  unsigned seed = (unsigned)config.seed;
+  SensorModel sensors;
+  sensors.Init(&config, seed);
+
+  // Gusts on their own stream so sensor settings do not change the wind
+  std::mt19937 windRng(seed ^ 0x5eed);
+  std::normal_distribution<double> normal(0, 1);
+  Vec3 gust;
+
+  Vec3 target = config.targetStart;
+  Vec3 targetVelocity = config.targetVelocity;
+
+  FILE* trace = nullptr;
+  if (!tracePath.empty()) {
+    trace = fopen(tracePath.c_str(), "w");
+    if (trace != nullptr) fputs(TRACE_HEADER, trace);
+  }
+
+  double altitudeErrorSq = 0, yawRateErrorSq = 0, ekfYawRateErrorSq = 0, thrustEffort = 0;
+  double ceilingHoldErrorSq = 0;
+  uint32_t imuSamples = 0, holdSamples = 0, steps = 0;
+  double lastImuTime = 0, nextTrace = 0;
+  // Actuators only see a new pulse once per PWM period
+  double nextServoFrame = 0, nextEscFrame = 0, nextCameraCommand = 0;
+  double servoR = blimp.servoAngleR, servoL = blimp.servoAngleL, escR = 1500, escL = 1500;
+  double lastServoR = blimp.servoAngleR, lastServoL = blimp.servoAngleL;
+  result.minDistance = (target - blimp.position).norm();
+
+  long totalSteps = lround(config.duration / PHYSICS_DT);
+  for (long i = 0; i < totalSteps; i++) {
+    double t = i * PHYSICS_DT;
+    nativeClock::setMicros((uint32_t)lround(t * MICROS_TO_SEC));
+
+    // scenario events
+    while (nextEvent < config.events.size() && config.events[nextEvent].time <= t) {
+      const SimConfig::Event& e = config.events[nextEvent++];
+      config.set(e.name, e.value);
+      if (e.name.compare(0, 15, "target.velocity") == 0) targetVelocity = config.targetVelocity;
+      if (e.name == "autonomous" || e.name == "target.color" || e.name.compare(0, 6, "stick.") == 0) {
+        applyModes(config, controller);
+      }
+    }
+
+    moveTarget(config, target, targetVelocity, PHYSICS_DT);
+
+    // Ornstein-Uhlenbeck gust on the horizontal wind
+    if (config.gust > 0) {
+      double decay = PHYSICS_DT / config.gustTau;
+      double kick = config.gust * sqrt(2 * decay);
+      gust.x += -gust.x * decay + kick * normal(windRng);
+      gust.y += -gust.y * decay + kick * normal(windRng);
+    }
+
+    // sensors into the flight code
+    bool forbid = config.forbidAllocationsAfter >= 0 && t >= config.forbidAllocationsAfter;
+    sensors.sample(t, blimp, target);
+    ImuSample imu;
+    while (sensors.popImu(t, imu)) {
+      double dt = imuSamples == 0 ? 1.0 / FAST_SENSOR_LOOP_FREQ : t - lastImuTime;
+      lastImuTime = t;
+      {
+        FirmwareCall call(forbid);
+        controller.updateImu(imu.gx, imu.gy, imu.gz, imu.ax, imu.ay, imu.az, dt);
+      }
+
+      double trueYawRate = blimp.rates.z * RAD_TO_DEG;
+      double altitudeError = controller.kf.x - (blimp.position.z - config.start.z);
+      double yawRateError = controller.yawRateFilter.last - trueYawRate;
+      double ekfYawRateError = (controller.gyroEKF.yawRate - controller.gyroEKF.yawRateB) * RAD_TO_DEG - trueYawRate;
+      altitudeErrorSq += altitudeError * altitudeError;
+      yawRateErrorSq += yawRateError * yawRateError;
+      ekfYawRateErrorSq += ekfYawRateError * ekfYawRateError;
+      imuSamples++;
+
+      if (controller.altitudeHold && controller.state == searching) {
+        double holdError = config.ceiling - blimp.position.z - controller.ceilingDistanceSetpoint;
+        ceilingHoldErrorSq += holdError * holdError;
+        holdSamples++;
+      }
+    }
+    double alt;
+    while (sensors.popBaro(t, alt)) {
+      FirmwareCall call(forbid);
+      controller.updateBaro(alt);
+    }
+    CameraSample camera;
+    while (sensors.popCamera(t, camera)) {
+      FirmwareCall call(forbid);
+      controller.updateCamera(camera.parsed, camera.width);
+    }
+
+    // loop()
+    {
+      FirmwareCall call(forbid);
+      controller.update();
+    }
+    if (t >= nextCameraCommand) {
+      nextCameraCommand += 1.0 / OUTERLOOP;
+      CameraCommand command;
+      {
+        FirmwareCall call(forbid);
+        controller.cameraRequest(command);
+      }
+      sensors.setCameraCommand(command);
+    }
+    {
+      FirmwareCall call(forbid);
+      if (controller.autonomousState == lost || MOTORS_OFF) {
+        motors.update(0,0,0,0);
+        controller.setActuatorAuthority(0, 0);
+      } else {
+        motors.update(0, controller.forwardInput, controller.upInput, controller.yawPIDInput);
+        controller.setActuatorAuthority(motors.yawAuthority, motors.upAuthority);
+      }
+    }
+
+    if (t >= nextServoFrame) {
+      nextServoFrame += SERVO_FRAME;
+      servoR = servoAngle(servoPinMicroseconds()[RSPIN]);
+      servoL = servoAngle(servoPinMicroseconds()[LSPIN]);
+    }
+    if (t >= nextEscFrame) {
+      nextEscFrame += 1.0 / nativePins::frequency(RMPIN);
+      escR = escThrottle(nativePins::pulseMicroseconds(RMPIN));
+      escL = escThrottle(nativePins::pulseMicroseconds(LMPIN));
+    }
+    blimp.setActuators(servoR, servoL, escR, escL);
+    blimp.step(PHYSICS_DT, config.wind + gust);
+    steps++;
+
+    // metrics
+    double distance = (target - blimp.position).norm();
+    result.minDistance = std::min(result.minDistance, distance);
+    if (!result.acquired && controller.state == approach) {
+      result.acquired = true;
+      result.timeToAcquire = t;
+    }
+    if (!result.intercepted && distance < config.interceptDistance) {
+      result.intercepted = true;
+      result.interceptTime = t;
+    }
+    thrustEffort += (fabs(blimp.thrustR) + fabs(blimp.thrustL)) / (2 * config.maxThrust);
+    result.servoTravel += fabs(blimp.servoAngleR - lastServoR) + fabs(blimp.servoAngleL - lastServoL);
+    lastServoR = blimp.servoAngleR;
+    lastServoL = blimp.servoAngleL;
+
+    if (trace != nullptr && t >= nextTrace) {
+      nextTrace += TRACE_PERIOD;
+      fprintf(trace, "%.3f,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,%g,", t,
+              blimp.position.x, blimp.position.y, blimp.position.z,
+              blimp.roll * RAD_TO_DEG, blimp.pitch * RAD_TO_DEG, blimp.yaw * RAD_TO_DEG,
+              blimp.velocity.x, blimp.velocity.y, blimp.velocity.z,
+              blimp.rates.x * RAD_TO_DEG, blimp.rates.y * RAD_TO_DEG, blimp.rates.z * RAD_TO_DEG);
+      fprintf(trace, "%g,%g,%g,%g,", target.x, target.y, target.z, distance);
+      fprintf(trace, "%d,%d,%g,%g,%g,%g,%g,%g,", (int)controller.state, (int)controller.autonomousState,
+              controller.forwardInput, controller.upInput, controller.yawInput,
+              controller.yawRateFilter.last, controller.yawPIDInput, controller.kf.x);
+      fprintf(trace, "%g,%g,%g,%g,%g,%g,", blimp.servoAngleR, blimp.servoAngleL,
+              escR, escL, blimp.thrustR, blimp.thrustL);
+      const RangeEstimator& range = controller.rangeEstimator;
+      fprintf(trace, "%g,%g,%g,%d\n", range.range, sqrt(range.rangeVariance), range.rangeRate,
+              (int)controller.guidance.terminal);
+    }
+
+    if (result.intercepted && config.stopOnIntercept != 0) break;
+  }
+
+  if (trace != nullptr) fclose(trace);
+
+  result.duration = steps * PHYSICS_DT;
+  if (steps > 0) result.thrustEffortMean = thrustEffort / steps;
+  if (imuSamples > 0) {
+    result.altitudeErrorRms = sqrt(altitudeErrorSq / imuSamples);
+    result.yawRateErrorRms = sqrt(yawRateErrorSq / imuSamples);
+    result.ekfYawRateErrorRms = sqrt(ekfYawRateErrorSq / imuSamples);
+  }
+  if (holdSamples > 0) result.ceilingHoldErrorRms = sqrt(ceilingHoldErrorSq / holdSamples);
+  return result;
+}
+
+bool applySetting(SimConfig& config, ControllerParameters& parameters, const std::string& name, const std::string& value) {
+  if (config.set(name, value)) return true;
+  char* end;
+  double number = strtod(value.c_str(), &end);
+  FlightController scratch;
+  if (value.empty() || *end != '\0' || !scratch.setParameter(name.c_str(), number)) return false;
+  parameters.push_back({name, number});
+  return true;
+}
+
+bool checkExpectations(const SimConfig& config, const SimResult& result, std::string& why) {
+  if (config.expectAcquireBefore > 0 && !(result.acquired && result.timeToAcquire <= config.expectAcquireBefore)) {
+    why = "expected the target to be acquired before " + std::to_string(config.expectAcquireBefore) + " s";
+    return false;
+  }
+  if (config.expectIntercept != 0 && !result.intercepted) {
+    why = "expected an intercept";
+    return false;
+  }
+  if (config.expectInterceptBefore > 0 && !(result.intercepted && result.interceptTime <= config.expectInterceptBefore)) {
+    why = "expected an intercept before " + std::to_string(config.expectInterceptBefore) + " s";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,44 @@
+/*
+ SilRunner.h - closes the loop between BlimpModel and the flight code
+
+ One physics step per millisecond of virtual time. Sensor samples are handed
+ to FlightController as they fall due, then FlightController::update() and
+ MotorMapping::update() run like loop() does and the servo/ESC pulses written
+ to the pins (read back through the Servo stand-in) drive the model.
+*/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SimConfig.h"
+
+// FlightController::setParameter names and values, applied before Init()
+typedef std::vector<std::pair<std::string, double>> ControllerParameters;
+
+struct SimResult {
+  double duration = 0;            // [s] simulated
+  bool acquired = false;          // entered approach at least once
+  double timeToAcquire = -1;      // [s]
+  bool intercepted = false;
+  double interceptTime = -1;      // [s]
+  double minDistance = 0;         // [m] blimp to target
+  double thrustEffortMean = 0;    // mean |thrust| / maxThrust over both motors
+  double servoTravel = 0;         // [deg] summed over both servos
+  double altitudeErrorRms = 0;    // [m] kf.x - true height above start
+  double ceilingHoldErrorRms = -1; // [m] true ceiling distance - setpoint while holding altitude, -1 if never
+  double yawRateErrorRms = 0;     // [deg/s] filtered gyro yaw rate - true yaw rate
+  double ekfYawRateErrorRms = 0;  // [deg/s] bias corrected GyroEKF yaw rate - true yaw rate
+};
+
+// Applies a scenario setting or, failing that, a FlightController parameter.
+// Returns false for unknown names and bad values.
+bool applySetting(SimConfig& config, ControllerParameters& parameters, const std::string& name, const std::string& value);
+
+// Runs one flight, writing a 100 Hz trace to tracePath unless it is empty
+SimResult runSimulation(const SimConfig& config, const ControllerParameters& parameters, const std::string& tracePath);
+
+// Checks the expect.* settings, describing the first failure in why
+bool checkExpectations(const SimConfig& config, const SimResult& result, std::string& why);
@@ -0,0 +1,173 @@
+#include "SimConfig.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+std::map<std::string, double*> SimConfig::scalars() {
+  return {
+    {"duration", &duration},
+    {"autonomous", &autonomous},
+    {"stick.yaw", &stickYaw},
+    {"stick.forward", &stickForward},
+    {"stick.up", &stickUp},
+    {"target.color", &targetColor},
+    {"stopOnIntercept", &stopOnIntercept},
+    {"seed", &seed},
+    {"forbidAllocationsAfter", &forbidAllocationsAfter},
+    {"blimp.yaw", &startYaw},
+    {"blimp.mass", &mass},
+    {"blimp.netLift", &netLift},
+    {"blimp.cgBelowCb", &cgBelowCb},
+    {"blimp.munkScale", &munkScale},
+    {"thruster.armY", &armY},
+    {"thruster.armZ", &armZ},
+    {"thruster.maxThrust", &maxThrust},
+    {"thruster.exponent", &thrustExponent},
+    {"thruster.reverseEfficiency", &reverseEfficiency},
+    {"thruster.escDeadband", &escDeadband},
+    {"thruster.tau", &motorTau},
+    {"servo.rate", &servoRate},
+    {"ceiling", &ceiling},
+    {"wind.gust", &gust},
+    {"wind.gustTau", &gustTau},
+    {"target.interceptDistance", &interceptDistance},
+    {"target.diameter", &targetDiameter},
+    {"imu.gyroNoise", &gyroNoise},
+    {"imu.accelNoise", &accelNoise},
+    {"imu.latency", &imuLatency},
+    {"baro.noise", &baroNoise},
+    {"baro.drift", &baroDrift},
+    {"baro.latency", &baroLatency},
+    {"camera.fps", &cameraFps},
+    {"camera.latency", &cameraLatency},
+    {"camera.hfov", &cameraHfov},
+    {"camera.pixelNoise", &pixelNoise},
+    {"camera.widthNoise", &widthNoise},
+    {"camera.detectProbability", &detectProbability},
+    {"camera.maxRange", &cameraMaxRange},
+    {"rangefinder.noise", &rangefinderNoise},
+    {"rangefinder.maxRange", &rangefinderMaxRange},
+    {"expect.acquireBefore", &expectAcquireBefore},
+    {"expect.intercept", &expectIntercept},
+    {"expect.interceptBefore", &expectInterceptBefore},
+  };
+}
+
+std::map<std::string, Vec3*> SimConfig::vectors() {
+  return {
+    {"blimp.start", &start},
+    {"blimp.addedMass", &addedMass},
+    {"blimp.inertia", &inertia},
+    {"blimp.addedInertia", &addedInertia},
+    {"blimp.dragLinear", &dragLinear},
+    {"blimp.dragQuad", &dragQuad},
+    {"blimp.rotDragLinear", &rotDragLinear},
+    {"blimp.rotDragQuad", &rotDragQuad},
+    {"wind", &wind},
+    {"target.start", &targetStart},
+    {"target.velocity", &targetVelocity},
+    {"arena.halfSize", &arenaHalfSize},
+    {"imu.gyroBias", &gyroBias},
+  };
+}
+
+std::vector<std::string> SimConfig::names() const {
+  SimConfig* self = const_cast<SimConfig*>(this);
+  std::vector<std::string> result;
+  for (const auto& s : self->scalars()) result.push_back(s.first);
+  for (const auto& v : self->vectors()) {
+    result.push_back(v.first);
+    result.push_back(v.first + ".x");
+    result.push_back(v.first + ".y");
+    result.push_back(v.first + ".z");
+  }
+  return result;
+}
+
+static bool parseNumber(const std::string& text, double& value) {
+  char* end;
+  value = strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+static std::string trim(const std::string& s) {
+  size_t first = s.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) return "";
+  size_t last = s.find_last_not_of(" \t\r\n");
+  return s.substr(first, last - first + 1);
+}
+
+bool SimConfig::set(const std::string& name, const std::string& value) {
+  auto scalarMap = scalars();
+  auto scalar = scalarMap.find(name);
+  if (scalar != scalarMap.end()) return parseNumber(value, *scalar->second);
+
+  auto vectorMap = vectors();
+  auto vector = vectorMap.find(name);
+  if (vector != vectorMap.end()) {
+    Vec3 v;
+    if (sscanf(value.c_str(), "%lf , %lf , %lf", &v.x, &v.y, &v.z) != 3) return false;
+    *vector->second = v;
+    return true;
+  }
+
+  // Single component, e.g. target.velocity.y
+  if (name.size() > 2 && name[name.size() - 2] == '.') {
+    vector = vectorMap.find(name.substr(0, name.size() - 2));
+    if (vector == vectorMap.end()) return false;
+    char axis = name.back();
+    double* component = axis == 'x' ? &vector->second->x : axis == 'y' ? &vector->second->y
+                      : axis == 'z' ? &vector->second->z : nullptr;
+    return component != nullptr && parseNumber(value, *component);
+  }
+  return false;
+}
+
+bool SimConfig::load(const char* path, std::string& error) {
+  std::ifstream file(path);
+  if (!file) {
+    error = std::string("cannot open ") + path;
+    return false;
+  }
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+    line = trim(line);
+    if (line.empty()) continue;
+
+    double eventTime = -1;
+    if (line.compare(0, 3, "at ") == 0) {
+      size_t colon = line.find(':');
+      if (colon == std::string::npos || !parseNumber(trim(line.substr(3, colon - 3)), eventTime)) {
+        error = std::string(path) + ":" + std::to_string(lineNumber) + ": expected \"at <seconds>: name = value\"";
+        return false;
+      }
+      line = trim(line.substr(colon + 1));
+    }
+
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      error = std::string(path) + ":" + std::to_string(lineNumber) + ": expected \"name = value\"";
+      return false;
+    }
+    std::string name = trim(line.substr(0, eq));
+    std::string value = trim(line.substr(eq + 1));
+
+    // Validate events against a scratch copy so typos fail at load time
+    SimConfig scratch;
+    if (!(eventTime >= 0 ? scratch.set(name, value) : set(name, value))) {
+      error = std::string(path) + ":" + std::to_string(lineNumber) + ": bad setting " + name + " = " + value;
+      return false;
+    }
+    if (eventTime >= 0) events.push_back({eventTime, name, value});
+  }
+
+  std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.time < b.time; });
+  return true;
+}
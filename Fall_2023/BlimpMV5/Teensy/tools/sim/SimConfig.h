@@ -0,0 +1,116 @@
+/*
+ SimConfig.h - every tunable of a simulated flight, settable by name
+
+ Frames: world is x forward (arena), y left, z up [m]. The body frame is x out
+ of the nose, y left, z up, which is also what BerryIMU_v3::IMU_read hands
+ the firmware (accel z = +1 g at rest, positive yaw rate turns left).
+
+ Scenario files (tools/sim/scenarios) are lines of "name = value" using the
+ names below; vectors are "x,y,z". "at <seconds>: name = value" lines are
+ applied during the flight, e.g. to change the target velocity.
+*/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SimMath.h"
+
+struct SimConfig {
+  // run
+  double duration = 120;          // [s]
+  double autonomous = 1;          // 1 autonomous, 0 manual
+  double stickYaw = 0;            // manual joystick, each in [-1,1]
+  double stickForward = 0;
+  double stickUp = 0;
+  double targetColor = 1;         // 0 blue, 1 red, 2 green
+  double stopOnIntercept = 1;
+  double seed = 1;
+  double forbidAllocationsAfter = -1; // [s] abort on a heap allocation in the flight code from then on, -1 off
+
+  // blimp body, CB at the origin
+  Vec3 start = Vec3(0, 0, 2);
+  double startYaw = 0;            // [deg]
+  double mass = 0.5;              // [kg] rigid mass incl. helium
+  Vec3 addedMass = Vec3(0.1, 0.4, 0.4);       // [kg]
+  Vec3 inertia = Vec3(0.05, 0.08, 0.08);      // [kg m^2]
+  Vec3 addedInertia = Vec3(0.0, 0.05, 0.05);  // [kg m^2]
+  Vec3 dragLinear = Vec3(0.05, 0.15, 0.15);   // [N/(m/s)]
+  Vec3 dragQuad = Vec3(0.2, 0.6, 0.6);        // [N/(m/s)^2]
+  Vec3 rotDragLinear = Vec3(0.01, 0.02, 0.02);  // [Nm/(rad/s)]
+  Vec3 rotDragQuad = Vec3(0.005, 0.01, 0.01);   // [Nm/(rad/s)^2]
+  double netLift = 0;             // [N] buoyancy - weight
+  double cgBelowCb = 0.1;         // [m] pendulum restoring moment
+  double munkScale = 1;           // scales the added mass (Munk) moment
+
+  // thrusters at (0, -armY, armZ) right and (0, armY, armZ) left
+  double armY = 0.25;             // [m]
+  double armZ = -0.1;             // [m]
+  double maxThrust = 0.3;         // [N] per motor at 2000 us
+  double thrustExponent = 1.5;    // thrust ~ throttle^exponent past the deadband
+  double reverseEfficiency = 0.7;
+  double escDeadband = 40;        // [us] around 1500 with no thrust
+  double motorTau = 0.1;          // [s] spin up time constant
+  double servoRate = 400;         // [deg/s] slew rate
+
+  // environment
+  double ceiling = 5;             // [m]
+  Vec3 wind = Vec3(0, 0, 0);      // [m/s] world
+  double gust = 0;                // [m/s] std of the gust process
+  double gustTau = 2;             // [s]
+
+  // target balloon
+  Vec3 targetStart = Vec3(8, 0, 2.5);
+  Vec3 targetVelocity = Vec3(0, 0, 0);  // [m/s]
+  Vec3 arenaHalfSize = Vec3(15, 10, 0); // target bounces inside |x|,|y| limits (0 = none)
+  double interceptDistance = 0.6;       // [m] centre to centre
+  double targetDiameter = 0.6;          // [m] sets the blob width
+
+  // IMU
+  double gyroNoise = 0.3;         // [deg/s] std
+  Vec3 gyroBias = Vec3(0.5, -0.3, 0.4);  // [deg/s]
+  double accelNoise = 0.01;       // [g] std
+  double imuLatency = 0.002;      // [s]
+
+  // barometer, relative to the start height
+  double baroNoise = 0.25;        // [m] std
+  double baroDrift = 0.005;       // [m/sqrt(s)] random walk
+  double baroLatency = 0.02;      // [s]
+
+  // OpenMV camera on the nose, 320x240
+  double cameraFps = 20;
+  double cameraLatency = 0.08;    // [s] capture to Teensy
+  double cameraHfov = 70.8;       // [deg]
+  double pixelNoise = 2;          // [px] std
+  double widthNoise = 0.05;       // blob width std per px of width
+  double detectProbability = 0.9;
+  double cameraMaxRange = 12;     // [m]
+  double rangefinderNoise = 2;    // [cm] std
+  double rangefinderMaxRange = 4; // [m], reports 1000 beyond
+
+  // checks for CI, a failed expectation makes sil exit with status 1
+  double expectAcquireBefore = 0;    // [s] first approach, 0 = not checked
+  double expectIntercept = 0;
+  double expectInterceptBefore = 0;  // [s], 0 = any time
+
+  // Sets a value by name, returns false for unknown names or bad values
+  bool set(const std::string& name, const std::string& value);
+
+  // Loads a scenario file, see the header comment
+  bool load(const char* path, std::string& error);
+
+  struct Event {
+    double time;
+    std::string name;
+    std::string value;
+  };
+  std::vector<Event> events;       // sorted by time
+
+  std::vector<std::string> names() const;
+
+  private:
+    std::map<std::string, double*> scalars();
+    std::map<std::string, Vec3*> vectors();
+};
@@ -0,0 +1,54 @@
+/*
+ SimMath.h - small vector helpers for the simulator
+*/
+
+#pragma once
+
+#include <math.h>
+
+struct Vec3 {
+  double x = 0, y = 0, z = 0;
+
+  Vec3() {}
+  Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+
+  Vec3 operator+(const Vec3& o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+  Vec3 operator-(const Vec3& o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+  Vec3 operator*(double s) const { return Vec3(x * s, y * s, z * s); }
+  Vec3 operator-() const { return Vec3(-x, -y, -z); }
+  Vec3& operator+=(const Vec3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+
+  // Element-wise product, for diagonal matrices
+  Vec3 mul(const Vec3& o) const { return Vec3(x * o.x, y * o.y, z * o.z); }
+  Vec3 div(const Vec3& o) const { return Vec3(x / o.x, y / o.y, z / o.z); }
+
+  double dot(const Vec3& o) const { return x * o.x + y * o.y + z * o.z; }
+  Vec3 cross(const Vec3& o) const { return Vec3(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x); }
+  double norm() const { return sqrt(dot(*this)); }
+};
+
+// Body to world rotation from ZYX Euler angles [rad]
+struct Rotation {
+  double m[3][3];
+
+  Rotation(double roll, double pitch, double yaw) {
+    double cr = cos(roll), sr = sin(roll);
+    double cp = cos(pitch), sp = sin(pitch);
+    double cy = cos(yaw), sy = sin(yaw);
+    m[0][0] = cy * cp; m[0][1] = cy * sp * sr - sy * cr; m[0][2] = cy * sp * cr + sy * sr;
+    m[1][0] = sy * cp; m[1][1] = sy * sp * sr + cy * cr; m[1][2] = sy * sp * cr - cy * sr;
+    m[2][0] = -sp;     m[2][1] = cp * sr;                m[2][2] = cp * cr;
+  }
+
+  Vec3 toWorld(const Vec3& v) const {
+    return Vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+  }
+
+  Vec3 toBody(const Vec3& v) const {
+    return Vec3(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z,
+                m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+                m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z);
+  }
+};
@@ -0,0 +1,99 @@
+/*
+ sil_main.cpp - software in the loop flight of the firmware against BlimpModel
+
+ pio run -e sil_native
+ .pio/build/sil_native/program tools/sim/scenarios/static_target.txt
+                               [--seed N] [--trace file.csv] [--set name=value] ...
+                               [--forbid-allocations]
+
+ --set takes any scenario name (see SimConfig.h) or FlightController parameter
+ (e.g. yawRatePID.kp). Prints the flight metrics and exits with status 1 when
+ an expect.* setting of the scenario is not met, 2 on bad arguments.
+ --forbid-allocations aborts on a heap allocation in the flight code after
+ the first second (forbidAllocationsAfter = 1), for CI.
+*/
+
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+
+#include "SilRunner.h"
+
+static void usage(const char* program) {
+  fprintf(stderr, "usage: %s SCENARIO [--seed N] [--trace file] [--set name=value]... [--forbid-allocations]\n", program);
+}
+
+int main(int argc, char** argv) {
+  const char* scenarioPath = nullptr;
+  std::string tracePath;
+  std::vector<std::pair<std::string, std::string>> overrides;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "--seed" || arg == "--trace" || arg == "--set") && i + 1 < argc) {
+      std::string value = argv[++i];
+      if (arg == "--seed") {
+        overrides.push_back({"seed", value});
+      } else if (arg == "--trace") {
+        tracePath = value;
+      } else {
+        size_t eq = value.find('=');
+        if (eq == std::string::npos) {
+          usage(argv[0]);
+          return 2;
+        }
+        overrides.push_back({value.substr(0, eq), value.substr(eq + 1)});
+      }
+    } else if (arg == "--forbid-allocations") {
+      overrides.push_back({"forbidAllocationsAfter", "1"});
+    } else if (arg[0] != '-' && scenarioPath == nullptr) {
+      scenarioPath = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (scenarioPath == nullptr) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  SimConfig config;
+  std::string error;
+  if (!config.load(scenarioPath, error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+
+  ControllerParameters parameters;
+  for (const auto& o : overrides) {
+    if (!applySetting(config, parameters, o.first, o.second)) {
+      fprintf(stderr, "bad setting %s = %s\n", o.first.c_str(), o.second.c_str());
+      return 2;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  SimResult r = runSimulation(config, parameters, tracePath);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("scenario            %s (seed %d)\n", scenarioPath, (int)config.seed);
+  printf("simulated           %.1f s in %.2f s (%.0fx real time)\n", r.duration, elapsed, r.duration / std::max(elapsed, 1e-9));
+  if (r.acquired) printf("time to acquire     %.2f s\n", r.timeToAcquire);
+  else            printf("time to acquire     never\n");
+  if (r.intercepted) printf("intercept           %.2f s\n", r.interceptTime);
+  else               printf("intercept           no (closest %.2f m)\n", r.minDistance);
+  printf("thrust effort       %.3f\n", r.thrustEffortMean);
+  printf("servo travel        %.0f deg\n", r.servoTravel);
+  printf("altitude error rms  %.3f m\n", r.altitudeErrorRms);
+  if (r.ceilingHoldErrorRms >= 0) printf("ceiling hold rms    %.3f m\n", r.ceilingHoldErrorRms);
+  else                            printf("ceiling hold rms    n/a\n");
+  printf("yaw rate error rms  %.2f deg/s (filtered gyro), %.2f deg/s (gyro ekf)\n", r.yawRateErrorRms, r.ekfYawRateErrorRms);
+
+  std::string why;
+  if (!checkExpectations(config, r, why)) {
+    printf("FAIL: %s\n", why.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -1,6 +1,6 @@
 # Multi Color Blob Tracking
 
-import sensor, image, time, math, pyb
+import sensor, image, time, math, pyb, struct
 from pyb import UART
 
 # Color Tracking Thresholds (L Min, L Max, A Min, A Max, B Min, B Max)
@@ -37,22 +37,138 @@ adc = pyb.ADC(pyb.Pin('P6'))
 #led.off()
 clock = time.clock()
 
+# Binary frame to the Teensy, see BlimpMV5/Teensy/include/CameraLink.h
+# sync, frame counter, capture time [ms], fps, mode, 3 x (cx, cy, pixels, w, h), range [mm], crc16
+FRAME_FORMAT = "<BBHIBB15hh"
+frame = bytearray(struct.calcsize(FRAME_FORMAT) + 2)
+frameCount = 0
+
+# CRC16-CCITT (0x1021, initial 0xFFFF), same as crc16() on the Teensy
+def crc16(data, start, end):
+    crc = 0xFFFF
+    for i in range(start, end):
+        x = ((crc >> 8) ^ data[i]) & 0xFF
+        x ^= x >> 4
+        crc = ((crc << 8) ^ (x << 12) ^ (x << 5) ^ x) & 0xFFFF
+    return crc
+
+# blob coordinates are sent in QVGA pixels, scale = 2 at QQVGA
+def camera_frame(captureTime, blobs, rangeMM, scale, fps, mode):
+    global frameCount
+    fields = []
+    for blob in blobs:
+        if blob is None:
+            fields += [0, 0, 0, 0, 0]
+        else:
+            fields += [blob.cx()*scale, blob.cy()*scale, min(blob.pixels()*scale*scale, 32767), blob.w()*scale, blob.h()*scale]
+    struct.pack_into(FRAME_FORMAT, frame, 0, 0xB5, 0x62, frameCount, captureTime, fps, mode, *fields, rangeMM)
+    struct.pack_into("<H", frame, len(frame) - 2, crc16(frame, 2, len(frame) - 2))
+    frameCount = (frameCount + 1) & 0xFFFF
+    return frame
+
+# Commands from the Teensy, CameraCommand in CameraLink.h:
+# sync, colour (0xFF = all), frame size (0 QVGA, 1 QQVGA), roi x, y, w, h in QVGA pixels, crc16
+COMMAND_FORMAT = "<BBBBhhhh"
+COMMAND_SIZE = struct.calcsize(COMMAND_FORMAT) + 2
+COMMAND_TIMEOUT = 1000 # [ms] back to all colours on the whole frame
+commandBuffer = bytearray()
+command = None
+commandTime = 0
+
+def read_command():
+    global commandBuffer, command, commandTime
+    if uart.any():
+        commandBuffer += uart.read(uart.any())
+    while len(commandBuffer) >= COMMAND_SIZE:
+        start = commandBuffer.find(b"\xb5\x63")
+        if start < 0:
+            commandBuffer = commandBuffer[-1:]
+            break
+        commandBuffer = commandBuffer[start:]
+        if len(commandBuffer) < COMMAND_SIZE:
+            break
+        crc = struct.unpack_from("<H", commandBuffer, COMMAND_SIZE - 2)[0]
+        if crc == crc16(commandBuffer, 2, COMMAND_SIZE - 2):
+            command = struct.unpack_from(COMMAND_FORMAT, commandBuffer, 0)[2:]
+            commandTime = pyb.millis()
+            commandBuffer = commandBuffer[COMMAND_SIZE:]
+        else:
+            commandBuffer = commandBuffer[1:]
+    if command is not None and pyb.millis() - commandTime > COMMAND_TIMEOUT:
+        command = None
+
 # Only blobs that with more pixels than "pixel_threshold" and more area than "area_threshold" are
 # returned by "find_blobs" below. Change "pixels_threshold" and "area_threshold" if you change the
 # camera resolution. Don't set "merge=True" becuase that will merge blobs which we don't want here.
 
+DEBUG = False # draw the blobs into the framebuffer for the IDE, costs frame rate
+
+# Tracking: with a single colour find_blobs only looks at a window around the
+# last detection, then at the Teensy's predicted window, and once both are
+# gone at the whole frame in QQVGA until the colour shows up again.
+MODE_FULL = 0   # all colours, whole frame
+MODE_WINDOW = 1
+MODE_COARSE = 2
+TRACK_FRAMES = 5 # frames the local window is kept without a detection
+WINDOW_GROW = 3  # window size in blob sizes
+WINDOW_MIN = 48  # [px] QVGA
+
+frameSize = 0
+lastBlob = None # (cx, cy, w, h, colour) of the tracked colour, QVGA
+missed = 0
+
+# window of w, h around cx, cy in QVGA pixels, clipped to the frame
+def window(cx, cy, w, h):
+    w = max(w, WINDOW_MIN)
+    h = max(h, WINDOW_MIN)
+    x0 = max(0, cx - w // 2)
+    y0 = max(0, cy - h // 2)
+    return (x0, y0, min(320, cx + w // 2) - x0, min(240, cy + h // 2) - y0)
+
 while(True):
     clock.tick()
+    read_command()
+
+    # only the colour and window the Teensy asked for
+    colors = [0, 1, 2]
+    teensyRoi = None
+    wantedSize = 0
+    if command is not None:
+        color, wantedSize, roiX, roiY, roiW, roiH = command
+        if color < 3:
+            colors = [color]
+        if roiW > 0 and roiH > 0:
+            teensyRoi = (roiX, roiY, roiW, roiH)
+
+    roi = None
+    if len(colors) > 1:
+        mode = MODE_FULL
+    elif lastBlob is not None and lastBlob[4] == colors[0] and missed < TRACK_FRAMES:
+        mode = MODE_WINDOW
+        roi = window(lastBlob[0], lastBlob[1], lastBlob[2]*WINDOW_GROW, lastBlob[3]*WINDOW_GROW)
+    elif teensyRoi is not None:
+        mode = MODE_WINDOW
+        roi = teensyRoi
+    else:
+        mode = MODE_COARSE
+        wantedSize = 1
+    if wantedSize != frameSize:
+        sensor.set_framesize(sensor.QQVGA if wantedSize == 1 else sensor.QVGA)
+        frameSize = wantedSize
+
     img = sensor.snapshot()
+    captureTime = pyb.millis()
+    scale = 320 // img.width()
+    if roi is not None:
+        roi = tuple(v // scale for v in roi)
+    else:
+        roi = (0, 0, img.width(), img.height())
 
     #bloblist object that contains all the blobs
-    blobList = img.find_blobs(thresholds, pixels_threshold=100, area_threshold=500)  #Threshhold number for resolution(distance)
-    #the red,green,blue arrays to hold the index of the biggest blob and the area of the blobs
-    #for comparison
-
-    blueBlob =[1000,1000,0] # Blue Blimps
-    redBlob = [1000,1000,0] # Red Blimps
-    greenBlob =[1000,1000,0] # Game ball
+    blobList = img.find_blobs([thresholds[c] for c in colors], roi=roi,
+                              pixels_threshold=100 // (scale*scale), area_threshold=500 // (scale*scale))  #Threshhold number for resolution(distance)
+    #the biggest blob of each colour, blue, red, green
+    best = [None, None, None]
 
 
    #loop over the list, compare all the pixels and return the biggest one
@@ -60,50 +176,43 @@ while(True):
         if blob.elongation() < 0.8:
             if blob.density() > 0.3:
             #find the biggest pixel area for each color, and center the camera based on the color we pick
-                #code = 1 is blue
-                #code = 2 is red
-                #code = 3 is green
+                #code is a bit per threshold in the list passed to find_blobs: 1, 2, 4
                 #catogerize color
-                if blob.code() == 1:
-                    if blob.pixels() > blueBlob[2]:
-                        blueBlob = [blob.cxf(), blob.cyf(), blob.pixels()]
-                elif blob.code() == 2:
-                    if blob.pixels()> redBlob[2]:
-                        redBlob = [blob.cxf(), blob.cyf(), blob.pixels()]
-                elif blob.code() == 3:
-                    if blob.pixels()> greenBlob[2]:
-                        greenBlob = [blob.cxf(), blob.cyf(), blob.pixels()]
-
-                # These values depend on the blob not being circular - otherwise they will be shaky.
-                if blob.elongation() > 0.5:
-                    img.draw_edges(blob.min_corners(), color=(255,0,0))
-                    img.draw_line(blob.major_axis_line(), color=(0,255,0))
-                    img.draw_line(blob.minor_axis_line(), color=(0,0,255))
-
-                # These values are stable all the time.
-                img.draw_rectangle(blob.rect())
-                img.draw_cross(blob.cx(), blob.cy())
-                # Note - the blob rotation is unique to 0-180 only.
-                img.draw_keypoints([(blob.cx(), blob.cy(), int(math.degrees(blob.rotation())))], size=20)
-
-                #print(blobList)
-                #print(clock.fps())
-
-    uart.write("%f"%blueBlob[0])
-    uart.write(',')
-    uart.write("%f"%blueBlob[1])
-    uart.write(',')
-    uart.write("%f"%redBlob[0])
-    uart.write(',')
-    uart.write("%f"%redBlob[1])
-    uart.write(',')
-    uart.write("%f"%greenBlob[0])
-    uart.write(',')
-    uart.write("%f"%greenBlob[1])
-    uart.write(',')
-
-    uart.write(str(adc.read()/8.2758))
-    uart.write(',#')
+                code = blob.code()
+                color = colors[0 if code == 1 else 1 if code == 2 else 2]
+                if best[color] is None or blob.pixels() > best[color].pixels():
+                    best[color] = blob
+
+                if DEBUG:
+                    # These values depend on the blob not being circular - otherwise they will be shaky.
+                    if blob.elongation() > 0.5:
+                        img.draw_edges(blob.min_corners(), color=(255,0,0))
+                        img.draw_line(blob.major_axis_line(), color=(0,255,0))
+                        img.draw_line(blob.minor_axis_line(), color=(0,0,255))
+
+                    # These values are stable all the time.
+                    img.draw_rectangle(blob.rect())
+                    img.draw_cross(blob.cx(), blob.cy())
+                    # Note - the blob rotation is unique to 0-180 only.
+                    img.draw_keypoints([(blob.cx(), blob.cy(), int(math.degrees(blob.rotation())))], size=20)
+
+    if DEBUG:
+        img.draw_rectangle(roi, color=(255,255,0))
+        print(mode, clock.fps())
+
+    if len(colors) == 1:
+        blob = best[colors[0]]
+        if blob is not None:
+            lastBlob = (blob.cx()*scale, blob.cy()*scale, blob.w()*scale, blob.h()*scale, colors[0])
+            missed = 0
+        else:
+            missed += 1
+    else:
+        lastBlob = None
+
+    # rangefinder: adc/8.2758 is [cm]
+    rangeMM = int(adc.read()/0.82758)
+    uart.write(camera_frame(captureTime, best, rangeMM, scale, min(int(clock.fps()), 255), mode))
 
 
     #LED indicator